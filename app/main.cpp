@@ -6,17 +6,19 @@
 #include "example/common/root_certificates.hpp"
 #include "boost/asio/ssl.hpp"
 #include "BinanceExchange.h"
+#include "queryServer.h"
+#include "ioThreadPool.h"
 
-// Function to fetch data of all 3 endpoints
+// Function to fetch data of the markets whose refresh is due
 void fetchAll(exchangeInfo& binanceExchange, urlInfo& urlConfig, const boost::system::error_code& /*e*/, boost::asio::steady_timer* timer1, boost::asio::io_context& ioc, boost::asio::ssl::context& ctx){
     
-    spdlog::debug("Fetching all data started...");  
+    spdlog::debug("Fetching due markets started...");  
 
-    // Call fetch data func to fetch data from each endpoint  
-    binanceExchange.fetchData(urlConfig, ioc, ctx);
+    // the scheduler picks the markets and how long to wait, from the weight budget, backoffs and how often symbols change
+    boost::asio::steady_timer::duration next = binanceExchange.fetchDue(urlConfig, ioc, ctx);
 
-    // Set the timer to expire in 60 seconds and wait for next fetch
-    timer1->expires_at(timer1->expiry() + boost::asio::chrono::seconds(urlConfig.requestInterval));
+    // Set the timer to expire when the next market is due and wait for next fetch
+    timer1->expires_after(next);
     timer1->async_wait(boost::bind(fetchAll, std::ref(binanceExchange), std::ref(urlConfig), boost::asio::placeholders::error, timer1, std::ref(ioc), std::ref(ctx)));
   
 }
@@ -50,6 +52,9 @@ int main() {
 
     spdlog::trace("Starting application...");
 
+    // serve the tables of the previous run until the first refresh replaces them
+    binanceExchange.loadSnapshot();
+
     // thread to run the readQuery function
     std::thread readQueryThread(&exchangeInfo::readQuery, &binanceExchange);
 
@@ -65,17 +70,41 @@ int main() {
     // Verify the remote server's certificate
     ctx.set_verify_mode(ssl::verify_peer);
 
+    // fetch all markets concurrently right away, queries wait for them depending on until_ready
+    if (urlConfig.warmUp) {
+        spdlog::debug("Warm-up fetch of all markets started...");
+        binanceExchange.fetchData(urlConfig, io, ctx);
+    }
+
+    // local query server on the same io_context, next to query.json
+    queryServer server(io, binanceExchange);
+    if (!binanceExchange.getQueryConfig().serverSocket.empty()) {
+        server.listenUnix(binanceExchange.getQueryConfig().serverSocket);
+    }
+    int serverPort = binanceExchange.getQueryConfig().serverPort;
+    if (serverPort < 0 || serverPort > UINT16_MAX) {
+        spdlog::error("server_port {} is not a tcp port, query server not listening on tcp", serverPort);
+    }
+    else if (serverPort != 0) {
+        server.listenTcp(static_cast<unsigned short>(serverPort));
+    }
+
     // timer to fetch data every 60 sec
     boost::asio::steady_timer timer1(io, boost::asio::chrono::seconds(urlConfig.requestInterval));
 
     // call back fetchAll function when timer expires
     timer1.async_wait(boost::bind(fetchAll, std::ref(binanceExchange), std::ref(urlConfig), boost::asio::placeholders::error, &timer1, std::ref(io), std::ref(ctx)));
 
-    // Run IO context
-    io.run();
+    // Run IO context on the configured threads, every market session has its own strand
+    ioThreadPool ioThreads(io);
+    ioThreads.start(urlConfig.ioThreads, urlConfig.ioCpuAffinity);
+    ioThreads.join();
 
     // Wait for the readQuery thread to finish
     readQueryThread.join();
+
+    // write out what the async logger still has queued
+    spdlog::shutdown();
     
     return 0;
 }
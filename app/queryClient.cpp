@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+#include "queryClient.h"
+
+// load generator for the query server
+// usage: queryClient <socket path | host:port> [requests] [pipeline depth] [market] [symbol]
+int main(int argc, char* argv[]) {
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <socket path | host:port> [requests] [pipeline depth] [market] [symbol]\n", argv[0]);
+        return 1;
+    }
+    std::string target = argv[1];
+    size_t requests = argc > 2 ? strtoul(argv[2], nullptr, 10) : 100000;
+    size_t depth = argc > 3 ? strtoul(argv[3], nullptr, 10) : 1;
+    std::string market = argc > 4 ? argv[4] : "SPOT";
+    std::string symbol = argc > 5 ? argv[5] : "BTCUSDT";
+    depth = std::max<size_t>(depth, 1);
+
+    // host:port connects over tcp, anything else is a unix socket path
+    queryClient client;
+    size_t colon = target.rfind(':');
+    bool connected = colon != std::string::npos && target.find('/') == std::string::npos
+                   ? client.connectTcp(target.substr(0, colon), std::stoi(target.substr(colon + 1)))
+                   : client.connectUnix(target);
+    if (!connected) {
+        return 1;
+    }
+
+    // send batches of depth requests and time each batch
+    std::string batch;
+    for (size_t index = 0; index < depth; ++index) {
+        batch += "GET " + market + " " + symbol + "\n";
+    }
+    std::vector<double> latencies;
+    latencies.reserve(requests / depth + 1);
+    std::string answer;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t sent = 0; sent < requests; sent += depth) {
+        auto batchStart = std::chrono::steady_clock::now();
+        if (!client.send(batch)) {
+            spdlog::error("Connection closed by server");
+            return 1;
+        }
+        for (size_t index = 0; index < depth; ++index) {
+            if (!client.receive(answer)) {
+                spdlog::error("Connection closed by server");
+                return 1;
+            }
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - batchStart).count());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[std::min(latencies.size() - 1, size_t(p * latencies.size()))]; };
+    printf("last answer: %s\n", answer.c_str());
+    printf("%zu requests in %.3f s, %.0f requests/s\n", latencies.size() * depth, seconds, latencies.size() * depth / seconds);
+    printf("round trip of %zu requests in us: p50 %.2f, p99 %.2f, p99.9 %.2f, max %.2f\n",
+           depth, percentile(0.5), percentile(0.99), percentile(0.999), latencies.back());
+    return 0;
+}
@@ -1,8 +1,47 @@
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <malloc.h>
+#include <new>
+#include <unordered_map>
+#include <thread>
+
 #include "benchmark/benchmark.h"
 #include "BinanceExchange.h"
+#include "queryDeduplicator.h"
+#include "mockServer.h"
+#include "exchangeInfoParser.h"
+#include "symbolTable.h"
+#include "queryServer.h"
+#include "queryClient.h"
+#include "sharedSymbolsClient.h"
+#include "ioThreadPool.h"
+#include <csignal>
+#include <sys/wait.h>
+#include "rapidjson/document.h"
+#include "rapidjson/filereadstream.h"
 #include "example/common/root_certificates.hpp"
 #include "boost/asio/ssl.hpp"
 
+// heap allocations made by the current thread, counted by the replacement operator new below
+static thread_local unsigned long long threadAllocations = 0;
+
+void* operator new(std::size_t size) {
+    ++threadAllocations;
+    if (void* ptr = malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    free(ptr);
+}
+
 exchangeInfo binanceExchange;
 urlInfo urlConfig;
 logsInfo logsConfig;
@@ -12,18 +51,359 @@ void initializeConfig() {
     binanceExchange.setSpdLogs(logsConfig);
 }
 
-// Benchmark for the fetchData function
+// Build an exchangeInfo response with the given number of symbols in the format of the binance api
+static std::string makeExchangeInfoPayload(int symbolCount) {
+    static const char* quoteAssets[] = {"USDT", "BTC", "ETH", "BNB", "FDUSD", "TRY"};
+    std::string payload = "{\"timezone\":\"UTC\",\"serverTime\":1730000000000,\"rateLimits\":[],\"symbols\":[";
+    for (int index = 0; index < symbolCount; ++index) {
+        std::string quote = quoteAssets[index % 6];
+        std::string symbol = "SYM" + std::to_string(index) + quote;
+        payload += index == 0 ? "" : ",";
+        payload += "{\"symbol\":\"" + symbol + "\",\"status\":\"" + (index % 10 == 0 ? "BREAK" : "TRADING") + "\",";
+        payload += "\"baseAsset\":\"SYM" + std::to_string(index) + "\",\"baseAssetPrecision\":8,\"quoteAsset\":\"" + quote + "\",";
+        payload += "\"quotePrecision\":8,\"orderTypes\":[\"LIMIT\",\"LIMIT_MAKER\",\"MARKET\",\"STOP_LOSS_LIMIT\"],";
+        payload += "\"icebergAllowed\":true,\"isSpotTradingAllowed\":true,\"filters\":[";
+        payload += "{\"filterType\":\"PRICE_FILTER\",\"minPrice\":\"0.01000000\",\"maxPrice\":\"1000000.00000000\",\"tickSize\":\"0.01000000\"},";
+        payload += "{\"filterType\":\"LOT_SIZE\",\"minQty\":\"0.00001000\",\"maxQty\":\"9000.00000000\",\"stepSize\":\"0.00001000\"},";
+        payload += "{\"filterType\":\"ICEBERG_PARTS\",\"limit\":10},{\"filterType\":\"NOTIONAL\",\"minNotional\":\"5.00000000\",\"applyMinToMarket\":true}],";
+        payload += "\"permissions\":[],\"permissionSets\":[[\"SPOT\",\"MARGIN\"]]}";
+    }
+    payload += "]}";
+    return payload;
+}
+
+// Read recorded response of market from the record directory, "" if none was recorded
+static std::string recordedPayload(const std::string& market) {
+    std::string payload;
+    FILE* recorded = fopen(("recorded/" + market + ".json").c_str(), "r");
+    if (recorded) {
+        char buffer[65536];
+        size_t length;
+        while ((length = fread(buffer, 1, sizeof(buffer), recorded)) > 0) {
+            payload.append(buffer, length);
+        }
+        fclose(recorded);
+    }
+    return payload;
+}
+
+// Recorded spot exchangeInfo response if main ran with "record_dir": "recorded", generated one otherwise
+static const std::string& exchangeInfoPayload() {
+    static std::string payload;
+    if (payload.empty()) {
+        payload = recordedPayload("SPOT");
+        if (payload.empty()) {
+            payload = makeExchangeInfoPayload(3000);
+        }
+    }
+    return payload;
+}
+
+// Benchmark for the fetchData function replaying recorded responses of all three markets from a local server
+// args: latency in ms, chunk size in bytes (0 = not chunked), payload scale factor
 static void BMFetchData(benchmark::State& state) {
+    mockServer server;
+    urlInfo localConfig;
+    localConfig.spotExchangeEndpoint = "/api/v3/exchangeInfo";
+    localConfig.usdFutureEndpoint = "/fapi/v1/exchangeInfo";
+    localConfig.coinFutureEndpoint = "/dapi/v1/exchangeInfo";
+    std::pair<std::string, std::string> markets[] = {
+        {"SPOT", localConfig.spotExchangeEndpoint},
+        {"usd_futures", localConfig.usdFutureEndpoint},
+        {"coin_futures", localConfig.coinFutureEndpoint},
+    };
+    size_t payloadBytes = 0;
+    for (auto& market : markets) {
+        std::string payload = recordedPayload(market.first);
+        if (payload.empty()) {
+            payload = exchangeInfoPayload();
+        }
+        payload = mockServer::scalePayload(payload, state.range(2));
+        payloadBytes += payload.size();
+        server.setResponse(market.second, payload);
+    }
+    server.setLatency(std::chrono::milliseconds(state.range(0)));
+    server.setChunking(state.range(1));
+    server.start();
+    localConfig.spotExchangeBaseUrl = server.baseUrl();
+    localConfig.usdFutureExchangeBaseUrl = server.baseUrl();
+    localConfig.coinFutureExchangeBaseUrl = server.baseUrl();
+
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    ctx.add_certificate_authority(boost::asio::buffer(server.certificate()));
+    ctx.set_verify_mode(ssl::verify_peer);
+
+    // the global exchange keeps the symbols for BMQuery
+    boost::asio::io_context io;
+    for (auto _ : state) {
+        binanceExchange.fetchData(localConfig, io, ctx);
+        io.run();
+        io.restart();
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * payloadBytes);
+}
+BENCHMARK(BMFetchData)->Args({0, 0, 1})->Args({0, 16384, 1})->Args({0, 0, 10})->Args({20, 0, 1})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Benchmark for refresh wall time with the io_context run by 1, 2 or 4 threads against a local replay server
+// responses alternate between two sizes so every refresh parses and publishes changed tables
+static void BMRefreshThreads(benchmark::State& state) {
+    mockServer server;
+    urlInfo localConfig;
+    localConfig.spotExchangeEndpoint = "/api/v3/exchangeInfo";
+    localConfig.usdFutureEndpoint = "/fapi/v1/exchangeInfo";
+    localConfig.coinFutureEndpoint = "/dapi/v1/exchangeInfo";
+    std::pair<std::string, std::string> markets[] = {
+        {"SPOT", localConfig.spotExchangeEndpoint},
+        {"usd_futures", localConfig.usdFutureEndpoint},
+        {"coin_futures", localConfig.coinFutureEndpoint},
+    };
+    std::vector<std::string> payloads[2];
+    for (auto& market : markets) {
+        std::string payload = recordedPayload(market.first);
+        if (payload.empty()) {
+            payload = exchangeInfoPayload();
+        }
+        payloads[0].push_back(mockServer::scalePayload(payload, 10));
+        payloads[1].push_back(mockServer::scalePayload(payload, 11));
+    }
+    server.start(0, 4);
+    localConfig.spotExchangeBaseUrl = server.baseUrl();
+    localConfig.usdFutureExchangeBaseUrl = server.baseUrl();
+    localConfig.coinFutureExchangeBaseUrl = server.baseUrl();
+
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    ctx.add_certificate_authority(boost::asio::buffer(server.certificate()));
+    ctx.set_verify_mode(ssl::verify_peer);
+
+    exchangeInfo exchange;
+    boost::asio::io_context io;
+    size_t variant = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (size_t index = 0; index < 3; ++index) {
+            server.setResponse(markets[index].second, payloads[variant][index]);
+        }
+        variant ^= 1;
+        state.ResumeTiming();
+
+        exchange.fetchData(localConfig, io, ctx);
+        ioThreadPool pool(io);
+        pool.start(state.range(0));
+        pool.join();
+        io.restart();
+    }
+    state.counters["threads"] = state.range(0);
+}
+BENCHMARK(BMRefreshThreads)->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Benchmark for heap allocations of a steady refresh, the client runs on the benchmark thread so only its allocations are counted
+// arg = payload scale, allocations per refresh should not grow with the number of symbols
+static void BMRefreshAllocations(benchmark::State& state) {
+    mockServer server;
+    urlInfo localConfig;
+    localConfig.spotExchangeEndpoint = "/api/v3/exchangeInfo";
+    localConfig.usdFutureEndpoint = "/fapi/v1/exchangeInfo";
+    localConfig.coinFutureEndpoint = "/dapi/v1/exchangeInfo";
+    std::string payload = mockServer::scalePayload(exchangeInfoPayload(), state.range(0));
+    server.setResponse(localConfig.spotExchangeEndpoint, payload);
+    server.setResponse(localConfig.usdFutureEndpoint, payload);
+    server.setResponse(localConfig.coinFutureEndpoint, payload);
+    server.start();
+    localConfig.spotExchangeBaseUrl = server.baseUrl();
+    localConfig.usdFutureExchangeBaseUrl = server.baseUrl();
+    localConfig.coinFutureExchangeBaseUrl = server.baseUrl();
+
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    ctx.add_certificate_authority(boost::asio::buffer(server.certificate()));
+    ctx.set_verify_mode(ssl::verify_peer);
+
+    // first refreshes connect and size the buffers of every session
+    exchangeInfo exchange;
+    boost::asio::io_context io;
+    for (int warmUp = 0; warmUp < 2; ++warmUp) {
+        exchange.fetchData(localConfig, io, ctx);
+        io.run();
+        io.restart();
+    }
+
+    unsigned long long allocations = 0;
+    for (auto _ : state) {
+        unsigned long long before = threadAllocations;
+        exchange.fetchData(localConfig, io, ctx);
+        io.run();
+        io.restart();
+        allocations += threadAllocations - before;
+    }
+    state.counters["allocations_per_refresh"] = double(allocations) / state.iterations();
+    state.counters["symbols"] = exchange.getSpotSymbolsSize();
+}
+BENCHMARK(BMRefreshAllocations)->Arg(1)->Arg(10)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Benchmark for refresh wall time when the configured host is slow, arg 0 = slow host only, arg 1 = fast alternate host
+// the first refresh hedges to the alternate, later ones ask it first because of its lower latency
+static void BMHedgedRefresh(benchmark::State& state) {
+    mockServer slow, fast;
+    slow.setLatency(std::chrono::milliseconds(50));
+    urlInfo localConfig;
+    localConfig.spotExchangeEndpoint = "/api/v3/exchangeInfo";
+    localConfig.usdFutureEndpoint = "/fapi/v1/exchangeInfo";
+    localConfig.coinFutureEndpoint = "/dapi/v1/exchangeInfo";
+    for (mockServer* server : {&slow, &fast}) {
+        server->setResponse(localConfig.spotExchangeEndpoint, exchangeInfoPayload());
+        server->setResponse(localConfig.usdFutureEndpoint, exchangeInfoPayload());
+        server->setResponse(localConfig.coinFutureEndpoint, exchangeInfoPayload());
+        server->start();
+    }
+    localConfig.spotExchangeBaseUrl = slow.baseUrl();
+    localConfig.usdFutureExchangeBaseUrl = slow.baseUrl();
+    localConfig.coinFutureExchangeBaseUrl = slow.baseUrl();
+    if (state.range(0)) {
+        // same server under another host name so it gets its own latency stats
+        std::string fastUrl = "127.0.0.1:" + fast.baseUrl().substr(fast.baseUrl().rfind(':') + 1);
+        for (const char* market : {"SPOT", "usd_futures", "coin_futures"}) {
+            localConfig.alternateHosts[market] = {fastUrl};
+        }
+    }
+    localConfig.hedgeDefaultDelayMs = 10;
+    localConfig.hedgeMinDelayMs = 10;
+
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    ctx.add_certificate_authority(boost::asio::buffer(slow.certificate()));
+    ctx.add_certificate_authority(boost::asio::buffer(fast.certificate()));
+    ctx.set_verify_mode(ssl::verify_peer);
+
+    exchangeInfo exchange;
     boost::asio::io_context io;
+    for (auto _ : state) {
+        exchange.fetchData(localConfig, io, ctx);
+        io.run();
+        io.restart();
+    }
+    state.counters["slow_requests"] = slow.requestCount();
+    state.counters["fast_requests"] = fast.requestCount();
+}
+BENCHMARK(BMHedgedRefresh)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Benchmark for the cost tracing adds to a request, marking every stage and recording the trace into the host histograms
+static void BMLatencyTrace(benchmark::State& state) {
+    latencyStats stats;
+    sessionTrace trace;
+    for (auto _ : state) {
+        trace.start();
+        for (size_t stage = 0; stage < size_t(traceStage::total); ++stage) {
+            trace.mark(traceStage(stage));
+        }
+        trace.finish();
+        stats.record("api.binance.com", trace);
+    }
+    state.counters["p99_ns"] = stats.find("api.binance.com", traceStage::total)->percentile(99);
+}
+BENCHMARK(BMLatencyTrace);
+
+// Benchmark for parsing an exchangeInfo response into a DOM
+static void BMParseDom(benchmark::State& state) {
+    const std::string& payload = exchangeInfoPayload();
+    for (auto _ : state) {
+        std::vector<symbolInfo> symbols;
+        parseExchangeInfoDom(payload, symbols);
+        benchmark::DoNotOptimize(symbols.data());
+    }
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BMParseDom)->Unit(benchmark::kMillisecond);
+
+// Benchmark for parsing a complete exchangeInfo response with rapidjson::Reader
+static void BMParseSax(benchmark::State& state) {
+    const std::string& payload = exchangeInfoPayload();
+    for (auto _ : state) {
+        std::vector<symbolInfo> symbols;
+        parseExchangeInfoSax(payload.data(), payload.size(), symbols);
+        benchmark::DoNotOptimize(symbols.data());
+    }
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BMParseSax)->Unit(benchmark::kMillisecond);
+
+// Benchmark for the streaming parser fed in chunks of arg bytes, like the session body does
+static void BMParseStreaming(benchmark::State& state) {
+    const std::string& payload = exchangeInfoPayload();
+    size_t chunkSize = state.range(0);
+    exchangeInfoStreamParser parser;
+    for (auto _ : state) {
+        parser.reset();
+        for (size_t offset = 0; offset < payload.size(); offset += chunkSize) {
+            parser.feed(payload.data() + offset, std::min(chunkSize, payload.size() - offset));
+        }
+        parser.finish();
+        benchmark::DoNotOptimize(parser.symbols().data());
+    }
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BMParseStreaming)->Arg(1460)->Arg(16384)->Unit(benchmark::kMillisecond);
+
+// Benchmark for a refresh of all three markets against a local server, arg 0 = new connection per refresh, arg 1 = keep-alive
+static void BMFetchDataLocal(benchmark::State& state) {
+    mockServer server;
+    std::string payload = makeExchangeInfoPayload(2000);
+    urlInfo localConfig;
+    localConfig.spotExchangeEndpoint = "/api/v3/exchangeInfo";
+    localConfig.usdFutureEndpoint = "/dapi/v1/exchangeInfo";
+    localConfig.coinFutureEndpoint = "/fapi/v1/exchangeInfo";
+    server.setResponse(localConfig.spotExchangeEndpoint, payload);
+    server.setResponse(localConfig.usdFutureEndpoint, payload);
+    server.setResponse(localConfig.coinFutureEndpoint, payload);
+    server.setKeepAlive(state.range(0));
+    server.start();
+    localConfig.spotExchangeBaseUrl = server.baseUrl();
+    localConfig.usdFutureExchangeBaseUrl = server.baseUrl();
+    localConfig.coinFutureExchangeBaseUrl = server.baseUrl();
+
     boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
-    load_root_certificates(ctx);
+    ctx.add_certificate_authority(boost::asio::buffer(server.certificate()));
     ctx.set_verify_mode(ssl::verify_peer);
+
+    exchangeInfo exchange;
+    boost::asio::io_context io;
     for (auto _ : state) {
-        binanceExchange.fetchData(urlConfig, io, ctx);
+        exchange.fetchData(localConfig, io, ctx);
         io.run();
+        io.restart();
     }
+    state.counters["connections"] = server.connectionCount();
 }
-BENCHMARK(BMFetchData);
+BENCHMARK(BMFetchDataLocal)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Benchmark for the startup warm-up, time from a fresh exchangeInfo to all three markets loaded from a local server
+static void BMTimeToReady(benchmark::State& state) {
+    mockServer server;
+    std::string payload = makeExchangeInfoPayload(2000);
+    urlInfo localConfig;
+    localConfig.spotExchangeEndpoint = "/api/v3/exchangeInfo";
+    localConfig.usdFutureEndpoint = "/dapi/v1/exchangeInfo";
+    localConfig.coinFutureEndpoint = "/fapi/v1/exchangeInfo";
+    server.setResponse(localConfig.spotExchangeEndpoint, payload);
+    server.setResponse(localConfig.usdFutureEndpoint, payload);
+    server.setResponse(localConfig.coinFutureEndpoint, payload);
+    server.start();
+    localConfig.spotExchangeBaseUrl = server.baseUrl();
+    localConfig.usdFutureExchangeBaseUrl = server.baseUrl();
+    localConfig.coinFutureExchangeBaseUrl = server.baseUrl();
+
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    ctx.add_certificate_authority(boost::asio::buffer(server.certificate()));
+    ctx.set_verify_mode(ssl::verify_peer);
+
+    long long timeToReady = 0;
+    for (auto _ : state) {
+        exchangeInfo exchange;
+        boost::asio::io_context io;
+        exchange.fetchData(localConfig, io, ctx);
+        io.run();
+        timeToReady = exchange.getTimeToReady().count();
+    }
+    state.counters["time_to_ready_ms"] = timeToReady;
+}
+BENCHMARK(BMTimeToReady)->Unit(benchmark::kMillisecond)->UseRealTime();
 
 // Benchmark for the query function
 static void BMQuery(benchmark::State& state) {
@@ -34,6 +414,544 @@ static void BMQuery(benchmark::State& state) {
 }
 BENCHMARK(BMQuery);
 
+// Benchmark for query throughput with trace logging to the log file, arg 0 = logging off, arg 1 = synchronous, arg 2 = async
+// trace and debug lines are compiled out in Release builds, build with -DLOG_ACTIVE_LEVEL=TRACE to measure them
+static void BMQueryLogging(benchmark::State& state) {
+    exchangeInfo exchange;
+    exchange.setSpotSymbol("BTCUSDT", {"BTCUSDT", "USDT", "TRADING", "0.01", "0.001"});
+    logsInfo benchLogs;
+    benchLogs.level = state.range(0) == 0 ? "off" : "trace";
+    benchLogs.file = true;
+    benchLogs.console = false;
+    benchLogs.async = state.range(0) == 2;
+    exchange.setSpdLogs(benchLogs);
+
+    std::string market = "SPOT", symbol = "BTCUSDT", type = "GET", status = "";
+    for (auto _ : state) {
+        exchange.processQuery(market, symbol, type, status);
+    }
+    state.SetItemsProcessed(state.iterations());
+    exchange.flushAnswers();
+
+    // back to the logger of config.json
+    binanceExchange.setSpdLogs(logsConfig);
+}
+BENCHMARK(BMQueryLogging)->Arg(0)->Arg(1)->Arg(2)->UseRealTime();
+
+// Benchmark for a burst of 1024 queries until all answers are on disk, arg 0 = json array, arg 1 = ndjson
+static void BMQueryAnswersBurst(benchmark::State& state) {
+    exchangeInfo exchange;
+    queryInfo queryConfig;
+    queryConfig.answersFile = "bench_answers.json";
+    queryConfig.answersNdjson = state.range(0);
+    exchange.setQueryConfig(queryConfig);
+
+    symbolInfo info{"BTCUSDT", "USDT", "TRADING", "0.01", "0.001"};
+    exchange.setSpotSymbol(info.symbol, info);
+
+    std::string market = "SPOT", symbol = "BTCUSDT", type = "GET", status = "";
+    for (auto _ : state) {
+        for (int index = 0; index < 1024; ++index) {
+            exchange.processQuery(market, symbol, type, status);
+        }
+        exchange.flushAnswers();
+    }
+    state.SetItemsProcessed(state.iterations() * 1024);
+}
+BENCHMARK(BMQueryAnswersBurst)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Benchmark for batches of queries until their answers are on disk, arg is the batch size, every 16th query is an UPDATE
+static void BMQueryBatch(benchmark::State& state) {
+    exchangeInfo exchange;
+    queryInfo queryConfig;
+    queryConfig.answersFile = "bench_answers.json";
+    exchange.setQueryConfig(queryConfig);
+
+    std::vector<symbolInfo> parsed;
+    parseExchangeInfoSax(exchangeInfoPayload().data(), exchangeInfoPayload().size(), parsed);
+    exchange.refreshMarket("SPOT", parsed);
+
+    std::vector<parsedQuery> batch;
+    for (int index = 0; index < state.range(0); ++index) {
+        const std::string& symbol = parsed[(index * 7919) % parsed.size()].symbol;
+        bool update = index % 16 == 15;
+        batch.push_back(parsedQuery{(unsigned long long)index, "SPOT", symbol, update ? "UPDATE" : "GET", update ? "BREAK" : ""});
+    }
+
+    std::string answers;
+    for (auto _ : state) {
+        if (exchange.executeQueries(batch.data(), batch.size(), answers) > 0) {
+            exchange.writeAnswers(std::move(answers));
+        }
+        exchange.flushAnswers();
+    }
+    state.SetItemsProcessed(state.iterations() * batch.size());
+}
+BENCHMARK(BMQueryBatch)->Arg(1)->Arg(64)->Arg(4096)->Unit(benchmark::kMicrosecond);
+
+// Benchmark for index backed queries over the spot table, arg 0 = LIST, 1 = FILTER TRADING USDT, 2 = PREFIX BTC
+static void BMIndexQuery(benchmark::State& state) {
+    exchangeInfo exchange;
+    std::vector<symbolInfo> parsed;
+    parseExchangeInfoSax(exchangeInfoPayload().data(), exchangeInfoPayload().size(), parsed);
+    exchange.refreshMarket("SPOT", parsed);
+
+    parsedQuery queries[] = {
+        {0, "SPOT", "", "LIST", "", ""},
+        {1, "SPOT", "", "FILTER", "TRADING", "USDT"},
+        {2, "SPOT", "BTC", "PREFIX", "", ""},
+    };
+    std::string answer;
+    for (auto _ : state) {
+        exchange.executeQueries(&queries[state.range(0)], 1, answer);
+        benchmark::DoNotOptimize(answer.data());
+    }
+    state.counters["answer_bytes"] = answer.size();
+}
+BENCHMARK(BMIndexQuery)->Arg(0)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+
+// Benchmark for symbol lookup of the last built-in market, arg 0 = market by name, arg 1 = market known at compile time
+static void BMMarketDispatch(benchmark::State& state) {
+    exchangeInfo exchange;
+    exchange.addMarket("options");
+    std::vector<symbolInfo> parsed;
+    parseExchangeInfoSax(exchangeInfoPayload().data(), exchangeInfoPayload().size(), parsed);
+    exchange.refreshMarket("coin_futures", parsed);
+
+    std::string market = "coin_futures";
+    std::string symbol = "BTCUSDT";
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            benchmark::DoNotOptimize(exchange.getSymbol(market, symbol));
+        }
+        else {
+            benchmark::DoNotOptimize(exchange.getSymbol<marketId::coinFutures>(symbol));
+        }
+    }
+}
+BENCHMARK(BMMarketDispatch)->Arg(0)->Arg(1);
+
+// Start readQuery on an empty query file, arg 0 = polling, arg 1 = inotify
+static void startQueryReader(exchangeInfo& exchange, const std::string& queryFile, bool watch, std::thread& reader) {
+    FILE* fileQuery = fopen(queryFile.c_str(), "w");
+    fputs("{\"query\":[\n]}", fileQuery);
+    fclose(fileQuery);
+
+    queryInfo queryConfig;
+    queryConfig.queryFile = queryFile;
+    queryConfig.watchFile = watch;
+    exchange.setQueryConfig(queryConfig);
+    reader = std::thread(&exchangeInfo::readQuery, &exchange);
+}
+
+// Append one query object before the closing "\n]}" of the query file
+static void appendQuery(const std::string& queryFile, unsigned long long id, bool first) {
+    FILE* fileQuery = fopen(queryFile.c_str(), "r+");
+    fseek(fileQuery, -3, SEEK_END);
+    fprintf(fileQuery, "%s\n{\"id\": %llu, \"query_type\": \"GET\", \"market_type\": \"SPOT\", \"instrument_name\": \"BTCUSDT\"}\n]}",
+            first ? "" : ",", id);
+    fclose(fileQuery);
+}
+
+// Benchmark for the time between appending a query to the query file and readQuery answering it
+static void BMQueryFileLatency(benchmark::State& state) {
+    exchangeInfo exchange;
+    symbolInfo info{"BTCUSDT", "USDT", "TRADING", "0.01", "0.001"};
+    exchange.setSpotSymbol(info.symbol, info);
+
+    std::string queryFile = "bench_query.json";
+    std::thread reader;
+    startQueryReader(exchange, queryFile, state.range(0), reader);
+
+    unsigned long long id = 0;
+    for (auto _ : state) {
+        ++id;
+        appendQuery(queryFile, id, id == 1);
+        while (exchange.getProcessedQueryCount() < id) {
+            std::this_thread::yield();
+        }
+    }
+
+    exchange.stopQuery();
+    reader.join();
+}
+BENCHMARK(BMQueryFileLatency)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// Benchmark for CPU used by readQuery while nobody writes queries
+static void BMQueryIdleCpu(benchmark::State& state) {
+    exchangeInfo exchange;
+    std::thread reader;
+    startQueryReader(exchange, "bench_query.json", state.range(0), reader);
+
+    double cpuSeconds = 0, wallSeconds = 0;
+    for (auto _ : state) {
+        std::clock_t cpuStart = std::clock();
+        auto wallStart = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        cpuSeconds += double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        wallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    }
+    state.counters["idle_cpu_percent"] = 100.0 * cpuSeconds / wallSeconds;
+
+    exchange.stopQuery();
+    reader.join();
+}
+BENCHMARK(BMQueryIdleCpu)->Arg(0)->Arg(1)->Iterations(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Benchmark for replaying a query file of 100k queries through the query de-duplication, arg = id capacity
+static void BMQueryDedupReplay(benchmark::State& state) {
+    const int queryCount = 100000;
+
+    // write query file with ids in mostly increasing order and a few out of order ones
+    std::string queryFile = "bench_dedup_query.json";
+    FILE* fileQuery = fopen(queryFile.c_str(), "w");
+    fputs("{\"query\":[\n", fileQuery);
+    for (int index = 0; index < queryCount; ++index) {
+        unsigned long long id = index % 16 == 0 ? index / 2 : index;
+        fprintf(fileQuery, "%s{\"id\": %llu, \"query_type\": \"GET\", \"market_type\": \"SPOT\", \"instrument_name\": \"BTCUSDT\"}\n",
+                index == 0 ? "" : ",", id);
+    }
+    fputs("]}", fileQuery);
+    fclose(fileQuery);
+
+    // load ids of the query file
+    rapidjson::Document doc;
+    fileQuery = fopen(queryFile.c_str(), "r");
+    char buffer[65536];
+    rapidjson::FileReadStream is(fileQuery, buffer, sizeof(buffer));
+    doc.ParseStream(is);
+    fclose(fileQuery);
+    std::vector<unsigned long long> ids;
+    for (const auto& query : doc["query"].GetArray()) {
+        ids.push_back(query["id"].GetUint64());
+    }
+
+    // every replay sees the file twice, like readQuery does when the file is read again
+    size_t processed = 0;
+    for (auto _ : state) {
+        queryDeduplicator prevIDs(state.range(0));
+        for (int pass = 0; pass < 2; ++pass) {
+            for (unsigned long long id : ids) {
+                processed += prevIDs.insert(id);
+            }
+        }
+        benchmark::DoNotOptimize(processed);
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size() * 2);
+}
+BENCHMARK(BMQueryDedupReplay)->Arg(1 << 14)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+// Heap bytes in use, to measure what a table costs including the strings it owns
+static size_t heapInUse() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+// Benchmark for building one market's table, reports heap bytes per market and per symbol
+// arg 0 = unordered_map of five std::strings per symbol (previous layout), arg 1 = compact symbolTable
+static void BMSymbolTableMemory(benchmark::State& state) {
+    std::vector<symbolInfo> parsed;
+    parseExchangeInfoSax(exchangeInfoPayload().data(), exchangeInfoPayload().size(), parsed);
+    size_t bytes = 0;
+    for (auto _ : state) {
+        size_t before = heapInUse();
+        if (state.range(0) == 0) {
+            std::unordered_map<std::string, symbolInfo> symbols;
+            for (const auto& info : parsed) {
+                symbols[info.symbol] = info;
+            }
+            bytes = heapInUse() - before;
+            benchmark::DoNotOptimize(symbols);
+        }
+        else {
+            symbolTable symbols;
+            symbols.reserve(parsed.size());
+            for (const auto& info : parsed) {
+                symbols.insert(info);
+            }
+            bytes = heapInUse() - before;
+            benchmark::DoNotOptimize(symbols);
+        }
+    }
+    state.counters["bytes_per_market"] = bytes;
+    state.counters["bytes_per_symbol"] = double(bytes) / parsed.size();
+}
+BENCHMARK(BMSymbolTableMemory)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Benchmark for looking up a symbol, arg 0 = unordered_map of symbolInfo, arg 1 = compact symbolTable record
+static void BMSymbolLookup(benchmark::State& state) {
+    std::vector<symbolInfo> parsed;
+    parseExchangeInfoSax(exchangeInfoPayload().data(), exchangeInfoPayload().size(), parsed);
+    std::unordered_map<std::string, symbolInfo> legacy;
+    symbolTable compact;
+    for (const auto& info : parsed) {
+        legacy[info.symbol] = info;
+        compact.insert(info);
+    }
+
+    size_t index = 0;
+    for (auto _ : state) {
+        const std::string& symbol = parsed[index++ % parsed.size()].symbol;
+        if (state.range(0) == 0) {
+            benchmark::DoNotOptimize(legacy.find(symbol));
+        }
+        else {
+            benchmark::DoNotOptimize(compact.findRecord(symbol));
+        }
+    }
+}
+BENCHMARK(BMSymbolLookup)->Arg(0)->Arg(1);
+
+// Benchmark for rounding orders to tick and step size, arg is the batch size, 1 = single order api
+static void BMNormalizeOrders(benchmark::State& state) {
+    static exchangeInfo exchange;
+    std::vector<symbolInfo> parsed;
+    parseExchangeInfoSax(exchangeInfoPayload().data(), exchangeInfoPayload().size(), parsed);
+    std::unique_ptr<symbolTable> symbols(new symbolTable());
+    for (const auto& info : parsed) {
+        symbols->insert(info);
+    }
+    exchange.publishSpotSymbols(std::move(symbols));
+
+    size_t batch = state.range(0);
+    std::vector<orderInput> orders(batch);
+    std::vector<orderResult> results(batch);
+    for (size_t index = 0; index < batch; ++index) {
+        orders[index].symbol = parsed[(index * 7919) % parsed.size()].symbol;
+        fixedDecimal::parse(std::to_string(100 + index) + ".123456", orders[index].price);
+        fixedDecimal::parse("1.23456789", orders[index].quantity);
+    }
+
+    for (auto _ : state) {
+        if (batch == 1) {
+            exchange.normalizeOrder("SPOT", orders[0], roundingMode::down, results[0]);
+        }
+        else {
+            exchange.normalizeOrders("SPOT", orders.data(), results.data(), batch, roundingMode::down);
+        }
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BMNormalizeOrders)->Arg(1)->Arg(64)->Arg(1024);
+
+// Benchmark for a warm restart, loading all three markets from the snapshot file written after a refresh
+static void BMLoadSnapshot(benchmark::State& state) {
+    std::vector<symbolInfo> parsed;
+    parseExchangeInfoSax(exchangeInfoPayload().data(), exchangeInfoPayload().size(), parsed);
+    {
+        exchangeInfo exchange;
+        exchange.setSnapshotFile("bench_symbols.snapshot");
+        for (int market = 0; market < 3; ++market) {
+            std::unique_ptr<symbolTable> symbols(new symbolTable());
+            for (const auto& info : parsed) {
+                symbols->insert(info);
+            }
+            if (market == 0) exchange.publishSpotSymbols(std::move(symbols));
+            if (market == 1) exchange.publishUsdSymbols(std::move(symbols));
+            if (market == 2) exchange.publishCoinSymbols(std::move(symbols));
+        }
+    }
+
+    for (auto _ : state) {
+        exchangeInfo exchange;
+        exchange.setSnapshotFile("bench_symbols.snapshot");
+        benchmark::DoNotOptimize(exchange.loadSnapshot());
+    }
+    state.SetItemsProcessed(state.iterations() * parsed.size() * 3);
+}
+BENCHMARK(BMLoadSnapshot)->Unit(benchmark::kMillisecond);
+
+// Benchmark for applying a refresh, arg 0 = content unchanged, arg 1 = one status changed, arg 2 = full table rebuild as before
+static void BMRefreshMarket(benchmark::State& state) {
+    exchangeInfo exchange;
+    std::vector<symbolInfo> parsed;
+    parseExchangeInfoSax(exchangeInfoPayload().data(), exchangeInfoPayload().size(), parsed);
+    exchange.refreshMarket("SPOT", parsed);
+
+    bool flip = false;
+    for (auto _ : state) {
+        if (state.range(0) == 2) {
+            std::unique_ptr<symbolTable> symbols(new symbolTable());
+            symbols->reserve(parsed.size());
+            for (const auto& info : parsed) {
+                symbols->insert(info);
+            }
+            exchange.publishSpotSymbols(std::move(symbols));
+            continue;
+        }
+        if (state.range(0) == 1) {
+            flip = !flip;
+            parsed[0].status = flip ? "BREAK" : "TRADING";
+        }
+        benchmark::DoNotOptimize(exchange.refreshMarket("SPOT", parsed));
+    }
+    state.counters["unchanged"] = exchange.getRefreshStats().unchanged;
+}
+BENCHMARK(BMRefreshMarket)->Arg(0)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+
+// Benchmark for a refresh with one status change, arg is the number of subscribers whose callback takes 1 ms
+static void BMRefreshWithSubscribers(benchmark::State& state) {
+    exchangeInfo exchange;
+    std::vector<symbolInfo> parsed;
+    parseExchangeInfoSax(exchangeInfoPayload().data(), exchangeInfoPayload().size(), parsed);
+    exchange.refreshMarket("SPOT", parsed);
+
+    std::vector<unsigned long long> ids;
+    for (int index = 0; index < state.range(0); ++index) {
+        ids.push_back(exchange.subscribe(subscriptionFilter(), [](const symbolChange&) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }));
+    }
+
+    bool flip = false;
+    for (auto _ : state) {
+        flip = !flip;
+        parsed[0].status = flip ? "BREAK" : "TRADING";
+        benchmark::DoNotOptimize(exchange.refreshMarket("SPOT", parsed));
+    }
+
+    unsigned long long dropped = 0;
+    for (auto id : ids) {
+        dropped += exchange.getDroppedChanges(id);
+        exchange.unsubscribe(id);
+    }
+    state.counters["dropped"] = dropped;
+}
+BENCHMARK(BMRefreshWithSubscribers)->Arg(0)->Arg(1)->Arg(8)->Unit(benchmark::kMicrosecond);
+
+// Benchmark for one GET round trip through the query server, arg 0 is the unix socket and 1 is loopback tcp
+static void BMQueryServer(benchmark::State& state) {
+    exchangeInfo exchange;
+    std::vector<symbolInfo> parsed;
+    parseExchangeInfoSax(exchangeInfoPayload().data(), exchangeInfoPayload().size(), parsed);
+    exchange.refreshMarket("SPOT", parsed);
+    std::string request = "GET SPOT " + parsed[parsed.size() / 2].symbol;
+
+    boost::asio::io_context ioc;
+    queryServer server(ioc, exchange);
+    queryClient client;
+    if (state.range(0) == 0) {
+        server.listenUnix("benchmark_query.sock");
+    }
+    unsigned short port = state.range(0) == 1 ? server.listenTcp(0) : 0;
+    std::thread ioThread([&ioc] { ioc.run(); });
+    bool connected = state.range(0) == 0 ? client.connectUnix("benchmark_query.sock") : client.connectTcp("127.0.0.1", port);
+
+    std::string answer;
+    for (auto _ : state) {
+        if (!connected || !client.request(request, answer)) {
+            state.SkipWithError("query server not reachable");
+            break;
+        }
+        benchmark::DoNotOptimize(answer.data());
+    }
+
+    client.close();
+    server.stop();
+    ioc.stop();
+    ioThread.join();
+}
+BENCHMARK(BMQueryServer)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// Benchmark for shared memory lookups while the tables are republished every ms
+// arg is the number of other reader processes looking up symbols at the same time
+static void BMSharedMemoryLookup(benchmark::State& state) {
+    sharedSymbols::remove("/binance_symbols_benchmark");
+    exchangeInfo exchange;
+    exchange.setSharedMemory("/binance_symbols_benchmark", 4 << 20);
+    std::vector<symbolInfo> parsed;
+    parseExchangeInfoSax(exchangeInfoPayload().data(), exchangeInfoPayload().size(), parsed);
+    exchange.refreshMarket("SPOT", parsed);
+
+    std::vector<pid_t> readers;
+    for (int index = 0; index < state.range(0); ++index) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            sharedSymbolsClient client;
+            client.open("/binance_symbols_benchmark");
+            fixedDecimal tickSize, stepSize;
+            for (size_t next = 0;; ++next) {
+                client.findFilters("SPOT", parsed[next % parsed.size()].symbol, tickSize, stepSize);
+            }
+        }
+        readers.push_back(pid);
+    }
+
+    std::atomic<bool> stop{false};
+    std::thread refresher([&] {
+        std::vector<symbolInfo> changed = parsed;
+        for (bool flip = false; !stop; flip = !flip) {
+            changed[0].status = flip ? "BREAK" : "TRADING";
+            exchange.refreshMarket("SPOT", changed);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    sharedSymbolsClient client;
+    client.open("/binance_symbols_benchmark");
+    fixedDecimal tickSize, stepSize;
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(client.findFilters("SPOT", parsed[next++ % parsed.size()].symbol, tickSize, stepSize));
+    }
+
+    stop = true;
+    refresher.join();
+    for (pid_t pid : readers) {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+    state.counters["retries"] = client.retryCount();
+    state.counters["publications"] = client.generation();
+    sharedSymbols::remove("/binance_symbols_benchmark");
+}
+BENCHMARK(BMSharedMemoryLookup)->Arg(0)->Arg(1)->Arg(4)->UseRealTime();
+
+// Benchmark for symbol lookups while a refresh publishes a new table in the background, arg 0 = no refresh, arg 1 = refresh running
+static void BMLookupDuringRefresh(benchmark::State& state) {
+    static exchangeInfo exchange;
+    static std::atomic<bool> refreshing{false};
+    static std::thread publisher;
+    static std::vector<symbolInfo> parsed;
+
+    if (state.thread_index() == 0) {
+        parsed.clear();
+        parseExchangeInfoSax(exchangeInfoPayload().data(), exchangeInfoPayload().size(), parsed);
+        std::unique_ptr<symbolTable> symbols(new symbolTable());
+        for (const auto& info : parsed) {
+            symbols->insert(info);
+        }
+        exchange.publishSpotSymbols(std::move(symbols));
+
+        if (state.range(0) == 1) {
+            refreshing = true;
+            publisher = std::thread([] {
+                while (refreshing) {
+                    std::unique_ptr<symbolTable> symbols(new symbolTable());
+                    symbols->reserve(parsed.size());
+                    for (const auto& info : parsed) {
+                        symbols->insert(info);
+                    }
+                    exchange.publishSpotSymbols(std::move(symbols));
+                }
+            });
+        }
+    }
+
+    size_t index = state.thread_index() * 7919;
+    for (auto _ : state) {
+        const std::string& symbol = parsed[index++ % parsed.size()].symbol;
+        benchmark::DoNotOptimize(exchange.getSpotSymbol(symbol));
+    }
+
+    if (state.thread_index() == 0 && publisher.joinable()) {
+        refreshing = false;
+        publisher.join();
+    }
+}
+BENCHMARK(BMLookupDuringRefresh)->Arg(0)->Arg(1)->Threads(1)->Threads(4)->UseRealTime();
+
 // Main function to run benchmarks
 int main() {
     // Initialize answers.json file
@@ -1,15 +1,43 @@
 #ifndef BinanceExchange_H
 #define BinanceExchange_H
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
 #include <string>
 
 #include "utils.h"
+#include "queryWatcher.h"
+#include "queryDeduplicator.h"
+#include "answersWriter.h"
+#include "sessionCache.h"
+#include "rcuSnapshot.h"
+#include "symbolTable.h"
+#include "orderNormalizer.h"
+#include "changeLog.h"
+#include "changeNotifier.h"
+#include "sharedSymbols.h"
+#include "snapshotWriter.h"
+#include "marketRegistry.h"
+#include "latencyStats.h"
+#include "rateLimiter.h"
+#include "refreshScheduler.h"
 #include "boost/asio/ssl.hpp"
 
-// class stores symbol info for each endpoint in seperate maps
+class connectionPool;
+
+// class stores symbol info for each market of the registry in seperate tables
+// each table is an immutable snapshot, readers never wait for a refresh or an update in progress
 class exchangeInfo{
     public:
+        // drops the pooled sessions of the exchange, requests must not be running anymore
+        ~exchangeInfo();
+
         // Getter for spotSymbols
         const symbolInfo getSpotSymbol(const std::string&) const;
 
@@ -28,6 +56,38 @@ class exchangeInfo{
         // Setter for coinSymbols
         void setCoinSymbol(const  std::string&, const symbolInfo&); 
 
+        // Replace all spot symbols with a new table
+        void publishSpotSymbols(std::unique_ptr<symbolTable>);
+
+        // Replace all usd futures symbols with a new table
+        void publishUsdSymbols(std::unique_ptr<symbolTable>);
+
+        // Replace all coin futures symbols with a new table
+        void publishCoinSymbols(std::unique_ptr<symbolTable>);
+
+        // Apply a refresh of market, skipped if nothing changed since the last one, otherwise only the differences are applied
+        // returns the number of changed symbols
+        size_t refreshMarket(const std::string&, const std::vector<symbolInfo>&);
+
+        // Read change events after cursor and move cursor past them, returns false if events were lost
+        bool readChanges(uint64_t&, std::vector<symbolChange>&) const;
+
+        // Call callback from a delivery thread for every change matching filter, returns id for unsubscribe
+        // a subscriber that does not keep up loses events instead of slowing down refreshes and queries
+        unsigned long long subscribe(const subscriptionFilter&, changeCallback, size_t queueCapacity = 1024);
+
+        // Stop delivering changes to subscriber, must not be called from its callback
+        bool unsubscribe(unsigned long long);
+
+        // number of changes dropped for subscriber because it did not keep up
+        const unsigned long long getDroppedChanges(unsigned long long) const;
+
+        // Wait until subscriber has seen every change queued for it so far
+        void flushChanges(unsigned long long) const;
+
+        // refreshes skipped because nothing changed / refreshes that changed symbols
+        const refreshStats getRefreshStats() const;
+
         // Function to get the size of spotSymbols
         const size_t getSpotSymbolsSize() const;
 
@@ -64,17 +124,223 @@ class exchangeInfo{
         // check if coin symbol exists
         bool coinSymbolexists(const std::string&) const;
 
+        // Round or validate price and quantity of an order against tickSize and stepSize of its symbol
+        normalizeStatus normalizeOrder(const std::string&, const orderInput&, roundingMode, orderResult&) const;
+
+        // Add market from config.json, returns its index or marketRegistry::unknown if there is no room
+        size_t addMarket(const std::string&);
+
+        // registered markets, the three Binance markets first
+        const marketRegistry& getMarkets() const;
+
+        // Get symbol of market, empty symbolInfo if the symbol or market is not there
+        const symbolInfo getSymbol(const std::string&, const std::string&) const;
+
+        // Get symbol of a market known at compile time, skips the name lookup
+        template <marketId id>
+        const symbolInfo getSymbol(const std::string& key) const {
+            symbolInfo info;
+            _markets.get<id>().symbols.read()->find(key, info);
+            return info;
+        }
+
+        // Insert or replace symbol of market
+        void setSymbol(const std::string&, const symbolInfo&);
+
+        // Replace all symbols of market with a new table
+        void publishSymbols(const std::string&, std::unique_ptr<symbolTable>);
+
+        // Func to update status of a symbol of market
+        void updateStatus(const std::string&, const std::string&, const std::string&);
+
+        // Func to delete a symbol of market
+        void deleteSymbol(const std::string&, const std::string&);
+
+        // check if symbol exists in market
+        bool symbolExists(const std::string&, const std::string&) const;
+
+        // number of symbols of market, 0 for an unknown market
+        const size_t getSymbolsSize(const std::string&) const;
+
+        // Normalize a batch of orders of one market, all of them against the same snapshot
+        void normalizeOrders(const std::string&, const orderInput*, orderResult*, size_t, roundingMode) const;
+
         // configurations functions
         void readConfig(std::string, urlInfo&, logsInfo&);  // Read config file for url info and logs info
         void setSpdLogs(logsInfo&); // set logging level and file/console enabling
         void fetchData(urlInfo&, boost::asio::io_context&, boost::asio::ssl::context&); // get symbols data from endpoints
+        std::chrono::steady_clock::duration fetchDue(urlInfo&, boost::asio::io_context&, boost::asio::ssl::context&); // get symbols of markets whose refresh is due, returns time until the next one is
+        void setQueryConfig(const queryInfo&);  // set query file and watch mode
+        const queryInfo& getQueryConfig() const;    // query file, answers file and query server settings
         void readQuery();   // read query file continously
+        void stopQuery();   // make readQuery return
         void processQuery(std::string&, std::string&, std::string&, std::string&); // process query
+        bool executeQuery(const std::string&, const std::string&, const std::string&, const std::string&, std::string&); // run query and serialize its answer
+        size_t executeQueries(const parsedQuery*, size_t, std::string&); // run queries in order and serialize all answers, returns number answered
+
+        // Check a query of the query file or the query server before it is executed, ids are de-duplicated across both
+        // a query without id is never a duplicate, a not ready answer is appended to the string while until_ready is not_ready
+        queryAdmission admitQuery(std::optional<unsigned long long>, std::string&);
+
+        // check if queries are held back, until_ready is wait and a market is missing before ready_timeout passed since start
+        bool holdQueries() const;
+
+        // dns and tls session cache shared by all sessions
+        sessionCache& getSessionCache();
+
+        // dns cache hits/misses and resumed/full tls handshakes
+        const connectionStats getConnectionStats() const;
+
+        // per host latency histograms of each stage of the refresh requests, also answered by STATS queries
+        latencyStats& getLatencyStats();
+        const latencyStats& getLatencyStats() const;
+
+        // request weight budget and backoff shared by all sessions, filled from the response headers
+        rateLimiter& getRateLimiter();
+        const rateLimiter& getRateLimiter() const;
+
+        // poll interval of every market, adapted to the weight budget and how often the symbols change
+        refreshScheduler& getScheduler();
+
+        // Refresh of market failed, it is scheduled again after its interval
+        void refreshFailed(const std::string&);
+
+        // Refresh of market over several hosts was applied or failed on every host, the next one may start
+        void requestFinished(const std::string&);
+
+        // Connection pool of an io_context is shut down, its sessions are gone already
+        void poolClosed(connectionPool*);
+
+        // Append answers from executeQuery or executeQueries to the answers file from the writer thread
+        void writeAnswers(std::string&&);
+
+        // wait until all answers are written to the answers file
+        void flushAnswers();
+
+        // number of answers lost because the answers file could not be opened or written
+        const unsigned long long getDroppedAnswers() const;
+
+        // number of queries executed by readQuery
+        const unsigned long long getProcessedQueryCount() const;
+
+        // check if every market has received its first complete snapshot
+        bool isReady() const;
+
+        // Wait until every market has its first snapshot, 0 waits forever, returns false on timeout or stopQuery
+        bool waitUntilReady(std::chrono::milliseconds);
+
+        // time from construction until every market had its first snapshot, -1 while not ready
+        const std::chrono::milliseconds getTimeToReady() const;
+
+        // set file the symbol tables are saved to after each refresh, "" disables it
+        void setSnapshotFile(const std::string&);
+
+        // Load symbol tables saved by a previous run, they are served as stale until the network refresh replaces them
+        bool loadSnapshot();
+
+        // Save symbol tables of all markets to the snapshot file
+        bool saveSnapshot();
+
+        // wait until the saves requested by refreshes are in the snapshot file
+        void flushSnapshot();
+
+        // check if market is still served from the snapshot file
+        bool isStale(const std::string&) const;
+
+        // time the loaded snapshot file was written in milliseconds since epoch, 0 if none was loaded
+        const long long getSnapshotTime() const;
+
+        // Publish symbol tables to shared memory segment name after every change, read them with sharedSymbolsClient
+        // "" stops publishing, returns false if the segment cannot be opened
+        bool setSharedMemory(const std::string&, size_t);
+
+        // Record raw exchangeInfo responses to <directory>/<market>.json for replay by mockServer, "" stops recording
+        void setRecordDirectory(const std::string&);
+        bool isRecording() const;
+
+        // Write raw response of market to the record directory
+        bool recordResponse(const std::string&, const std::string&);
         
     private:
-        std::unordered_map<std::string, symbolInfo> _spotSymbols;
-        std::unordered_map<std::string, symbolInfo> _usdSymbols;
-        std::unordered_map<std::string, symbolInfo> _coinSymbols;
+        // Serialize the not ready error of a query while markets are still loading
+        void notReadyAnswer(unsigned long long, std::string&) const;
+
+        // Remember that market got its first snapshot, becomes ready once all markets have one
+        void markPublished(size_t);
+
+        // Number changes, keep them in the change log and queue them for subscribers
+        void emitChanges(std::vector<symbolChange>&);
+
+        // Forget digest of the last refresh of market after a local change so the next refresh is applied
+        void forgetDigest(size_t);
+
+        // Market was refreshed from the network, no longer stale, save the snapshot file and shared memory if its table changed
+        void marketRefreshed(size_t, bool);
+
+        // Write current symbol tables of all markets to the shared memory segment
+        bool publishShared();
+
+        // Take a snapshot of every market for saving or publishing, guards keep the tables alive
+        void readAllMarkets(std::vector<std::unique_ptr<rcuSnapshot<symbolTable>::readGuard>>&,
+                            std::vector<std::pair<std::string, const symbolTable*>>&) const;
+
+        // Start requests of the markets in mask, bits as in marketRegistry
+        void fetchMarkets(urlInfo&, boost::asio::io_context&, boost::asio::ssl::context&, unsigned);
+
+        // same as the public functions for the market at index
+        size_t refreshMarket(size_t, const std::vector<symbolInfo>&);
+        void setSymbol(size_t, const symbolInfo&);
+        void publishSymbols(size_t, std::unique_ptr<symbolTable>);
+        void updateStatus(size_t, const std::string&, const std::string&);
+        void deleteSymbol(size_t, const std::string&);
+
+        // symbol tables and refresh digests of all markets
+        marketRegistry _markets;
+
+        queryInfo _queryConfig;
+        queryWatcher _queryWatcher;
+        answersWriter _answersWriter;
+        sessionCache _sessionCache;
+        latencyStats _latencyStats;
+        rateLimiter _rateLimiter;
+        refreshScheduler _scheduler{_rateLimiter};
+        std::atomic<unsigned> _requestsInFlight{0};     // bits of markets with a refresh over several hosts in flight
+        std::set<connectionPool*> _pools;       // pools holding sessions of the exchange, released on destruction
+        std::mutex _poolsMutex;
+        std::atomic<unsigned long long> _processedQueries{0};
+        queryDeduplicator _prevIDs;     // ids of queries processed so far, from the query file and the query server
+        std::mutex _prevIDsMutex;
+
+        // startup readiness, one bit per market that has published a snapshot
+        std::chrono::steady_clock::time_point _startTime = std::chrono::steady_clock::now();
+        std::atomic<unsigned> _publishedMarkets{0};
+        std::atomic<long long> _timeToReadyMs{-1};
+        std::atomic<bool> _stopWaiting{false};
+        std::mutex _readyMutex;
+        std::condition_variable _readyCondition;
+
+        // refresh counters, the digest of the last applied refresh is kept per market in _markets
+        std::atomic<unsigned long long> _unchangedRefreshes{0};
+        std::atomic<unsigned long long> _changedRefreshes{0};
+        changeLog _changeLog;
+        changeNotifier _changeNotifier;
+
+        // snapshot file of the symbol tables
+        std::string _snapshotFile;
+        std::mutex _snapshotMutex;
+        std::atomic<unsigned> _staleMarkets{0};     // bits of markets served from the snapshot file
+        std::atomic<long long> _snapshotTimeMs{0};
+
+        // shared memory copy of the symbol tables for other processes
+        sharedSymbols _sharedSymbols;
+        std::mutex _sharedMutex;
+
+        // directory raw responses are recorded to
+        std::string _recordDirectory;
+        mutable std::mutex _recordMutex;
+
+        // saves the snapshot file off the refresh path, last so it stops before the tables it reads are gone
+        snapshotWriter _snapshotWriter{[this] { return saveSnapshot(); }};
 };
 
 #endif // BinanceExchange_H
\ No newline at end of file
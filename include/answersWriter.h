@@ -0,0 +1,75 @@
+#ifndef answersWriter_H
+#define answersWriter_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "lockFreeQueue.h"
+
+// class keeps the answers file open and appends query results from a background thread
+// results are handed over through a lock-free queue and written with one write call per batch
+class answersWriter{
+    public:
+        explicit answersWriter(size_t queueCapacity = 4096);
+        ~answersWriter();
+
+        answersWriter(const answersWriter&) = delete;
+        answersWriter& operator=(const answersWriter&) = delete;
+
+        // Truncate answers file and start writer thread, ndjson writes one answer per line instead of a json array
+        bool open(const std::string&, bool);
+
+        // Open answers file unless the writer is already running
+        bool ensureOpen(const std::string&, bool);
+
+        // check if writer thread is running
+        bool isOpen() const;
+
+        // Queue one serialized answer, or several already joined with the separator of the file ("\n" or ",\n")
+        // waits for room if the queue is full, returns false and counts it as dropped if the writer is not open
+        bool write(std::string&&);
+
+        // Wait until every queued answer is in the file
+        void flush();
+
+        // Write remaining answers and stop writer thread
+        void close();
+
+        // number of answers lost because the answers file could not be written
+        unsigned long long dropped() const;
+
+    private:
+        // Open answers file, caller holds _openMutex
+        bool openLocked(const std::string&, bool);
+
+        // writer thread loop
+        void run();
+
+        // Write one batch of answers at the end of the file
+        bool writeBatch(const std::string&);
+
+        lockFreeQueue<std::string> _queue;
+        std::thread _writerThread;
+        std::mutex _openMutex;
+        std::atomic<bool> _open;
+        std::atomic<bool> _stop;
+        bool _ndjson;
+        int _fd;
+        long _tail;                             // offset of the closing "\n]" in json mode
+        unsigned long long _answersInFile;
+
+        std::atomic<unsigned long long> _queued;
+        std::atomic<unsigned long long> _written;
+        std::atomic<unsigned long long> _dropped;
+
+        // used only to sleep while the queue is empty and to wait in flush
+        std::mutex _waitMutex;
+        std::condition_variable _wakeWriter;
+        std::condition_variable _batchWritten;
+        std::atomic<bool> _writerWaiting;
+};
+
+#endif // answersWriter_H
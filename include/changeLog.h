@@ -0,0 +1,32 @@
+#ifndef changeLog_H
+#define changeLog_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "symbolDiff.h"
+
+// bounded log of symbol changes, consumers keep a cursor and read what was added since
+// the oldest events are dropped once the log is full, a consumer that falls behind is told it lost events
+class changeLog{
+    public:
+        explicit changeLog(size_t capacity = 65536);
+
+        // Append events, assigns their sequence numbers
+        void append(std::vector<symbolChange>&);
+
+        // Copy events with sequence >= cursor and move cursor past them, returns false if some were already dropped
+        bool readSince(uint64_t&, std::vector<symbolChange>&) const;
+
+        // sequence number the next event will get
+        uint64_t nextSequence() const;
+
+    private:
+        size_t _capacity;
+        mutable std::mutex _mutex;
+        std::vector<symbolChange> _events;  // ring buffer indexed by sequence % capacity
+        uint64_t _nextSequence;
+};
+
+#endif // changeLog_H
@@ -0,0 +1,89 @@
+#ifndef changeNotifier_H
+#define changeNotifier_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lockFreeQueue.h"
+#include "rcuSnapshot.h"
+#include "symbolDiff.h"
+
+// what a subscriber wants to hear about, empty market or symbol and fields 0 match everything
+struct subscriptionFilter {
+    std::string market;
+    std::string symbol;
+    unsigned fields = 0;    // statusField, quoteAssetField, tickSizeField, stepSizeField
+};
+
+typedef std::function<void(const symbolChange&)> changeCallback;
+
+// class delivers symbol changes to subscribed callbacks
+// every subscriber has its own bounded lock-free queue and delivery thread, publishing never waits for a subscriber,
+// events for a subscriber whose queue is full are dropped and counted
+class changeNotifier{
+    public:
+        changeNotifier();
+        ~changeNotifier();
+
+        changeNotifier(const changeNotifier&) = delete;
+        changeNotifier& operator=(const changeNotifier&) = delete;
+
+        // Register callback for changes matching filter, returns id for unsubscribe
+        unsigned long long subscribe(const subscriptionFilter&, changeCallback, size_t queueCapacity = 1024);
+
+        // Remove subscriber, waits for its delivery thread, must not be called from the callback itself
+        bool unsubscribe(unsigned long long);
+
+        // Queue changes for every matching subscriber
+        void publish(const std::vector<symbolChange>&);
+
+        // number of events dropped for subscriber because its queue was full
+        unsigned long long droppedCount(unsigned long long) const;
+
+        // Wait until every queued event of subscriber went through its callback
+        void flush(unsigned long long) const;
+
+    private:
+        struct subscriber {
+            subscriber(unsigned long long, const subscriptionFilter&, changeCallback, size_t);
+
+            bool matches(const symbolChange&) const;
+
+            // delivery thread loop
+            void run();
+
+            void stop();
+
+            unsigned long long id;
+            subscriptionFilter filter;
+            changeCallback callback;
+            lockFreeQueue<symbolChange> queue;
+            std::thread thread;
+            std::atomic<bool> stopping;
+            std::atomic<unsigned long long> queued;
+            std::atomic<unsigned long long> delivered;
+            std::atomic<unsigned long long> dropped;
+
+            // used only to sleep while the queue is empty and to wait in flush
+            std::mutex waitMutex;
+            std::condition_variable wake;
+            std::condition_variable drained;
+            std::atomic<bool> waiting;
+        };
+
+        typedef std::vector<std::shared_ptr<subscriber>> subscriberList;
+
+        // Get subscriber by id, nullptr if there is none
+        std::shared_ptr<subscriber> find(unsigned long long) const;
+
+        rcuSnapshot<subscriberList> _subscribers;   // publish reads the list without a lock
+        std::atomic<unsigned long long> _nextId;
+};
+
+#endif // changeNotifier_H
@@ -0,0 +1,109 @@
+#ifndef exchangeInfoParser_H
+#define exchangeInfoParser_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "utils.h"
+
+// SAX handler that keeps only symbol, quoteAsset, status/contractStatus, tickSize and stepSize of an exchangeInfo response
+// has the handler interface of rapidjson::Reader so the same handler serves the full buffer and the streaming parse
+class symbolsHandler{
+    public:
+        symbolsHandler();
+
+        // Forget symbols and parse state
+        void reset();
+
+        // check if the response had a symbols array
+        bool hasSymbols() const;
+
+        // Symbols found so far, slots kept from a longer earlier document are dropped
+        std::vector<symbolInfo>& symbols();
+
+        // rapidjson SAX interface
+        bool Null();
+        bool Bool(bool);
+        bool Int(int);
+        bool Uint(unsigned);
+        bool Int64(int64_t);
+        bool Uint64(uint64_t);
+        bool Double(double);
+        bool RawNumber(const char*, unsigned, bool);
+        bool String(const char*, unsigned, bool);
+        bool StartObject();
+        bool Key(const char*, unsigned, bool);
+        bool EndObject(unsigned);
+        bool StartArray();
+        bool EndArray(unsigned);
+
+    private:
+        // field the next value belongs to
+        enum class field { none, symbols, symbol, quoteAsset, status, filters, filterType, tickSize, stepSize };
+
+        std::vector<symbolInfo> _symbols;  // reused by every document so steady refreshes do not allocate per symbol
+        size_t _count;                      // symbols of the current document, the first _count slots of _symbols
+        symbolInfo* _current;               // slot of the symbol being parsed
+        std::string _filterType;
+        std::string _filterTickSize;
+        std::string _filterStepSize;
+        field _pending;
+        int _depth;
+        int _symbolsDepth;      // depth of the symbols array, 0 while outside of it
+        int _filtersDepth;      // depth of the filters array of the current symbol, 0 while outside of it
+        bool _hasSymbols;
+};
+
+// resumable json tokenizer fed with chunks as they arrive from the network, drives a symbolsHandler
+// rapidjson 1.1.0 has no push parser, so this keeps its own state between chunks
+class exchangeInfoStreamParser{
+    public:
+        exchangeInfoStreamParser();
+
+        // Start a new document
+        void reset();
+
+        // Parse the next chunk of the document, returns false on malformed input
+        bool feed(const char*, size_t);
+
+        // End of document, returns false if it was incomplete or malformed
+        bool finish();
+
+        // check if the response had a symbols array
+        bool hasSymbols() const;
+
+        // Symbols parsed so far
+        std::vector<symbolInfo>& symbols();
+
+        // Keep a copy of the raw document in recording, reset starts it over, nullptr stops recording
+        void record(std::string*);
+
+    private:
+        enum class mode { value, string, escape, unicode, number, literal, failed };
+
+        // Emit pending number or literal token
+        bool endToken();
+
+        // Append code point as utf-8
+        void appendUtf8(unsigned);
+
+        symbolsHandler _handler;
+        std::vector<char> _containers;  // stack of open '{' and '['
+        std::string _token;
+        mode _mode;
+        bool _expectKey;
+        bool _isKey;
+        unsigned _codePoint;
+        unsigned _highSurrogate;
+        int _hexDigits;
+        std::string* _recording;
+};
+
+// Parse exchangeInfo response into a DOM and copy out the symbols
+bool parseExchangeInfoDom(const std::string&, std::vector<symbolInfo>&);
+
+// Parse exchangeInfo response from a complete buffer with rapidjson::Reader and the symbols handler
+bool parseExchangeInfoSax(const char*, size_t, std::vector<symbolInfo>&);
+
+#endif // exchangeInfoParser_H
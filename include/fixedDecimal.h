@@ -0,0 +1,52 @@
+#ifndef fixedDecimal_H
+#define fixedDecimal_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// non-negative decimal stored in 8 bytes as integer units and the number of digits after the point
+// "0.01000000" is 1000000 units with scale 8, the scale keeps trailing zeros so the original text round-trips
+class fixedDecimal{
+    public:
+        // absent value, prints as ""
+        fixedDecimal();
+
+        // Parse decimal text, "" gives an absent value, returns false if text is not a decimal that fits
+        static bool parse(std::string_view, fixedDecimal&);
+
+        // Make value from units and scale, returns false if units do not fit
+        static bool fromUnits(uint64_t, unsigned, fixedDecimal&);
+
+        // raw 8 byte form, used by the snapshot file
+        uint64_t packed() const { return _packed; }
+        static fixedDecimal fromPacked(uint64_t packed) { fixedDecimal value; value._packed = packed; return value; }
+
+        // Text the value was parsed from
+        std::string toString() const;
+
+        // Write text of the value into a buffer of at least maxChars, returns its length
+        static constexpr size_t maxChars = 258;
+        size_t toChars(char*) const;
+
+        // check if no value was given
+        bool empty() const;
+
+        // integer units, value is units / 10^scale
+        int64_t units() const;
+
+        // digits after the decimal point
+        unsigned scale() const;
+
+        bool operator==(const fixedDecimal& other) const { return _packed == other._packed; }
+        bool operator!=(const fixedDecimal& other) const { return _packed != other._packed; }
+
+    private:
+        static constexpr int unitsBits = 56;
+        static constexpr uint64_t unitsMask = (uint64_t(1) << unitsBits) - 1;
+        static constexpr unsigned absentScale = 0xFF;
+
+        uint64_t _packed;   // scale in the top byte, units in the low 56 bits
+};
+
+#endif // fixedDecimal_H
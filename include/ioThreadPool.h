@@ -0,0 +1,33 @@
+#ifndef ioThreadPool_H
+#define ioThreadPool_H
+
+#include <thread>
+#include <vector>
+
+#include "boost/asio/io_context.hpp"
+
+// threads running one io_context, sessions keep their handlers on their own strand so markets are fetched and parsed in parallel
+// each thread can be pinned to a cpu, thread i gets cpus[i % cpus.size()]
+class ioThreadPool{
+    public:
+        explicit ioThreadPool(boost::asio::io_context&);
+        ~ioThreadPool();
+
+        ioThreadPool(const ioThreadPool&) = delete;
+        ioThreadPool& operator=(const ioThreadPool&) = delete;
+
+        // Start threads calling run on the io_context, 0 threads uses one, empty cpus leaves scheduling to the os
+        void start(size_t, const std::vector<int>& cpus = {});
+
+        // Wait until the io_context runs out of work or is stopped
+        void join();
+
+        // number of running threads
+        size_t size() const;
+
+    private:
+        boost::asio::io_context& _ioc;
+        std::vector<std::thread> _threads;
+};
+
+#endif // ioThreadPool_H
@@ -0,0 +1,44 @@
+#ifndef latencyHistogram_H
+#define latencyHistogram_H
+
+#include <atomic>
+#include <cstdint>
+
+// HDR-style histogram of durations in nanoseconds, recording is a few atomic increments and never allocates
+// values share a bucket with at most 1/32 of their size, so every reported value is within about 3% of a recorded one
+class latencyHistogram{
+    public:
+        static constexpr unsigned subBucketBits = 5;
+        static constexpr unsigned subBuckets = 1u << subBucketBits;
+        static constexpr unsigned bucketCount = (64 - subBucketBits) * subBuckets + subBuckets;
+
+        latencyHistogram();
+
+        latencyHistogram(const latencyHistogram&) = delete;
+        latencyHistogram& operator=(const latencyHistogram&) = delete;
+
+        // Add one duration, negative ones are ignored
+        void record(int64_t);
+
+        // number of recorded durations
+        uint64_t count() const;
+
+        // smallest value below which percentile % of the durations fall, 0 if nothing was recorded
+        uint64_t percentile(double) const;
+
+        // largest and average recorded duration
+        uint64_t max() const;
+        uint64_t mean() const;
+
+        // bucket of a value and the largest value of a bucket
+        static unsigned bucketOf(uint64_t);
+        static uint64_t highestValueOf(unsigned);
+
+    private:
+        std::atomic<uint64_t> _buckets[bucketCount];
+        std::atomic<uint64_t> _count;
+        std::atomic<uint64_t> _sum;
+        std::atomic<uint64_t> _max;
+};
+
+#endif // latencyHistogram_H
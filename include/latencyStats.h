@@ -0,0 +1,81 @@
+#ifndef latencyStats_H
+#define latencyStats_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "latencyHistogram.h"
+
+// stages a refresh request of a session goes through, read includes parsing because the body is parsed while it arrives
+enum class traceStage : unsigned { resolve, connect, handshake, write, read, process, shutdown, total, count };
+
+// name of stage in stats answers
+const char* traceStageName(traceStage);
+
+// timings of one request, kept by its session and reused for every refresh so tracing does not allocate
+class sessionTrace{
+    public:
+        static constexpr size_t stageCount = size_t(traceStage::count);
+
+        sessionTrace();
+
+        // Start timing a new request, stages it skips stay at -1
+        void start();
+
+        // Stage ended, its duration is the time since the previous stage ended
+        void mark(traceStage);
+
+        // Request finished, sets the total
+        void finish();
+
+        // duration of stage in nanoseconds, -1 if it did not run
+        int64_t duration(traceStage) const;
+
+    private:
+        std::chrono::steady_clock::time_point _started;
+        std::chrono::steady_clock::time_point _last;
+        std::array<int64_t, stageCount> _durations;
+};
+
+// per host histograms of every stage keyed by "host:port", filled by the sessions after each request
+class latencyStats{
+    public:
+        using histograms = std::array<latencyHistogram, sessionTrace::stageCount>;
+
+        // Add the timings of a finished request to the histograms of host
+        void record(const std::string&, const sessionTrace&);
+
+        // Call fn for every host with its histograms
+        void forEachHost(const std::function<void(const std::string&, const histograms&)>&) const;
+
+        // histogram of host and stage, nullptr if host has no requests yet
+        const latencyHistogram* find(const std::string&, traceStage) const;
+
+        // Request to host failed or did not answer within the hedge delay, it is not timed
+        void recordFailure(const std::string&, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+        // check if host failed less than duration ago
+        bool failedWithin(const std::string&, std::chrono::steady_clock::duration,
+                          std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) const;
+
+        // number of failures of host
+        uint64_t failures(const std::string&) const;
+
+    private:
+        struct hostFailures {
+            uint64_t count = 0;
+            std::chrono::steady_clock::time_point last;
+        };
+
+        mutable std::mutex _mutex;
+        std::map<std::string, std::unique_ptr<histograms>> _hosts;
+        std::map<std::string, hostFailures> _failures;
+};
+
+#endif // latencyStats_H
@@ -0,0 +1,103 @@
+#ifndef lockFreeQueue_H
+#define lockFreeQueue_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// bounded multi producer multi consumer queue, push and pop never take a lock
+// each cell carries a sequence number telling producers and consumers whose turn it is
+template <typename T>
+class lockFreeQueue{
+    public:
+        // capacity is rounded up to a power of two
+        explicit lockFreeQueue(size_t capacity) {
+            size_t size = 2;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            _mask = size - 1;
+            _cells.reset(new cell[size]);
+            for (size_t index = 0; index < size; ++index) {
+                _cells[index].sequence.store(index, std::memory_order_relaxed);
+            }
+            _enqueuePos.store(0, std::memory_order_relaxed);
+            _dequeuePos.store(0, std::memory_order_relaxed);
+        }
+
+        lockFreeQueue(const lockFreeQueue&) = delete;
+        lockFreeQueue& operator=(const lockFreeQueue&) = delete;
+
+        // returns false if the queue is full
+        bool push(T&& value) {
+            cell* target;
+            size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+            while (true) {
+                target = &_cells[pos & _mask];
+                size_t sequence = target->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                else if (diff < 0) {
+                    return false;
+                }
+                else {
+                    pos = _enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+            target->data = std::move(value);
+            target->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // returns false if the queue is empty
+        bool pop(T& value) {
+            cell* target;
+            size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+            while (true) {
+                target = &_cells[pos & _mask];
+                size_t sequence = target->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+                if (diff == 0) {
+                    if (_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                else if (diff < 0) {
+                    return false;
+                }
+                else {
+                    pos = _dequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+            value = std::move(target->data);
+            target->sequence.store(pos + _mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        // approximate, a push in progress may already count
+        bool empty() const {
+            return _dequeuePos.load(std::memory_order_acquire) == _enqueuePos.load(std::memory_order_acquire);
+        }
+
+        size_t capacity() const {
+            return _mask + 1;
+        }
+
+    private:
+        struct cell {
+            std::atomic<size_t> sequence;
+            T data;
+        };
+
+        std::unique_ptr<cell[]> _cells;
+        size_t _mask;
+        alignas(64) std::atomic<size_t> _enqueuePos;
+        alignas(64) std::atomic<size_t> _dequeuePos;
+};
+
+#endif // lockFreeQueue_H
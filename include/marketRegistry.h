@@ -0,0 +1,63 @@
+#ifndef marketRegistry_H
+#define marketRegistry_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "rcuSnapshot.h"
+#include "symbolTable.h"
+
+// markets built into the handler, markets added from config.json get the indices after them
+enum class marketId : unsigned { spot = 0, usdFutures = 1, coinFutures = 2 };
+
+// everything exchangeInfo keeps per market
+struct marketState {
+    std::string name;                           // market_type of queries, e.g. "SPOT"
+    rcuSnapshot<symbolTable> symbols;
+    std::atomic<uint64_t> refreshDigest{0};     // digest of the last applied refresh, see symbolsDigest
+};
+
+// markets by index, resolving a name happens once and everything after it is one array access
+// markets are only added while reading the config, lookups may run concurrently with that
+class marketRegistry{
+    public:
+        static constexpr size_t maxMarkets = 32;    // one bit per market in the readiness and stale masks
+        static constexpr size_t unknown = maxMarkets;
+
+        // Registers the built-in markets in marketId order
+        marketRegistry();
+
+        // Add market, returns its index, the index of a market with the same name, or unknown if the registry is full
+        size_t add(const std::string&);
+
+        // index of market, unknown if it is not registered
+        size_t find(std::string_view) const;
+
+        // number of registered markets
+        size_t size() const { return _size.load(std::memory_order_acquire); }
+
+        marketState& operator[](size_t index) { return *_markets[index]; }
+        const marketState& operator[](size_t index) const { return *_markets[index]; }
+
+        // built-in market without any lookup
+        template <marketId id>
+        marketState& get() { return *_markets[size_t(id)]; }
+        template <marketId id>
+        const marketState& get() const { return *_markets[size_t(id)]; }
+
+        // bit of market in masks over all markets
+        static unsigned bit(size_t index) { return 1u << index; }
+
+        // bits of all registered markets
+        unsigned allBits() const;
+
+    private:
+        std::array<std::unique_ptr<marketState>, maxMarkets> _markets;
+        std::atomic<size_t> _size;
+};
+
+#endif // marketRegistry_H
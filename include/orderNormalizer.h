@@ -0,0 +1,44 @@
+#ifndef orderNormalizer_H
+#define orderNormalizer_H
+
+#include <cstdint>
+#include <string_view>
+
+#include "fixedDecimal.h"
+#include "symbolTable.h"
+
+// how price and quantity are brought onto the tick and step grid of a symbol
+enum class roundingMode : uint8_t { validate, down, up, nearest };
+
+// outcome of normalizing one order
+enum class normalizeStatus : uint8_t {
+    ok,                 // price and quantity were already on the grid
+    adjusted,           // price or quantity was rounded
+    offGrid,            // validate mode and price or quantity is not on the grid
+    unknownSymbol,
+    invalidPrice,       // missing, zero after rounding or too large
+    invalidQuantity     // missing, zero after rounding or too large
+};
+
+// order price and quantity of a symbol
+struct orderInput {
+    std::string_view symbol;
+    fixedDecimal price;
+    fixedDecimal quantity;
+};
+
+// price and quantity after normalization
+struct orderResult {
+    fixedDecimal price;
+    fixedDecimal quantity;
+    normalizeStatus status;
+};
+
+// Round value to a multiple of step, returns false if the result does not fit
+// an absent or zero step leaves the value unchanged
+bool roundToStep(const fixedDecimal&, const fixedDecimal&, roundingMode, fixedDecimal&, bool&);
+
+// Normalize price to tickSize and quantity to stepSize of record
+normalizeStatus normalizeOrder(const symbolRecord&, const fixedDecimal&, const fixedDecimal&, roundingMode, orderResult&);
+
+#endif // orderNormalizer_H
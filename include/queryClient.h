@@ -0,0 +1,37 @@
+#ifndef queryClient_H
+#define queryClient_H
+
+#include <string>
+
+// blocking client of the query server, one request line out and one answer line back
+class queryClient{
+    public:
+        queryClient();
+        ~queryClient();
+
+        queryClient(const queryClient&) = delete;
+        queryClient& operator=(const queryClient&) = delete;
+
+        // Connect to unix domain socket
+        bool connectUnix(const std::string&);
+
+        // Connect to host and port over tcp
+        bool connectTcp(const std::string&, unsigned short);
+
+        // Send request lines without waiting for the answers, lines are separated by '\n'
+        bool send(const std::string&);
+
+        // Receive the next answer line without the newline
+        bool receive(std::string&);
+
+        // Send one request and wait for its answer
+        bool request(const std::string&, std::string&);
+
+        void close();
+
+    private:
+        int _fd;
+        std::string _buffer;    // bytes received after the last returned answer
+};
+
+#endif // queryClient_H
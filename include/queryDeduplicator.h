@@ -0,0 +1,39 @@
+#ifndef queryDeduplicator_H
+#define queryDeduplicator_H
+
+#include <cstddef>
+#include <deque>
+#include <unordered_set>
+
+// class remembers processed query ids with constant time lookup
+// ids continuing a run of consecutive ids only move the ends of the run, ids out of order are kept in a hash set
+// once the set holds more ids than the cap the oldest out of order id is forgotten, it would be processed again but no unseen id is skipped
+class queryDeduplicator{
+    public:
+        explicit queryDeduplicator(size_t capacity = 1000000);
+
+        // returns true and remembers id if it was not seen before
+        bool insert(unsigned long long);
+
+        // check if id was seen before
+        bool seen(unsigned long long) const;
+
+        // number of out of order ids currently stored
+        size_t size() const;
+
+        // forget all ids
+        void clear();
+
+    private:
+        // Take ids next to the run out of the set
+        void extendRun();
+
+        size_t _capacity;
+        bool _hasRun;
+        unsigned long long _runFirst;               // every id from _runFirst to _runLast was seen
+        unsigned long long _runLast;
+        std::unordered_set<unsigned long long> _ids;
+        std::deque<unsigned long long> _order;      // insertion order used for eviction, may still hold ids the run took over
+};
+
+#endif // queryDeduplicator_H
@@ -0,0 +1,59 @@
+#ifndef queryServer_H
+#define queryServer_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "boost/asio/io_context.hpp"
+#include "boost/asio/ip/tcp.hpp"
+#include "boost/asio/local/stream_protocol.hpp"
+#include "BinanceExchange.h"
+
+// serves GET/UPDATE/DELETE queries over a unix domain socket and optionally a loopback tcp port
+// one request per line: "GET <market> <symbol>", "UPDATE <market> <symbol> <status>", "DELETE <market> <symbol>",
+// "LIST <market>", "FILTER <market> <quoteAsset|*> <status|*>", "PREFIX <market> <prefix>"
+// a request may start with a numeric query id, ids are de-duplicated together with the ids of the query file
+// every request is answered with one line holding the same json as answers.json, or {"error":"..."}
+// until_ready applies as for the query file, requests are held or answered not ready until every market is loaded
+// requests may be pipelined, all complete lines of one read are answered with one write
+// a connection sending a line longer than maxRequestLength is closed
+class queryServer{
+    public:
+        static constexpr size_t maxRequestLength = 4096;
+
+        queryServer(boost::asio::io_context&, exchangeInfo&);
+        ~queryServer();
+
+        queryServer(const queryServer&) = delete;
+        queryServer& operator=(const queryServer&) = delete;
+
+        // Listen on unix domain socket, an old socket file at path is removed
+        bool listenUnix(const std::string&);
+
+        // Listen on 127.0.0.1, port 0 picks a free port, returns the port or 0 on failure
+        unsigned short listenTcp(unsigned short);
+
+        // Stop accepting, open connections end with their next read
+        void stop();
+
+        // number of requests answered
+        unsigned long long requestCount() const;
+
+        // Answer one request line, appends the answer and a newline to out
+        static void handleRequest(exchangeInfo&, std::string_view, std::string&);
+
+    private:
+        template <typename Acceptor>
+        void doAccept(Acceptor&);
+
+        boost::asio::io_context& _ioc;
+        exchangeInfo& _exchange;
+        std::unique_ptr<boost::asio::local::stream_protocol::acceptor> _unixAcceptor;
+        std::unique_ptr<boost::asio::ip::tcp::acceptor> _tcpAcceptor;
+        std::string _unixPath;
+        std::shared_ptr<std::atomic<unsigned long long>> _requests;     // shared with the connections
+};
+
+#endif // queryServer_H
@@ -0,0 +1,45 @@
+#ifndef queryWatcher_H
+#define queryWatcher_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+// class watches the query file (inotify on linux) and hands out only the query objects appended since the last read
+class queryWatcher{
+    public:
+        queryWatcher();
+        ~queryWatcher();
+
+        queryWatcher(const queryWatcher&) = delete;
+        queryWatcher& operator=(const queryWatcher&) = delete;
+
+        // Start watching query file, falls back to polling if inotify is disabled or unavailable
+        bool watch(const std::string&, bool);
+
+        // Block until the query file changes, returns false once stop() is called
+        bool waitForChange();
+
+        // Wake up waitForChange and make it return false, also when called before watch, a stopped watcher stays stopped
+        void stop();
+
+        // Read the bytes appended since last call and store every complete query object found in them
+        size_t readNewQueries(std::vector<std::string>&);
+
+    private:
+        // Start reading the file again from the beginning
+        void resetOffset();
+
+        std::string _queryFile;
+        std::string _queryFileName;     // file name without directory, matched against inotify events
+        bool _useInotify;
+        int _inotifyFd;
+        int _watchFd;
+        int _stopFd;
+        std::atomic<bool> _stopped;
+        long _offset;                   // file offset just after the last complete query object
+        int _depth;                     // json nesting depth at _offset
+        unsigned long _inode;           // inode of the query file, changes when an editor replaces the file
+};
+
+#endif // queryWatcher_H
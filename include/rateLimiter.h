@@ -0,0 +1,49 @@
+#ifndef rateLimiter_H
+#define rateLimiter_H
+
+#include <chrono>
+#include <mutex>
+#include <random>
+
+// request weight budget of the ip, shared by all sessions and filled from the X-MBX-USED-WEIGHT-1M response header
+// 429 and 418 answers block every request until Retry-After has passed, without the header it backs off exponentially with jitter
+class rateLimiter{
+    public:
+        using clock = std::chrono::steady_clock;
+
+        explicit rateLimiter(unsigned weightLimit = 6000);
+
+        // Set the weight the exchange allows per minute
+        void setWeightLimit(unsigned);
+
+        // Weight used in the current minute as reported by the exchange
+        void updateUsedWeight(unsigned, clock::time_point now = clock::now());
+
+        // Exchange answered with status 429 or 418, retryAfter of 0 means the header was missing
+        void reject(unsigned, std::chrono::seconds retryAfter, clock::time_point now = clock::now());
+
+        // Exchange answered normally, ends the backoff
+        void accept();
+
+        // part of the weight limit used in the current minute, 0 once the minute of the last report has passed
+        double usedFraction(clock::time_point now = clock::now()) const;
+
+        // time until requests may be sent again, zero if they are not blocked
+        clock::duration blockedFor(clock::time_point now = clock::now()) const;
+
+        // Counters
+        unsigned usedWeight() const;
+        unsigned long long rejections() const;
+
+    private:
+        mutable std::mutex _mutex;
+        unsigned _weightLimit;
+        unsigned _usedWeight;
+        clock::time_point _reportedAt;      // time of the last weight report
+        clock::time_point _blockedUntil;
+        unsigned _backoffs;                 // blocking windows in a row started by rejections without Retry-After
+        unsigned long long _rejections;
+        std::minstd_rand _jitter;
+};
+
+#endif // rateLimiter_H
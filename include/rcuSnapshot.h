@@ -0,0 +1,96 @@
+#ifndef rcuSnapshot_H
+#define rcuSnapshot_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// class holds an immutable snapshot that readers access without locks or waiting
+// writers build a new snapshot on the side, swap it in with one atomic store and free the old one once no reader can see it
+template <typename T>
+class rcuSnapshot{
+    public:
+        // keeps the snapshot it was created with alive until it goes out of scope
+        class readGuard{
+            public:
+                explicit readGuard(const rcuSnapshot& owner) {
+                    // register on the current epoch before loading the pointer, writers wait for both epochs to drain
+                    unsigned epoch = owner._epoch.load() & 1;
+                    _readers = &owner._readers[epoch].count;
+                    _readers->fetch_add(1);
+                    _snapshot = owner._current.load();
+                }
+
+                ~readGuard() {
+                    _readers->fetch_sub(1);
+                }
+
+                readGuard(const readGuard&) = delete;
+                readGuard& operator=(const readGuard&) = delete;
+
+                const T* get() const { return _snapshot; }
+                const T& operator*() const { return *_snapshot; }
+                const T* operator->() const { return _snapshot; }
+
+            private:
+                std::atomic<long>* _readers;
+                const T* _snapshot;
+        };
+
+        rcuSnapshot() : _current(new T()), _epoch(0) {}
+
+        ~rcuSnapshot() {
+            delete _current.load();
+        }
+
+        rcuSnapshot(const rcuSnapshot&) = delete;
+        rcuSnapshot& operator=(const rcuSnapshot&) = delete;
+
+        // Get the current snapshot, never blocks
+        readGuard read() const {
+            return readGuard(*this);
+        }
+
+        // Replace the snapshot, returns once the old one is freed
+        void publish(std::unique_ptr<T> snapshot) {
+            std::lock_guard<std::mutex> lock(_writerMutex);
+            swapAndReclaim(std::move(snapshot));
+        }
+
+        // Copy the current snapshot, let fn change the copy and publish it
+        template <typename Fn>
+        void update(Fn&& fn) {
+            std::lock_guard<std::mutex> lock(_writerMutex);
+            std::unique_ptr<T> snapshot(new T(*_current.load()));
+            fn(*snapshot);
+            swapAndReclaim(std::move(snapshot));
+        }
+
+    private:
+        // caller holds _writerMutex
+        void swapAndReclaim(std::unique_ptr<T> snapshot) {
+            T* old = _current.exchange(snapshot.release());
+
+            // flip epoch twice and wait for the readers of each epoch, after that nobody can still hold the old pointer
+            for (int phase = 0; phase < 2; ++phase) {
+                unsigned previous = _epoch.fetch_add(1) & 1;
+                while (_readers[previous].count.load() != 0) {
+                    std::this_thread::yield();
+                }
+            }
+            delete old;
+        }
+
+        // reader counter on its own cache line
+        struct alignas(64) readerCount {
+            std::atomic<long> count{0};
+        };
+
+        std::atomic<T*> _current;
+        std::atomic<unsigned> _epoch;
+        mutable readerCount _readers[2];
+        std::mutex _writerMutex;
+};
+
+#endif // rcuSnapshot_H
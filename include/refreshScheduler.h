@@ -0,0 +1,59 @@
+#ifndef refreshScheduler_H
+#define refreshScheduler_H
+
+#include <array>
+#include <chrono>
+#include <mutex>
+
+#include "marketRegistry.h"
+#include "rateLimiter.h"
+
+// decides when each market is polled next
+// the interval shrinks when a refresh changed symbols and grows while they stay the same, between min and max
+// it is stretched when more than half of the weight budget is used, and nothing is due while the rate limiter blocks requests
+class refreshScheduler{
+    public:
+        using clock = std::chrono::steady_clock;
+
+        explicit refreshScheduler(const rateLimiter&);
+
+        // Set interval markets start with and the bounds it adapts within, keeps the state of the markets
+        void configure(std::chrono::seconds base, std::chrono::seconds min, std::chrono::seconds max);
+
+        // Markets out of candidates whose refresh is due, as marketRegistry bits, they are marked in flight
+        unsigned due(unsigned candidates, clock::time_point now = clock::now());
+
+        // Request of market was sent
+        void dispatched(size_t, clock::time_point now = clock::now());
+
+        // Refresh of market finished, changed tells if its symbols differed from the previous refresh
+        void completed(size_t, bool changed, clock::time_point now = clock::now());
+
+        // Refresh of market failed, it is tried again after its interval or when the rate limiter allows it
+        void failed(size_t, clock::time_point now = clock::now());
+
+        // time until the next market is due, at least the time requests are blocked
+        clock::duration untilNext(clock::time_point now = clock::now()) const;
+
+        // current poll interval of market
+        clock::duration interval(size_t) const;
+
+    private:
+        struct marketSchedule {
+            clock::duration interval{};     // zero until the market is scheduled for the first time
+            clock::time_point next;
+        };
+
+        // interval stretched by the used part of the weight budget, caller holds the mutex
+        clock::duration budgeted(clock::duration, clock::time_point) const;
+
+        const rateLimiter& _limiter;
+        mutable std::mutex _mutex;
+        clock::duration _base;
+        clock::duration _min;
+        clock::duration _max;
+        unsigned _scheduled;        // bits of markets that were dispatched at least once
+        std::array<marketSchedule, marketRegistry::maxMarkets> _markets;
+};
+
+#endif // refreshScheduler_H
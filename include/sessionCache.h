@@ -0,0 +1,71 @@
+#ifndef sessionCache_H
+#define sessionCache_H
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "boost/asio/ip/tcp.hpp"
+#include "boost/asio/ssl.hpp"
+
+// counters to check that cached resolution and tls resumption work
+struct connectionStats {
+    unsigned long long dnsHits;
+    unsigned long long dnsMisses;
+    unsigned long long resumedHandshakes;
+    unsigned long long fullHandshakes;
+};
+
+// class caches resolved endpoints with a ttl and tls sessions per host so reconnects skip dns and the full handshake
+class sessionCache{
+    public:
+        explicit sessionCache(std::chrono::seconds dnsTtl = std::chrono::seconds(60));
+        ~sessionCache();
+
+        sessionCache(const sessionCache&) = delete;
+        sessionCache& operator=(const sessionCache&) = delete;
+
+        // Set how long resolved endpoints are used
+        void setDnsTtl(std::chrono::seconds);
+
+        // Get endpoints of host resolved within the ttl, counts a hit or a miss
+        bool findEndpoints(const std::string&, const std::string&, boost::asio::ip::tcp::resolver::results_type&);
+
+        // Store endpoints of host
+        void storeEndpoints(const std::string&, const std::string&, const boost::asio::ip::tcp::resolver::results_type&);
+
+        // Drop endpoints of host, e.g. after connecting to them failed
+        void forgetEndpoints(const std::string&, const std::string&);
+
+        // Set the cached tls session of host on a new connection before the handshake
+        void applyTlsSession(const std::string&, const std::string&, SSL*);
+
+        // Remember tls session of an established connection
+        void storeTlsSession(const std::string&, const std::string&, SSL*);
+
+        // Count a completed handshake
+        void countHandshake(bool);
+
+        // Current counter values
+        connectionStats getStats() const;
+
+    private:
+        struct endpointsEntry {
+            boost::asio::ip::tcp::resolver::results_type endpoints;
+            std::chrono::steady_clock::time_point expiry;
+        };
+
+        std::mutex _mutex;
+        std::chrono::seconds _dnsTtl;
+        std::map<std::string, endpointsEntry> _endpoints;
+        std::map<std::string, SSL_SESSION*> _tlsSessions;
+
+        std::atomic<unsigned long long> _dnsHits;
+        std::atomic<unsigned long long> _dnsMisses;
+        std::atomic<unsigned long long> _resumedHandshakes;
+        std::atomic<unsigned long long> _fullHandshakes;
+};
+
+#endif // sessionCache_H
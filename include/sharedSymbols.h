@@ -0,0 +1,48 @@
+#ifndef sharedSymbols_H
+#define sharedSymbols_H
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "symbolTable.h"
+#include "sharedSymbolsLayout.h"
+
+// publishes symbol tables into a named POSIX shared memory segment for other processes on the host
+// the segment holds two buffers, each publication fills the one readers are not using and then switches them over
+// readers use sharedSymbolsClient and never take a lock
+class sharedSymbols{
+    public:
+        sharedSymbols();
+        ~sharedSymbols();
+
+        sharedSymbols(const sharedSymbols&) = delete;
+        sharedSymbols& operator=(const sharedSymbols&) = delete;
+
+        // Create or reopen segment name (e.g. "/binance_symbols") with buffers of bufferSize bytes
+        // a segment of the same size left by a previous run is reused so mapped readers keep working
+        bool open(const std::string&, size_t);
+
+        // Write tables into the spare buffer and make it current, returns false if they do not fit
+        bool publish(const std::vector<std::pair<std::string, const symbolTable*>>&);
+
+        // check if a segment is open
+        bool isOpen() const;
+
+        // number of publications in the segment
+        uint64_t generation() const;
+
+        // Unmap segment, it stays in place for readers
+        void close();
+
+        // Remove segment name from the system, mapped readers keep their mapping
+        static bool remove(const std::string&);
+
+    private:
+        sharedHeader* _header;
+        size_t _mappedSize;
+        std::string _staging;   // publication is built here and copied in one go to keep the write window short
+};
+
+#endif // sharedSymbols_H
@@ -0,0 +1,63 @@
+#ifndef sharedSymbolsClient_H
+#define sharedSymbolsClient_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "utils.h"
+#include "fixedDecimal.h"
+#include "sharedSymbolsLayout.h"
+
+// read-only view of the symbol tables published by sharedSymbols in another process
+// lookups run directly on the shared buffer without locks or copies of the table, only the result is copied out
+// a lookup that overlaps a publication into the same buffer is retried
+class sharedSymbolsClient{
+    public:
+        sharedSymbolsClient();
+        ~sharedSymbolsClient();
+
+        sharedSymbolsClient(const sharedSymbolsClient&) = delete;
+        sharedSymbolsClient& operator=(const sharedSymbolsClient&) = delete;
+
+        // Map segment name read-only, returns false if it does not exist or has an unknown layout
+        bool open(const std::string&);
+
+        // Get tickSize and stepSize of symbol in market, returns false if it is not published
+        bool findFilters(std::string_view, std::string_view, fixedDecimal&, fixedDecimal&) const;
+
+        // Get all fields of symbol in market, returns false if it is not published
+        bool find(std::string_view, std::string_view, symbolInfo&) const;
+
+        // number of publications seen in the segment, changes whenever the tables change
+        uint64_t generation() const;
+
+        // lookups repeated because a publication overlapped them
+        unsigned long long retryCount() const;
+
+        void close();
+
+    private:
+        // fields of one symbol copied out of the buffer
+        struct symbolCopy {
+            uint64_t tickSize;
+            uint64_t stepSize;
+            uint8_t nameLength;
+            uint8_t quoteAssetLength;
+            uint8_t statusLength;
+            char text[3 * 255];
+        };
+
+        // Run lookup of symbol in market against the current buffer until it is not overlapped by a publication
+        bool lookup(std::string_view, std::string_view, symbolCopy&, bool) const;
+
+        // Look up symbol in one buffer, every offset is checked because the buffer may change underneath
+        bool lookupInBuffer(const char*, std::string_view, std::string_view, symbolCopy&, bool) const;
+
+        const sharedHeader* _header;
+        size_t _mappedSize;
+        mutable unsigned long long _retries;
+};
+
+#endif // sharedSymbolsClient_H
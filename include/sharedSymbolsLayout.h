@@ -0,0 +1,59 @@
+#ifndef sharedSymbolsLayout_H
+#define sharedSymbolsLayout_H
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+// layout of the shared memory segment the symbol tables are published to, used by sharedSymbols and sharedSymbolsClient
+// segment: 64 byte header, then two buffers of bufferSize bytes, the publisher writes the one readers are not on
+// buffer: marketCount, then marketCount sharedMarket entries, then the hash slots, records and strings of every market
+// every offset is in bytes from the start of its buffer
+
+static const char sharedSymbolsMagic[8] = {'B', 'X', 'S', 'H', 'M', '\0', '\0', '\1'};
+static constexpr uint32_t sharedSymbolsVersion = 1;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared counters must be lock free to work across processes");
+
+struct sharedHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t bufferSize;                // bytes in each of the two buffers
+    std::atomic<uint64_t> generation;   // number of publications, buffer generation & 1 is the current one
+    std::atomic<uint64_t> sequence[2];  // seqlock of each buffer, odd while it is being written
+    char reserved[24];
+};
+static_assert(sizeof(sharedHeader) == 64, "shared header is 64 bytes");
+
+struct sharedMarket {
+    char name[16];          // zero padded
+    uint32_t slotCount;     // power of two
+    uint32_t recordCount;
+    uint32_t slotsOffset;   // slotCount uint32_t, record index + 1 or 0 for an empty slot
+    uint32_t recordsOffset; // recordCount sharedRecord
+};
+
+struct sharedRecord {
+    uint64_t tickSize;      // fixedDecimal::packed()
+    uint64_t stepSize;
+    uint32_t nameOffset;
+    uint32_t quoteAssetOffset;
+    uint32_t statusOffset;
+    uint8_t nameLength;
+    uint8_t quoteAssetLength;
+    uint8_t statusLength;
+    uint8_t reserved;
+};
+static_assert(sizeof(sharedRecord) == 32, "shared record is 32 bytes");
+
+// hash of symbol names in the slots, fnv-1a so every process computes the same value
+inline uint32_t sharedSymbolHash(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash ^= uint8_t(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+#endif // sharedSymbolsLayout_H
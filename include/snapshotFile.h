@@ -0,0 +1,31 @@
+#ifndef snapshotFile_H
+#define snapshotFile_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "symbolTable.h"
+
+// symbol table of one market as stored in a snapshot file
+struct snapshotMarket {
+    std::string market;
+    std::unique_ptr<symbolTable> symbols;
+};
+
+// binary file holding the symbol tables of all markets, rewritten after each refresh and mapped at startup
+// layout: 32 byte header (magic, format version, market count, write time, checksum of the rest),
+// then per market its name and symbol count followed by the symbols
+class snapshotFile{
+    public:
+        static constexpr uint32_t formatVersion = 1;
+
+        // Write tables to file, goes through a temporary file and a rename so readers never see half a file
+        static bool save(const std::string&, const std::vector<std::pair<std::string, const symbolTable*>>&, int64_t);
+
+        // Map file and rebuild the tables stored in it, writtenAtMs is the time the file was saved
+        static bool load(const std::string&, std::vector<snapshotMarket>&, int64_t&);
+};
+
+#endif // snapshotFile_H
@@ -0,0 +1,46 @@
+#ifndef snapshotWriter_H
+#define snapshotWriter_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// class runs the snapshot save from a background thread so refreshes never wait for the disk
+// requests made while a save is running are coalesced into one more save, the thread starts with the first request
+class snapshotWriter{
+    public:
+        explicit snapshotWriter(std::function<bool()>);
+        ~snapshotWriter();
+
+        snapshotWriter(const snapshotWriter&) = delete;
+        snapshotWriter& operator=(const snapshotWriter&) = delete;
+
+        // Ask for a save of the current tables, returns at once
+        void request();
+
+        // Wait until every requested save is done
+        void flush();
+
+        // Do the save still requested and stop the thread
+        void stop();
+
+        // number of saves done
+        unsigned long long saves() const;
+
+    private:
+        // writer thread loop
+        void run();
+
+        std::function<bool()> _save;
+        std::thread _writerThread;
+        mutable std::mutex _mutex;
+        std::condition_variable _wakeWriter;
+        std::condition_variable _saved;
+        bool _requested;
+        bool _saving;
+        bool _stop;
+        unsigned long long _saves;
+};
+
+#endif // snapshotWriter_H
@@ -0,0 +1,46 @@
+#ifndef stringInterner_H
+#define stringInterner_H
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// class maps a small set of repeated strings (quote assets, statuses) to 16 bit ids
+// ids never change once handed out, looking an id up is lock-free so readers of published snapshots never wait
+class stringInterner{
+    public:
+        // id 0 is always "", the given strings get ids 1, 2, ... in order
+        explicit stringInterner(std::initializer_list<const char*> = {});
+        ~stringInterner();
+
+        stringInterner(const stringInterner&) = delete;
+        stringInterner& operator=(const stringInterner&) = delete;
+
+        // Get id of string, adds it if it is new, returns false and logs an error once all ids are used up
+        bool intern(std::string_view, uint16_t&);
+
+        // Get id of string without adding it
+        bool find(std::string_view, uint16_t&) const;
+
+        // Get string of an id handed out before
+        const std::string& lookup(uint16_t) const;
+
+        // number of ids handed out, including the one of ""
+        size_t size() const;
+
+    private:
+        static constexpr size_t chunkSize = 256;
+        static constexpr size_t chunkCount = 256;
+
+        // strings are stored in chunks that never move, new chunks are published with a release store
+        std::atomic<std::string*> _chunks[chunkCount];
+        std::atomic<size_t> _size;
+        mutable std::mutex _mutex;
+        std::unordered_map<std::string_view, uint16_t> _ids;   // keys point into the chunks
+};
+
+#endif // stringInterner_H
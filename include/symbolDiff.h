@@ -0,0 +1,39 @@
+#ifndef symbolDiff_H
+#define symbolDiff_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "utils.h"
+#include "symbolTable.h"
+
+// kind of change of one symbol
+enum class changeType : uint8_t { added, removed, changed };
+
+// bits of symbolChange::fields
+static const unsigned statusField = 1;
+static const unsigned quoteAssetField = 2;
+static const unsigned tickSizeField = 4;
+static const unsigned stepSizeField = 8;
+
+// one symbol that was added, removed or changed by a refresh
+struct symbolChange {
+    uint64_t sequence;      // position in the change log
+    changeType type;
+    unsigned fields;        // fields that differ, all of them for added and removed
+    std::string market;
+    symbolInfo before;      // empty for added
+    symbolInfo after;       // empty for removed
+};
+
+// Digest of the fields kept from a response, equal digests mean there is nothing to apply
+uint64_t symbolsDigest(const std::vector<symbolInfo>&);
+
+// Compare fresh symbols of market with its current table
+void diffSymbols(const symbolTable&, const std::vector<symbolInfo>&, const std::string&, std::vector<symbolChange>&);
+
+// Apply changes found by diffSymbols to a copy of the table
+void applyChanges(symbolTable&, const std::vector<symbolChange>&);
+
+#endif // symbolDiff_H
@@ -0,0 +1,172 @@
+#ifndef symbolTable_H
+#define symbolTable_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils.h"
+#include "fixedDecimal.h"
+#include "stringInterner.h"
+
+// trading status of spot symbols and contract status of futures, values are the interned ids of their names
+enum class symbolStatus : uint16_t {
+    none = 0, preTrading, trading, postTrading, endOfDay, halt, auctionMatch, onBreak,
+    pendingTrading, preDelivering, delivering, delivered, preSettle, settling, close
+};
+
+// strings shared by the symbol tables of all markets, known statuses are interned first so their ids match symbolStatus
+stringInterner& symbolStrings();
+
+// compact symbol record, 32 bytes instead of five std::strings
+struct symbolRecord {
+    fixedDecimal tickSize;
+    fixedDecimal stepSize;
+    uint32_t nameOffset;    // symbol name in the name arena of the table
+    uint16_t nameLength;
+    uint16_t quoteAsset;    // id in symbolStrings()
+    uint16_t status;        // id in symbolStrings(), equal to a symbolStatus value for known statuses
+    bool live;              // false once erased, the slot is reused by the next insert
+};
+
+// symbols of one market, records sit in one contiguous array found through an open addressing hash index
+// secondary indexes by quote asset, by status and by name order are kept up to date on every change
+// record indices stay valid until the record is erased
+class symbolTable{
+    public:
+        symbolTable();
+
+        // Make room for a number of symbols
+        void reserve(size_t);
+
+        // Insert symbol or replace the one with the same name, returns true if it was new
+        // false also when it is rejected because its name, quote asset or status can not be stored
+        bool insert(const symbolInfo&);
+
+        // Insert symbol from already parsed fields, returns true if it was new, false as well if it is rejected
+        bool insertRecord(std::string_view, std::string_view, std::string_view, const fixedDecimal&, const fixedDecimal&);
+
+        // Get symbol by name, returns false if it is not in the table
+        bool find(std::string_view, symbolInfo&) const;
+
+        // Get record by name, nullptr if it is not in the table
+        const symbolRecord* findRecord(std::string_view) const;
+
+        // check if symbol is in the table
+        bool contains(std::string_view) const;
+
+        // Change status of a symbol in the table, returns false if it is not in the table or the status can not be stored
+        bool setStatus(std::string_view, std::string_view);
+
+        // Remove symbol, returns false if it was not in the table
+        bool erase(std::string_view);
+
+        // number of symbols
+        size_t size() const;
+
+        // Name of a record
+        std::string_view name(const symbolRecord&) const;
+
+        // Expand record into its string form
+        symbolInfo toSymbolInfo(const symbolRecord&) const;
+
+        // Call fn with every record in the table
+        template <typename Fn>
+        void forEach(Fn&& fn) const {
+            for (const auto& record : _records) {
+                if (record.live) {
+                    fn(record);
+                }
+            }
+        }
+
+        // Call fn with every record of quoteAsset and status, "" matches any value
+        // records come in name order when neither is given, otherwise in no particular order
+        template <typename Fn>
+        void forEachMatching(std::string_view quoteAsset, std::string_view status, Fn&& fn) const {
+            uint16_t quoteAssetId = 0, statusId = 0;
+            if ((!quoteAsset.empty() && !symbolStrings().find(quoteAsset, quoteAssetId))
+                || (!status.empty() && !symbolStrings().find(status, statusId))) {
+                return;
+            }
+            if (quoteAsset.empty() && status.empty()) {
+                for (uint32_t index : _byName) {
+                    fn(_records[index]);
+                }
+                return;
+            }
+
+            // walk the smaller of the two buckets and check the other field
+            const std::vector<uint32_t>* quoteAssetBucket = quoteAsset.empty() ? nullptr : bucket(_byQuoteAsset, quoteAssetId);
+            const std::vector<uint32_t>* statusBucket = status.empty() ? nullptr : bucket(_byStatus, statusId);
+            const std::vector<uint32_t>* smaller = !statusBucket || (quoteAssetBucket && quoteAssetBucket->size() < statusBucket->size())
+                                                 ? quoteAssetBucket : statusBucket;
+            for (uint32_t index : *smaller) {
+                const symbolRecord& record = _records[index];
+                if ((quoteAsset.empty() || record.quoteAsset == quoteAssetId) && (status.empty() || record.status == statusId)) {
+                    fn(record);
+                }
+            }
+        }
+
+        // Call fn with every record whose name starts with prefix, in name order
+        template <typename Fn>
+        void forEachWithPrefix(std::string_view prefix, Fn&& fn) const {
+            for (auto it = lowerBound(prefix); it != _byName.end(); ++it) {
+                const symbolRecord& record = _records[*it];
+                if (name(record).substr(0, prefix.size()) != prefix) {
+                    break;
+                }
+                fn(record);
+            }
+        }
+
+        // heap bytes held by the table
+        size_t memoryUsage() const;
+
+    private:
+        static constexpr uint32_t emptySlot = 0;
+        static constexpr uint32_t erasedSlot = 0xFFFFFFFF;
+
+        // Get slot of name, or the slot to insert it into if it is not there
+        size_t findSlot(std::string_view, bool&) const;
+
+        // Rebuild the index with the given number of slots, drops erased slots
+        void rehash(size_t);
+
+        // Copy the names of live records into a new arena, drops the names of erased ones
+        void compactNames();
+
+        // First position in _byName whose name is not less than symbol
+        std::vector<uint32_t>::const_iterator lowerBound(std::string_view) const;
+
+        // Add record to / remove record from the bucket of id, positions remember where each record sits in its bucket
+        static void addToIndex(std::vector<std::vector<uint32_t>>&, std::vector<uint32_t>&, uint16_t, uint32_t);
+        static void removeFromIndex(std::vector<std::vector<uint32_t>>&, std::vector<uint32_t>&, uint16_t, uint32_t);
+
+        // Bucket of id, an empty one if nothing was ever indexed under it
+        static const std::vector<uint32_t>* bucket(const std::vector<std::vector<uint32_t>>& index, uint16_t id) {
+            static const std::vector<uint32_t> none;
+            return id < index.size() ? &index[id] : &none;
+        }
+
+        std::vector<symbolRecord> _records;
+        std::vector<uint32_t> _freeRecords;     // indices of erased records
+        std::vector<char> _names;               // symbol names back to back
+        size_t _deadNameBytes;                  // bytes of _names held by erased records
+        std::vector<uint32_t> _slots;           // record index + 1, or emptySlot / erasedSlot
+
+        // secondary indexes, record indices of live records
+        std::vector<uint32_t> _byName;                      // sorted by name
+        std::vector<std::vector<uint32_t>> _byQuoteAsset;   // bucket per interned quote asset
+        std::vector<std::vector<uint32_t>> _byStatus;       // bucket per interned status
+        std::vector<uint32_t> _quoteAssetPositions;         // position of each record in its quote asset bucket
+        std::vector<uint32_t> _statusPositions;             // position of each record in its status bucket
+        size_t _size;
+        size_t _usedSlots;                      // live and erased slots
+};
+
+#endif // symbolTable_H
@@ -1,7 +1,16 @@
 #ifndef utils_H
 #define utils_H
 
+#include <map>
 #include <string>
+#include <vector>
+
+// market added in config.json next to the three built-in ones
+struct marketEndpoint{
+    std::string name;       // market_type used in queries
+    std::string baseUrl;
+    std::string endpoint;
+};
 
 // struct to store base url and endpoints info
 struct urlInfo{
@@ -12,6 +21,18 @@ struct urlInfo{
     std::string usdFutureEndpoint;
     std::string coinFutureEndpoint;
     int requestInterval;
+    int dnsCacheTtl = 60;   // seconds resolved endpoints are reused
+    bool warmUp = true;     // fetch all markets at startup instead of after the first interval
+    std::vector<marketEndpoint> additionalMarkets;
+    std::map<std::string, std::vector<std::string>> alternateHosts;    // market name -> further base urls serving it
+    double hedgePercentile = 95;        // next host gets the request when the first misses this percentile of its refresh time, 0 only fails over
+    int hedgeMinDelayMs = 50;
+    int hedgeDefaultDelayMs = 2000;     // hedge delay while the host has too few samples
+    unsigned weightLimit = 6000;        // request weight per minute the exchange allows the ip
+    int minRequestInterval = 5;         // seconds, bounds the poll interval of a market adapts within
+    int maxRequestInterval = 300;
+    size_t ioThreads = 1;               // threads running the io_context, the markets are fetched and parsed in parallel
+    std::vector<int> ioCpuAffinity;     // cpus the io threads are pinned to, empty leaves it to the os
 };
 
 // struct to store logging info from config.json
@@ -19,8 +40,47 @@ struct logsInfo {
     std::string level;
     bool file;
     bool console;
+    bool async = false;             // format and write log lines on a background thread
+    size_t queueSize = 8192;        // preallocated slots of the async queue
+    std::string overflow = "block"; // full queue: "block" waits for a slot, "drop" overwrites the oldest line
+    int flushInterval = 1;          // seconds between flushes of the async logger, warnings and errors are flushed right away
 }; 
 
+// what readQuery does with queries until every market has its first snapshot
+enum class readyMode { serve, wait, notReady };
+
+// what happens to a query of the query file or the query server before it runs
+enum class queryAdmission { execute, duplicate, notReady };
+
+// one query of the query file
+struct parsedQuery {
+    unsigned long long id;
+    std::string market;
+    std::string symbol;
+    std::string type;       // GET, UPDATE, DELETE, LIST, FILTER or PREFIX
+    std::string status;     // new status of UPDATE, status to match for FILTER
+    std::string quoteAsset; // quote asset to match for FILTER
+};
+
+// struct to store query file info from config.json
+struct queryInfo {
+    std::string queryFile = "query.json";
+    bool watchFile = true;      // use inotify instead of polling the query file
+    size_t dedupCapacity = 1000000; // max number of query ids remembered out of order for de-duplication
+    std::string answersFile = "answers.json";
+    bool answersNdjson = false; // append one answer per line instead of keeping a json array
+    readyMode untilReady = readyMode::serve;    // serve queries at once, wait for all markets or answer "not ready"
+    int readyTimeout = 30;      // seconds to wait for all markets before serving anyway, 0 waits forever
+    std::string serverSocket;   // unix socket of the query server, "" disables it
+    int serverPort = 0;         // loopback tcp port of the query server, 0 disables it
+};
+
+// counters of refreshes skipped because nothing changed and of refreshes that were applied
+struct refreshStats {
+    unsigned long long unchanged;
+    unsigned long long changed;
+};
+
 // struct symbolInfo to store required data of symbols
 struct symbolInfo{
     std::string symbol; 
@@ -0,0 +1,410 @@
+#include "mockServer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <optional>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+
+#include "boost/asio/steady_timer.hpp"
+#include "boost/asio/strand.hpp"
+#include "boost/beast/core.hpp"
+#include "boost/beast/http.hpp"
+#include "boost/beast/version.hpp"
+#include "spdlog/spdlog.h"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+namespace ssl = boost::asio::ssl;
+using tcp = boost::asio::ip::tcp;
+
+// read PEM text out of a memory BIO
+static std::string bioToString(BIO* bio) {
+    char* data = nullptr;
+    long length = BIO_get_mem_data(bio, &data);
+    return std::string(data, length);
+}
+
+// create a self-signed certificate for localhost and 127.0.0.1
+static void makeSelfSignedCertificate(std::string& certificatePem, std::string& keyPem) {
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY_CTX* keyCtx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    EVP_PKEY_keygen_init(keyCtx);
+    EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keyCtx, NID_X9_62_prime256v1);
+    EVP_PKEY_keygen(keyCtx, &key);
+    EVP_PKEY_CTX_free(keyCtx);
+
+    X509* certificate = X509_new();
+    X509_set_version(certificate, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+    X509_gmtime_adj(X509_getm_notBefore(certificate), -3600);
+    X509_gmtime_adj(X509_getm_notAfter(certificate), 3600L * 24 * 365);
+    X509_set_pubkey(certificate, key);
+
+    X509_NAME* name = X509_get_subject_name(certificate);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(certificate, name);
+
+    X509V3_CTX extensionCtx;
+    X509V3_set_ctx_nodb(&extensionCtx);
+    X509V3_set_ctx(&extensionCtx, certificate, certificate, nullptr, nullptr, 0);
+    X509_EXTENSION* altNames = X509V3_EXT_conf_nid(nullptr, &extensionCtx, NID_subject_alt_name, "DNS:localhost,IP:127.0.0.1");
+    X509_add_ext(certificate, altNames, -1);
+    X509_EXTENSION_free(altNames);
+    X509_EXTENSION* basicConstraints = X509V3_EXT_conf_nid(nullptr, &extensionCtx, NID_basic_constraints, "critical,CA:TRUE");
+    X509_add_ext(certificate, basicConstraints, -1);
+    X509_EXTENSION_free(basicConstraints);
+
+    X509_sign(certificate, key, EVP_sha256());
+
+    BIO* certificateBio = BIO_new(BIO_s_mem());
+    PEM_write_bio_X509(certificateBio, certificate);
+    certificatePem = bioToString(certificateBio);
+    BIO_free(certificateBio);
+
+    BIO* keyBio = BIO_new(BIO_s_mem());
+    PEM_write_bio_PrivateKey(keyBio, key, nullptr, nullptr, 0, nullptr, nullptr);
+    keyPem = bioToString(keyBio);
+    BIO_free(keyBio);
+
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+}
+
+// one accepted client connection, answers requests until the client or the server closes it
+class mockServer::connection : public std::enable_shared_from_this<mockServer::connection>
+{
+    public:
+        connection(tcp::socket&& socket, ssl::context& ctx, mockServer& server)
+        : _stream(std::move(socket), ctx), _server(server), _timer(_stream.get_executor()), _offset(0) {}
+
+        void run() {
+            _stream.async_handshake(ssl::stream_base::server, beast::bind_front_handler(&connection::onHandshake, shared_from_this()));
+        }
+
+    private:
+        void onHandshake(beast::error_code ec) {
+            if (ec) {
+                return;
+            }
+            ++_server._handshakes;
+            doRead();
+        }
+
+        void doRead() {
+            _req = {};
+            http::async_read(_stream, _buffer, _req, beast::bind_front_handler(&connection::onRead, shared_from_this()));
+        }
+
+        void onRead(beast::error_code ec, std::size_t) {
+            if (ec) {
+                return doClose();
+            }
+            ++_server._requests;
+
+            _body.reset();
+            {
+                std::lock_guard<std::mutex> lock(_server._responsesMutex);
+                auto it = _server._responses.find(std::string(_req.target()));
+                if (it != _server._responses.end()) {
+                    _body = it->second;
+                }
+            }
+            bool found = _body != nullptr;
+            if (!found) {
+                _body = std::make_shared<const std::string>("{\"code\":-1,\"msg\":\"not found\"}");
+            }
+
+            // take one of the pending rejections, answered like the exchange does when the ip is over its limit
+            size_t pending = _server._rejections.load();
+            while (pending > 0 && !_server._rejections.compare_exchange_weak(pending, pending - 1)) {}
+            bool rejected = pending > 0;
+            if (rejected) {
+                _body = std::make_shared<const std::string>("{\"code\":-1003,\"msg\":\"Too many requests\"}");
+            }
+
+            _res = {};
+            _res.version(_req.version());
+            _res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+            _res.set(http::field::content_type, "application/json");
+            _res.result(found ? http::status::ok : http::status::not_found);
+            if (rejected) {
+                // 418 has no name in http::status, set it as a number
+                _res.result(_server._rejectStatus.load());
+                if (_server._retryAfter > 0) {
+                    _res.set(http::field::retry_after, std::to_string(_server._retryAfter));
+                }
+            }
+            unsigned weight = _server._requestWeight;
+            if (weight > 0) {
+                _res.set("X-MBX-USED-WEIGHT-1M", std::to_string(_server._usedWeight += weight));
+            }
+            _res.keep_alive(_req.keep_alive() && _server._keepAlive);
+
+            // answer after the configured latency
+            long long latencyUs = _server._latencyUs;
+            if (latencyUs <= 0) {
+                return writeResponse();
+            }
+            _timer.expires_after(std::chrono::microseconds(latencyUs));
+            _timer.async_wait([self = shared_from_this()](beast::error_code ec) {
+                if (!ec) {
+                    self->writeResponse();
+                }
+            });
+        }
+
+        void writeResponse() {
+            size_t chunkSize = _server._chunkSize;
+            if (chunkSize == 0) {
+                _res.body() = *_body;
+                _res.prepare_payload();
+                return http::async_write(_stream, _res, beast::bind_front_handler(&connection::onWrite, shared_from_this()));
+            }
+
+            // header first, then the body piece by piece as chunks
+            _header = {};
+            _header.version(_res.version());
+            _header.result(_res.result());
+            _header.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+            _header.set(http::field::content_type, "application/json");
+            _header.keep_alive(_res.keep_alive());
+            _header.chunked(true);
+            _serializer.emplace(_header);
+            _offset = 0;
+            http::async_write_header(_stream, *_serializer, beast::bind_front_handler(&connection::onChunk, shared_from_this()));
+        }
+
+        void onChunk(beast::error_code ec, std::size_t) {
+            if (ec) {
+                return;
+            }
+            if (_offset == _body->size()) {
+                return net::async_write(_stream, http::make_chunk_last(), beast::bind_front_handler(&connection::onWrite, shared_from_this()));
+            }
+
+            long long intervalUs = _offset == 0 ? 0 : _server._chunkIntervalUs.load();
+            if (intervalUs <= 0) {
+                return writeChunk();
+            }
+            _timer.expires_after(std::chrono::microseconds(intervalUs));
+            _timer.async_wait([self = shared_from_this()](beast::error_code ec) {
+                if (!ec) {
+                    self->writeChunk();
+                }
+            });
+        }
+
+        void writeChunk() {
+            size_t length = std::min(_server._chunkSize.load(), _body->size() - _offset);
+            net::const_buffer chunk(_body->data() + _offset, length);
+            _offset += length;
+            net::async_write(_stream, http::make_chunk(chunk), beast::bind_front_handler(&connection::onChunk, shared_from_this()));
+        }
+
+        void onWrite(beast::error_code ec, std::size_t) {
+            if (ec) {
+                return;
+            }
+            if (!_res.keep_alive()) {
+                return doClose();
+            }
+            doRead();
+        }
+
+        void doClose() {
+            _stream.async_shutdown([self = shared_from_this()](beast::error_code) {});
+        }
+
+        ssl::stream<beast::tcp_stream> _stream;
+        mockServer& _server;
+        beast::flat_buffer _buffer;
+        http::request<http::empty_body> _req;
+        http::response<http::string_body> _res;
+        net::steady_timer _timer;
+
+        // body of the current response, shared with the server so setResponse can replace it meanwhile
+        std::shared_ptr<const std::string> _body;
+
+        // chunked response
+        http::response<http::empty_body> _header;
+        std::optional<http::response_serializer<http::empty_body>> _serializer;
+        size_t _offset;
+};
+
+mockServer::mockServer()
+: _ctx(ssl::context::tls_server), _acceptor(_ioc), _port(0), _keepAlive(true), _latencyUs(0), _chunkSize(0), _chunkIntervalUs(0),
+  _requestWeight(0), _usedWeight(0), _rejections(0), _rejectStatus(429), _retryAfter(0), _connections(0), _handshakes(0), _requests(0) {
+    std::string keyPem;
+    makeSelfSignedCertificate(_certificate, keyPem);
+    _ctx.use_certificate_chain(net::buffer(_certificate));
+    _ctx.use_private_key(net::buffer(keyPem), ssl::context::pem);
+}
+
+mockServer::~mockServer() {
+    stop();
+}
+
+void mockServer::setResponse(const std::string& target, const std::string& body) {
+    std::lock_guard<std::mutex> lock(_responsesMutex);
+    _responses[target] = std::make_shared<const std::string>(body);
+}
+
+bool mockServer::setResponseFromFile(const std::string& target, const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    std::string body;
+    char buffer[65536];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        body.append(buffer, length);
+    }
+    fclose(file);
+    setResponse(target, body);
+    return true;
+}
+
+void mockServer::setKeepAlive(bool keepAlive) {
+    _keepAlive = keepAlive;
+}
+
+void mockServer::setRequestWeight(unsigned weight) {
+    _requestWeight = weight;
+}
+
+void mockServer::rejectRequests(size_t count, unsigned status, unsigned retryAfter) {
+    _rejectStatus = status;
+    _retryAfter = retryAfter;
+    _rejections = count;
+}
+
+void mockServer::setLatency(std::chrono::microseconds latency) {
+    _latencyUs = latency.count();
+}
+
+void mockServer::setChunking(size_t chunkSize, std::chrono::microseconds interval) {
+    _chunkSize = chunkSize;
+    _chunkIntervalUs = interval.count();
+}
+
+std::string mockServer::scalePayload(const std::string& payload, unsigned factor) {
+    size_t start = payload.find("\"symbols\":[");
+    if (factor <= 1 || start == std::string::npos) {
+        return payload;
+    }
+    start += 11;
+
+    // end of the symbols array, brackets inside strings do not count
+    size_t end = start;
+    int depth = 1;
+    bool inString = false;
+    for (; end < payload.size() && depth > 0; ++end) {
+        char c = payload[end];
+        if (inString) {
+            if (c == '\\') {
+                ++end;
+            }
+            else if (c == '"') {
+                inString = false;
+            }
+        }
+        else if (c == '"') {
+            inString = true;
+        }
+        else if (c == '[' || c == '{') {
+            ++depth;
+        }
+        else if (c == ']' || c == '}') {
+            --depth;
+        }
+    }
+    if (depth != 0) {
+        return payload;
+    }
+    --end;
+    std::string symbols = payload.substr(start, end - start);
+
+    std::string scaled = payload.substr(0, end);
+    for (unsigned copy = 1; copy < factor; ++copy) {
+        std::string suffix = "_" + std::to_string(copy);
+        scaled += symbols.empty() ? "" : ",";
+        // rename every "symbol":"<name>" of the copy
+        size_t last = 0;
+        for (size_t key = symbols.find("\"symbol\":\""); key != std::string::npos; key = symbols.find("\"symbol\":\"", last)) {
+            size_t nameEnd = symbols.find('"', key + 10);
+            if (nameEnd == std::string::npos) {
+                break;
+            }
+            scaled.append(symbols, last, nameEnd - last);
+            scaled += suffix;
+            last = nameEnd;
+        }
+        scaled.append(symbols, last, std::string::npos);
+    }
+    scaled.append(payload, end, std::string::npos);
+    return scaled;
+}
+
+unsigned short mockServer::start(unsigned short port, size_t threads) {
+    tcp::endpoint endpoint(net::ip::make_address("127.0.0.1"), port);
+    _acceptor.open(endpoint.protocol());
+    _acceptor.set_option(net::socket_base::reuse_address(true));
+    _acceptor.bind(endpoint);
+    _acceptor.listen(net::socket_base::max_listen_connections);
+    _port = _acceptor.local_endpoint().port();
+
+    doAccept();
+    for (size_t index = 0; index < (threads == 0 ? 1 : threads); ++index) {
+        _threads.emplace_back([this] { _ioc.run(); });
+    }
+    spdlog::debug("Mock server listening on 127.0.0.1:{}", _port);
+    return _port;
+}
+
+void mockServer::stop() {
+    if (_threads.empty()) {
+        return;
+    }
+    _ioc.stop();
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+    _threads.clear();
+    beast::error_code ec;
+    _acceptor.close(ec);
+}
+
+const std::string& mockServer::certificate() const {
+    return _certificate;
+}
+
+std::string mockServer::baseUrl() const {
+    return "localhost:" + std::to_string(_port);
+}
+
+size_t mockServer::connectionCount() const {
+    return _connections;
+}
+
+size_t mockServer::handshakeCount() const {
+    return _handshakes;
+}
+
+size_t mockServer::requestCount() const {
+    return _requests;
+}
+
+void mockServer::doAccept() {
+    _acceptor.async_accept(net::make_strand(_ioc), [this](beast::error_code ec, tcp::socket socket) {
+        if (ec) {
+            return;
+        }
+        ++_connections;
+        std::make_shared<connection>(std::move(socket), _ctx, *this)->run();
+        doAccept();
+    });
+}
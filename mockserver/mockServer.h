@@ -0,0 +1,98 @@
+#ifndef mockServer_H
+#define mockServer_H
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/asio/io_context.hpp"
+#include "boost/asio/ip/tcp.hpp"
+#include "boost/asio/ssl.hpp"
+
+// local HTTPS server with a self-signed certificate, answers GET requests with canned bodies
+// used by unit tests and benchmarks so they do not depend on the real exchange
+// replays responses recorded with exchangeInfo::setRecordDirectory, optionally delayed, chunked and scaled up
+class mockServer{
+    public:
+        mockServer();
+        ~mockServer();
+
+        mockServer(const mockServer&) = delete;
+        mockServer& operator=(const mockServer&) = delete;
+
+        // Set body returned for a request target
+        void setResponse(const std::string&, const std::string&);
+
+        // Set body returned for a request target from a recorded file, returns false if it cannot be read
+        bool setResponseFromFile(const std::string&, const std::string&);
+
+        // Wait before answering each request, simulates the round trip to the exchange
+        void setLatency(std::chrono::microseconds);
+
+        // Send bodies with chunked transfer encoding in chunks of size, waiting interval between chunks, 0 sends them in one piece
+        void setChunking(size_t, std::chrono::microseconds interval = std::chrono::microseconds(0));
+
+        // exchangeInfo response with its symbols repeated factor times, copies get the suffix _<copy> so names stay unique
+        static std::string scalePayload(const std::string&, unsigned);
+
+        // Allow clients to keep the connection open between requests
+        void setKeepAlive(bool);
+
+        // Add weight to the used weight of every request and report the total in X-MBX-USED-WEIGHT-1M, 0 sends no header
+        void setRequestWeight(unsigned);
+
+        // Answer the next count requests with status, 429 or 418, and Retry-After seconds, 0 sends no Retry-After
+        void rejectRequests(size_t, unsigned, unsigned retryAfter = 0);
+
+        // Listen on 127.0.0.1 and serve from threads, port 0 picks a free port, returns the port in use
+        unsigned short start(unsigned short port = 0, size_t threads = 1);
+
+        // Stop listening and close all connections
+        void stop();
+
+        // PEM certificate clients have to trust
+        const std::string& certificate() const;
+
+        // "localhost:<port>", usable as base url in urlInfo
+        std::string baseUrl() const;
+
+        // Counters
+        size_t connectionCount() const;
+        size_t handshakeCount() const;
+        size_t requestCount() const;
+
+    private:
+        class connection;
+
+        void doAccept();
+
+        boost::asio::io_context _ioc;
+        boost::asio::ssl::context _ctx;
+        boost::asio::ip::tcp::acceptor _acceptor;
+        std::vector<std::thread> _threads;
+        std::string _certificate;
+        unsigned short _port;
+
+        std::mutex _responsesMutex;
+        std::map<std::string, std::shared_ptr<const std::string>> _responses;
+        std::atomic<bool> _keepAlive;
+        std::atomic<long long> _latencyUs;
+        std::atomic<size_t> _chunkSize;
+        std::atomic<long long> _chunkIntervalUs;
+        std::atomic<unsigned> _requestWeight;
+        std::atomic<unsigned> _usedWeight;
+        std::atomic<size_t> _rejections;
+        std::atomic<unsigned> _rejectStatus;
+        std::atomic<unsigned> _retryAfter;
+
+        std::atomic<size_t> _connections;
+        std::atomic<size_t> _handshakes;
+        std::atomic<size_t> _requests;
+};
+
+#endif // mockServer_H
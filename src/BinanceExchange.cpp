@@ -1,122 +1,632 @@
 
 #include <vector>
 #include <mutex>
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <tuple>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "getHttpsData.h"
+#include "snapshotFile.h"
 #include "boost/asio/strand.hpp"
-#include "rapidjson/filewritestream.h"
+#include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/document.h"
 #include "rapidjson/filereadstream.h"
 #include "spdlog/spdlog.h"
+#include "spdlog/async.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/sinks/basic_file_sink.h"
 
-// mutex to protect access to shared maps
-std::mutex binanceExchangeMutex;
+static const size_t spotMarket = size_t(marketId::spot);
+static const size_t usdMarket = size_t(marketId::usdFutures);
+static const size_t coinMarket = size_t(marketId::coinFutures);
+
+// Change status of symbol in table and record the change event
+static void changeStatus(symbolTable& symbols, const char* market, const std::string& key, const std::string& newStatus, std::vector<symbolChange>& changes) {
+    symbolInfo before;
+    if (!symbols.find(key, before) || before.status == newStatus || !symbols.setStatus(key, newStatus)) {
+        return;
+    }
+    symbolInfo after = before;
+    after.status = newStatus;
+    changes.push_back(symbolChange{0, changeType::changed, statusField, market, std::move(before), std::move(after)});
+}
+
+// Write symbol as a json object straight from its compact record
+static void writeRecord(rapidjson::Writer<rapidjson::StringBuffer>& writer, const symbolTable& symbols, const symbolRecord& record) {
+    std::string_view name = symbols.name(record);
+    const std::string& quoteAsset = symbolStrings().lookup(record.quoteAsset);
+    const std::string& status = symbolStrings().lookup(record.status);
+    char text[fixedDecimal::maxChars];
+
+    writer.StartObject();
+    writer.Key("symbol");
+    writer.String(name.data(), name.size());
+    writer.Key("quoteAsset");
+    writer.String(quoteAsset.c_str(), quoteAsset.size());
+    writer.Key("status");
+    writer.String(status.c_str(), status.size());
+    writer.Key("tickSize");
+    writer.String(text, record.tickSize.toChars(text));
+    writer.Key("stepSize");
+    writer.String(text, record.stepSize.toChars(text));
+}
+
+// Write count, mean, percentiles and max of every stage of every host in microseconds
+static void writeLatencyStats(rapidjson::Writer<rapidjson::StringBuffer>& writer, const latencyStats& stats) {
+    writer.StartObject();
+    writer.Key("hosts");
+    writer.StartArray();
+    stats.forEachHost([&](const std::string& host, const latencyStats::histograms& histograms) {
+        writer.StartObject();
+        writer.Key("host");
+        writer.String(host.c_str(), host.size());
+        for (size_t stage = 0; stage < sessionTrace::stageCount; ++stage) {
+            const latencyHistogram& histogram = histograms[stage];
+            if (histogram.count() == 0) {
+                continue;
+            }
+            writer.Key(traceStageName(traceStage(stage)));
+            writer.StartObject();
+            writer.Key("count");
+            writer.Uint64(histogram.count());
+            writer.Key("meanUs");
+            writer.Uint64(histogram.mean() / 1000);
+            writer.Key("p50Us");
+            writer.Uint64(histogram.percentile(50) / 1000);
+            writer.Key("p90Us");
+            writer.Uint64(histogram.percentile(90) / 1000);
+            writer.Key("p99Us");
+            writer.Uint64(histogram.percentile(99) / 1000);
+            writer.Key("maxUs");
+            writer.Uint64(histogram.max() / 1000);
+            writer.EndObject();
+        }
+        writer.EndObject();
+    });
+    writer.EndArray();
+    writer.EndObject();
+}
+
+// Remove symbol from table and record the change event
+static void eraseSymbol(symbolTable& symbols, const char* market, const std::string& key, std::vector<symbolChange>& changes) {
+    symbolInfo before;
+    if (!symbols.find(key, before)) {
+        return;
+    }
+    symbols.erase(key);
+    changes.push_back(symbolChange{0, changeType::removed, statusField | quoteAssetField | tickSizeField | stepSizeField,
+                                   market, std::move(before), symbolInfo()});
+}
+
+// drop the pooled sessions of the exchange, pools of io_contexts destroyed before are already gone
+exchangeInfo::~exchangeInfo() {
+    std::lock_guard<std::mutex> lock(_poolsMutex);
+    for (connectionPool* pool : _pools) {
+        pool->release(this);
+    }
+}
+
+// copy of value named key, the tables find symbols by the name stored in the record
+static symbolInfo underKey(const std::string& key, const symbolInfo& value) {
+    symbolInfo record = value;
+    record.symbol = key;
+    return record;
+}
 
 // Getter for spotSymbols
 const symbolInfo exchangeInfo::getSpotSymbol(const std::string& key) const {
-    auto it = _spotSymbols.find(key);
-        return it->second;
+    return getSymbol<marketId::spot>(key);
 }
 
 // Setter for spotSymbols
 void exchangeInfo::setSpotSymbol(const std::string& key, const symbolInfo& value) {
-    _spotSymbols[key] = value;
+    setSymbol(spotMarket, key == value.symbol ? value : underKey(key, value));
 }
 
 // Getter for usdSymbols
 const symbolInfo exchangeInfo::getUsdSymbol(const std::string& key) const {
-    auto it = _usdSymbols.find(key);
-        return it->second;
+    return getSymbol<marketId::usdFutures>(key);
 }
 
 // Setter for usdSymbols
 void exchangeInfo::setUsdSymbol(const std::string& key, const symbolInfo& value){
-    _usdSymbols[key] = value;
+    setSymbol(usdMarket, key == value.symbol ? value : underKey(key, value));
 }
 
 // Getter for coinSymbols
 const symbolInfo exchangeInfo::getCoinSymbol(const std::string& key) const {
-    auto it = _coinSymbols.find(key);
-        return it->second;
+    return getSymbol<marketId::coinFutures>(key);
 }
 
 // Setter for coinSymbols
 void exchangeInfo::setCoinSymbol(const  std::string& key, const symbolInfo& value) {
-    _coinSymbols[key] = value;
+    setSymbol(coinMarket, key == value.symbol ? value : underKey(key, value));
+}
+
+// Replace all spot symbols with a new table
+void exchangeInfo::publishSpotSymbols(std::unique_ptr<symbolTable> symbols) {
+    publishSymbols(spotMarket, std::move(symbols));
+}
+
+// Replace all usd futures symbols with a new table
+void exchangeInfo::publishUsdSymbols(std::unique_ptr<symbolTable> symbols) {
+    publishSymbols(usdMarket, std::move(symbols));
+}
+
+// Replace all coin futures symbols with a new table
+void exchangeInfo::publishCoinSymbols(std::unique_ptr<symbolTable> symbols) {
+    publishSymbols(coinMarket, std::move(symbols));
 }
 
 // Function to get the size of spotSymbols
 const size_t exchangeInfo::getSpotSymbolsSize() const {
-    return _spotSymbols.size();
+    return _markets.get<marketId::spot>().symbols.read()->size();
 }
 
 // Function to get the size of usdSymbols
 const size_t exchangeInfo::getUsdSymbolsSize() const {
-    return _usdSymbols.size();
+    return _markets.get<marketId::usdFutures>().symbols.read()->size();
 }
 
 // Function to get the size of coinSymbols
 const size_t exchangeInfo::getCoinSymbolsSize() const {
-    return _coinSymbols.size();
+    return _markets.get<marketId::coinFutures>().symbols.read()->size();
 }
 
 void exchangeInfo::updateSpotStatus(const std::string& key, const std::string& newStatus){
-    _spotSymbols[key].status = newStatus;
+    updateStatus(spotMarket, key, newStatus);
 }
 void exchangeInfo::updateUsdStatus(const std::string& key, const std::string& newStatus){
-    _usdSymbols[key].status = newStatus;
+    updateStatus(usdMarket, key, newStatus);
 }
 void exchangeInfo::updateCoinStatus(const std::string& key, const std::string& newStatus){
-    _coinSymbols[key].status = newStatus;
+    updateStatus(coinMarket, key, newStatus);
 }
 
 void exchangeInfo::deleteSpotSymbol(const std::string& key){
-    auto it = _spotSymbols.find(key);
-    _spotSymbols.erase(it);
+    deleteSymbol(spotMarket, key);
 }
 void exchangeInfo::deleteUsdSymbol(const std::string& key){
-    auto it = _usdSymbols.find(key);
-    _usdSymbols.erase(key);
+    deleteSymbol(usdMarket, key);
 }
 void exchangeInfo::deleteCoinSymbol(const std::string& key){
-    auto it = _coinSymbols.find(key);
-    _coinSymbols.erase(key);
+    deleteSymbol(coinMarket, key);
 }
 
 // check if spot symbol exists
 bool exchangeInfo::spotSymbolexists(const std::string& key) const {
-    auto it = _spotSymbols.find(key);
-    if (it != _spotSymbols.end()) {
-        return true;
-    }
-    return false;
+    return _markets.get<marketId::spot>().symbols.read()->contains(key);
 }
 
 // check if usd symbol exists
 bool exchangeInfo::usdSymbolexists(const std::string& key) const {
-    auto it = _usdSymbols.find(key);
-    if (it != _usdSymbols.end()) {
-        return true;
-    }
-    return false;
+    return _markets.get<marketId::usdFutures>().symbols.read()->contains(key);
 }
 
 // check if coin symbol exists
 bool exchangeInfo::coinSymbolexists(const std::string& key) const {
-    auto it = _coinSymbols.find(key);
-    if (it != _coinSymbols.end()) {
-        return true;
+    return _markets.get<marketId::coinFutures>().symbols.read()->contains(key);
+}
+
+// Add market from config.json, returns its index or marketRegistry::unknown
+size_t exchangeInfo::addMarket(const std::string& market) {
+    return _markets.add(market);
+}
+
+// registered markets
+const marketRegistry& exchangeInfo::getMarkets() const {
+    return _markets;
+}
+
+// Get symbol of market, empty symbolInfo if it or the market is not there
+const symbolInfo exchangeInfo::getSymbol(const std::string& market, const std::string& key) const {
+    symbolInfo info;
+    size_t index = _markets.find(market);
+    if (index != marketRegistry::unknown) {
+        _markets[index].symbols.read()->find(key, info);
+    }
+    return info;
+}
+
+// Insert or replace symbol of market
+void exchangeInfo::setSymbol(const std::string& market, const symbolInfo& value) {
+    size_t index = _markets.find(market);
+    if (index != marketRegistry::unknown) {
+        setSymbol(index, value);
+    }
+}
+
+// Change status of symbol in market
+void exchangeInfo::updateStatus(const std::string& market, const std::string& key, const std::string& newStatus) {
+    size_t index = _markets.find(market);
+    if (index != marketRegistry::unknown) {
+        updateStatus(index, key, newStatus);
+    }
+}
+
+// Remove symbol from market
+void exchangeInfo::deleteSymbol(const std::string& market, const std::string& key) {
+    size_t index = _markets.find(market);
+    if (index != marketRegistry::unknown) {
+        deleteSymbol(index, key);
+    }
+}
+
+// check if symbol exists in market
+bool exchangeInfo::symbolExists(const std::string& market, const std::string& key) const {
+    size_t index = _markets.find(market);
+    return index != marketRegistry::unknown && _markets[index].symbols.read()->contains(key);
+}
+
+// number of symbols in market, 0 for an unknown market
+const size_t exchangeInfo::getSymbolsSize(const std::string& market) const {
+    size_t index = _markets.find(market);
+    return index == marketRegistry::unknown ? 0 : _markets[index].symbols.read()->size();
+}
+
+// Replace all symbols of market with a new table
+void exchangeInfo::publishSymbols(const std::string& market, std::unique_ptr<symbolTable> symbols) {
+    size_t index = _markets.find(market);
+    if (index != marketRegistry::unknown) {
+        publishSymbols(index, std::move(symbols));
+    }
+}
+
+void exchangeInfo::setSymbol(size_t market, const symbolInfo& value) {
+    _markets[market].symbols.update([&](symbolTable& symbols) { symbols.insert(value); });
+    forgetDigest(market);
+    publishShared();
+}
+
+void exchangeInfo::updateStatus(size_t market, const std::string& key, const std::string& newStatus) {
+    std::vector<symbolChange> changes;
+    const char* name = _markets[market].name.c_str();
+    _markets[market].symbols.update([&](symbolTable& symbols) { changeStatus(symbols, name, key, newStatus, changes); });
+    forgetDigest(market);
+    if (!changes.empty()) {
+        publishShared();
+    }
+    emitChanges(changes);
+}
+
+void exchangeInfo::deleteSymbol(size_t market, const std::string& key) {
+    std::vector<symbolChange> changes;
+    const char* name = _markets[market].name.c_str();
+    _markets[market].symbols.update([&](symbolTable& symbols) { eraseSymbol(symbols, name, key, changes); });
+    forgetDigest(market);
+    if (!changes.empty()) {
+        publishShared();
+    }
+    emitChanges(changes);
+}
+
+void exchangeInfo::publishSymbols(size_t market, std::unique_ptr<symbolTable> symbols) {
+    _markets[market].symbols.publish(std::move(symbols));
+    forgetDigest(market);
+    marketRefreshed(market, true);
+}
+
+// Remember that market got its first snapshot, becomes ready once all markets have one
+void exchangeInfo::markPublished(size_t market) {
+    unsigned allMarketBits = _markets.allBits();
+    unsigned marketBit = marketRegistry::bit(market);
+    unsigned previous = _publishedMarkets.fetch_or(marketBit);
+    if (previous == allMarketBits || (previous | marketBit) != allMarketBits) {
+        return;
+    }
+
+    auto timeToReady = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _startTime);
+    {
+        std::lock_guard<std::mutex> lock(_readyMutex);
+        _timeToReadyMs = timeToReady.count();
+    }
+    _readyCondition.notify_all();
+    spdlog::info("All markets loaded, ready after {} ms", timeToReady.count());
+}
+
+// Apply a refresh of market, skipped if nothing changed since the last one, otherwise only the differences are applied
+size_t exchangeInfo::refreshMarket(const std::string& market, const std::vector<symbolInfo>& symbols) {
+    size_t index = _markets.find(market);
+    if (index == marketRegistry::unknown) {
+        spdlog::error("Refresh of unknown market {}", market);
+        return 0;
+    }
+    return refreshMarket(index, symbols);
+}
+
+// Apply a refresh of the market at index
+size_t exchangeInfo::refreshMarket(size_t index, const std::vector<symbolInfo>& symbols) {
+    marketState& state = _markets[index];
+    const std::string& market = state.name;
+    unsigned bit = marketRegistry::bit(index);
+
+    // exchangeInfo almost never changes between polls, skip everything if the extracted fields are the same as last time
+    // serverTime changes on every response, so the digest covers the extracted fields rather than the raw body
+    uint64_t digest = symbolsDigest(symbols);
+    std::atomic<uint64_t>& lastDigest = state.refreshDigest;
+    if (digest == lastDigest.load() && !(_staleMarkets.load() & bit)) {
+        _scheduler.completed(index, false);
+        ++_unchangedRefreshes;
+        SPDLOG_DEBUG("{} unchanged since last refresh", market);
+        return 0;
+    }
+
+    // diff against the table under the writer lock and keep the digest there too,
+    // a local UPDATE or DELETE landing between a diff on an older snapshot and the store would never be corrected
+    std::vector<symbolChange> changes;
+    state.symbols.update([&](symbolTable& current) {
+        diffSymbols(current, symbols, market, changes);
+        applyChanges(current, changes);
+        lastDigest = digest;
+    });
+    _scheduler.completed(index, !changes.empty());
+    ++(changes.empty() ? _unchangedRefreshes : _changedRefreshes);
+    spdlog::info("{}: {} symbols changed", market, changes.size());
+
+    size_t changed = changes.size();
+    emitChanges(changes);
+    marketRefreshed(index, !changes.empty());
+    return changed;
+}
+
+// Number changes, keep them in the change log and queue them for subscribers
+void exchangeInfo::emitChanges(std::vector<symbolChange>& changes) {
+    if (changes.empty()) {
+        return;
+    }
+    _changeLog.append(changes);
+    _changeNotifier.publish(changes);
+}
+
+// Call callback from a delivery thread for every change matching filter, returns id for unsubscribe
+unsigned long long exchangeInfo::subscribe(const subscriptionFilter& filter, changeCallback callback, size_t queueCapacity) {
+    return _changeNotifier.subscribe(filter, std::move(callback), queueCapacity);
+}
+
+// Stop delivering changes to subscriber
+bool exchangeInfo::unsubscribe(unsigned long long id) {
+    return _changeNotifier.unsubscribe(id);
+}
+
+// number of changes dropped for subscriber because it did not keep up
+const unsigned long long exchangeInfo::getDroppedChanges(unsigned long long id) const {
+    return _changeNotifier.droppedCount(id);
+}
+
+// Wait until subscriber has seen every change queued for it so far
+void exchangeInfo::flushChanges(unsigned long long id) const {
+    _changeNotifier.flush(id);
+}
+
+// Read change events after cursor and move cursor past them, returns false if events were lost
+bool exchangeInfo::readChanges(uint64_t& cursor, std::vector<symbolChange>& changes) const {
+    return _changeLog.readSince(cursor, changes);
+}
+
+// refreshes skipped because nothing changed / refreshes that changed symbols
+const refreshStats exchangeInfo::getRefreshStats() const {
+    return refreshStats{_unchangedRefreshes.load(), _changedRefreshes.load()};
+}
+
+// Forget digest of the last refresh of market after a local change so the next refresh is applied
+void exchangeInfo::forgetDigest(size_t market) {
+    _markets[market].refreshDigest = 0;
+}
+
+// Market was refreshed from the network, no longer stale, save the snapshot file and shared memory if its table changed
+void exchangeInfo::marketRefreshed(size_t market, bool changed) {
+    _staleMarkets.fetch_and(~marketRegistry::bit(market));
+    markPublished(market);
+    if (changed) {
+        bool saving;
+        {
+            std::lock_guard<std::mutex> lock(_snapshotMutex);
+            saving = !_snapshotFile.empty();
+        }
+        // the file is written by the snapshot thread, refreshes of one cycle that land while it writes share the next save
+        if (saving) {
+            _snapshotWriter.request();
+        }
+        publishShared();
+    }
+}
+
+// set file the symbol tables are saved to after each refresh, "" disables it
+void exchangeInfo::setSnapshotFile(const std::string& snapshotFile) {
+    std::lock_guard<std::mutex> lock(_snapshotMutex);
+    _snapshotFile = snapshotFile;
+}
+
+// Save symbol tables of all markets to the snapshot file
+bool exchangeInfo::saveSnapshot() {
+    std::lock_guard<std::mutex> lock(_snapshotMutex);
+    if (_snapshotFile.empty()) {
+        return false;
+    }
+    std::vector<std::unique_ptr<rcuSnapshot<symbolTable>::readGuard>> guards;
+    std::vector<std::pair<std::string, const symbolTable*>> tables;
+    readAllMarkets(guards, tables);
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
+    return snapshotFile::save(_snapshotFile, tables, now.count());
+}
+
+// wait until the saves requested by refreshes are in the snapshot file
+void exchangeInfo::flushSnapshot() {
+    _snapshotWriter.flush();
+}
+
+// Load symbol tables saved by a previous run, they are served as stale until the network refresh replaces them
+bool exchangeInfo::loadSnapshot() {
+    std::vector<snapshotMarket> markets;
+    int64_t writtenAtMs;
+    {
+        std::lock_guard<std::mutex> lock(_snapshotMutex);
+        if (_snapshotFile.empty() || !snapshotFile::load(_snapshotFile, markets, writtenAtMs)) {
+            return false;
+        }
+    }
+    _snapshotTimeMs = writtenAtMs;
+
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
+    for (auto& market : markets) {
+        size_t index = _markets.find(market.market);
+        // a market the network already refreshed keeps its newer table, markets no longer configured are dropped
+        if (index == marketRegistry::unknown || (_publishedMarkets.load() & marketRegistry::bit(index))) {
+            continue;
+        }
+        spdlog::info("Loaded {} {} symbols from snapshot written {} s ago", market.symbols->size(), market.market, (now.count() - writtenAtMs) / 1000);
+        _staleMarkets.fetch_or(marketRegistry::bit(index));
+        _markets[index].symbols.publish(std::move(market.symbols));
+        markPublished(index);
+    }
+    publishShared();
+    return true;
+}
+
+// Publish symbol tables to shared memory segment name for other processes, "" stops publishing
+bool exchangeInfo::setSharedMemory(const std::string& name, size_t bufferSize) {
+    {
+        std::lock_guard<std::mutex> lock(_sharedMutex);
+        _sharedSymbols.close();
+        if (name.empty()) {
+            return true;
+        }
+        if (!_sharedSymbols.open(name, bufferSize)) {
+            return false;
+        }
+    }
+    return publishShared();
+}
+
+// Write current symbol tables of all markets to the shared memory segment
+bool exchangeInfo::publishShared() {
+    std::lock_guard<std::mutex> lock(_sharedMutex);
+    if (!_sharedSymbols.isOpen()) {
+        return false;
+    }
+    std::vector<std::unique_ptr<rcuSnapshot<symbolTable>::readGuard>> guards;
+    std::vector<std::pair<std::string, const symbolTable*>> tables;
+    readAllMarkets(guards, tables);
+    return _sharedSymbols.publish(tables);
+}
+
+// Take a snapshot of every market, the guards keep the tables alive
+void exchangeInfo::readAllMarkets(std::vector<std::unique_ptr<rcuSnapshot<symbolTable>::readGuard>>& guards,
+                                  std::vector<std::pair<std::string, const symbolTable*>>& tables) const {
+    size_t count = _markets.size();
+    for (size_t index = 0; index < count; ++index) {
+        guards.emplace_back(new rcuSnapshot<symbolTable>::readGuard(_markets[index].symbols.read()));
+        tables.emplace_back(_markets[index].name, guards.back()->get());
+    }
+}
+
+// check if market is still served from the snapshot file
+bool exchangeInfo::isStale(const std::string& market) const {
+    size_t index = _markets.find(market);
+    return index != marketRegistry::unknown && (_staleMarkets.load() & marketRegistry::bit(index)) != 0;
+}
+
+// time the loaded snapshot file was written in milliseconds since epoch, 0 if none was loaded
+const long long exchangeInfo::getSnapshotTime() const {
+    return _snapshotTimeMs.load();
+}
+
+// set directory raw exchangeInfo responses are recorded to, "" disables recording
+void exchangeInfo::setRecordDirectory(const std::string& recordDirectory) {
+    std::lock_guard<std::mutex> lock(_recordMutex);
+    _recordDirectory = recordDirectory;
+}
+
+// check if responses are recorded
+bool exchangeInfo::isRecording() const {
+    std::lock_guard<std::mutex> lock(_recordMutex);
+    return !_recordDirectory.empty();
+}
+
+// Write raw response of market to <record directory>/<market>.json, replaced as a whole so a reader never sees half of it
+bool exchangeInfo::recordResponse(const std::string& market, const std::string& body) {
+    std::lock_guard<std::mutex> lock(_recordMutex);
+    if (_recordDirectory.empty()) {
+        return false;
+    }
+    mkdir(_recordDirectory.c_str(), 0755);
+    std::string path = _recordDirectory + "/" + market + ".json";
+    std::string temporaryPath = path + ".tmp";
+    FILE* file = fopen(temporaryPath.c_str(), "wb");
+    if (!file) {
+        spdlog::error("Unable to write recording {}", temporaryPath);
+        return false;
+    }
+    bool written = fwrite(body.data(), 1, body.size(), file) == body.size() && fflush(file) == 0;
+    fclose(file);
+    if (!written || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        spdlog::error("Unable to write recording {}", path);
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+    SPDLOG_DEBUG("Recorded {} bytes of {} to {}", body.size(), market, path);
+    return true;
+}
+
+// check if every market has received its first complete snapshot
+bool exchangeInfo::isReady() const {
+    return _timeToReadyMs.load() >= 0;
+}
+
+// Wait until every market has its first snapshot, 0 waits forever, returns false on timeout or stopQuery
+bool exchangeInfo::waitUntilReady(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(_readyMutex);
+    auto done = [this] { return isReady() || _stopWaiting; };
+    if (timeout.count() == 0) {
+        _readyCondition.wait(lock, done);
+    }
+    else {
+        _readyCondition.wait_for(lock, timeout, done);
+    }
+    return isReady();
+}
+
+// time from construction until every market had its first snapshot, -1 while not ready
+const std::chrono::milliseconds exchangeInfo::getTimeToReady() const {
+    return std::chrono::milliseconds(_timeToReadyMs.load());
+}
+
+// Round or validate price and quantity of an order against tickSize and stepSize of its symbol
+normalizeStatus exchangeInfo::normalizeOrder(const std::string& market, const orderInput& order, roundingMode mode, orderResult& result) const {
+    normalizeOrders(market, &order, &result, 1, mode);
+    return result.status;
+}
+
+// Normalize a batch of orders of one market, the snapshot is taken once for the whole batch
+void exchangeInfo::normalizeOrders(const std::string& market, const orderInput* orders, orderResult* results, size_t count, roundingMode mode) const {
+    size_t index = _markets.find(market);
+    if (index == marketRegistry::unknown) {
+        for (size_t index = 0; index < count; ++index) {
+            results[index].status = normalizeStatus::unknownSymbol;
+        }
+        return;
+    }
+
+    auto snapshot = _markets[index].symbols.read();
+    for (size_t order = 0; order < count; ++order) {
+        const symbolRecord* record = snapshot->findRecord(orders[order].symbol);
+        if (!record) {
+            results[order].status = normalizeStatus::unknownSymbol;
+            continue;
+        }
+        ::normalizeOrder(*record, orders[order].price, orders[order].quantity, mode, results[order]);
     }
-    return false;
 }
 
 // read config.json for logging, request url, request interval
 void exchangeInfo::readConfig(std::string configFile, urlInfo& urlConfig, logsInfo& logsConfig) {
 
-    spdlog::trace("Reading config file: {}", configFile);
+    SPDLOG_TRACE("Reading config file: {}", configFile);
     // open config.json
     FILE* fileConfig = fopen(configFile.c_str(), "r"); 
     
@@ -143,21 +653,129 @@ void exchangeInfo::readConfig(std::string configFile, urlInfo& urlConfig, logsIn
     urlConfig.usdFutureEndpoint = doc["exchange_endpoints"]["usd_futures_exchange_info_uri"].GetString();
     urlConfig.coinFutureEndpoint = doc["exchange_endpoints"]["coin_futures_exchange_info_uri"].GetString();
     urlConfig.requestInterval = doc["request_interval"].GetInt();
+    if (doc.HasMember("dns_cache_ttl")) {
+        urlConfig.dnsCacheTtl = doc["dns_cache_ttl"].GetInt();
+    }
+    if (doc.HasMember("warm_up")) {
+        urlConfig.warmUp = doc["warm_up"].GetBool();
+    }
+    // further markets with the same exchangeInfo format, registered before a snapshot or query can name them
+    urlConfig.additionalMarkets.clear();
+    if (doc.HasMember("markets")) {
+        for (auto& market : doc["markets"].GetArray()) {
+            marketEndpoint endpoint{market["name"].GetString(), market["base_url"].GetString(), market["endpoint"].GetString()};
+            if (addMarket(endpoint.name) != marketRegistry::unknown) {
+                urlConfig.additionalMarkets.push_back(endpoint);
+            }
+        }
+    }
+    urlConfig.alternateHosts.clear();
+    if (doc.HasMember("alternate_hosts")) {
+        for (auto& market : doc["alternate_hosts"].GetObject()) {
+            std::vector<std::string>& hosts = urlConfig.alternateHosts[market.name.GetString()];
+            for (auto& host : market.value.GetArray()) {
+                hosts.push_back(host.GetString());
+            }
+        }
+    }
+    if (doc.HasMember("hedging")) {
+        const auto& hedging = doc["hedging"];
+        if (hedging.HasMember("percentile")) {
+            urlConfig.hedgePercentile = hedging["percentile"].GetDouble();
+        }
+        if (hedging.HasMember("min_delay_ms")) {
+            urlConfig.hedgeMinDelayMs = hedging["min_delay_ms"].GetInt();
+        }
+        if (hedging.HasMember("default_delay_ms")) {
+            urlConfig.hedgeDefaultDelayMs = hedging["default_delay_ms"].GetInt();
+        }
+    }
+    if (doc.HasMember("rate_limit")) {
+        const auto& rateLimit = doc["rate_limit"];
+        if (rateLimit.HasMember("weight_limit")) {
+            urlConfig.weightLimit = rateLimit["weight_limit"].GetUint();
+        }
+        if (rateLimit.HasMember("min_interval")) {
+            urlConfig.minRequestInterval = rateLimit["min_interval"].GetInt();
+        }
+        if (rateLimit.HasMember("max_interval")) {
+            urlConfig.maxRequestInterval = rateLimit["max_interval"].GetInt();
+        }
+    }
+    if (doc.HasMember("io_threads")) {
+        urlConfig.ioThreads = doc["io_threads"]["count"].GetUint();
+        urlConfig.ioCpuAffinity.clear();
+        if (doc["io_threads"].HasMember("cpu_affinity")) {
+            for (auto& cpu : doc["io_threads"]["cpu_affinity"].GetArray()) {
+                urlConfig.ioCpuAffinity.push_back(cpu.GetInt());
+            }
+        }
+    }
+    if (doc.HasMember("record_dir")) {
+        setRecordDirectory(doc["record_dir"].GetString());
+    }
+    if (doc.HasMember("snapshot_file")) {
+        setSnapshotFile(doc["snapshot_file"].GetString());
+    }
+    if (doc.HasMember("shared_memory")) {
+        size_t bufferSize = doc["shared_memory"].HasMember("buffer_size") ? doc["shared_memory"]["buffer_size"].GetUint64() : 4 << 20;
+        setSharedMemory(doc["shared_memory"]["name"].GetString(), bufferSize);
+    }
     
     // store logging level, file enable, console enable
     logsConfig.level = doc["logging"]["level"].GetString();
     logsConfig.file = doc["logging"]["file"].GetBool();
     logsConfig.console = doc["logging"]["console"].GetBool();
+    if (doc["logging"].HasMember("async")) {
+        logsConfig.async = doc["logging"]["async"].GetBool();
+    }
+    if (doc["logging"].HasMember("queue_size")) {
+        logsConfig.queueSize = doc["logging"]["queue_size"].GetUint64();
+    }
+    if (doc["logging"].HasMember("overflow")) {
+        logsConfig.overflow = doc["logging"]["overflow"].GetString();
+    }
+    if (doc["logging"].HasMember("flush_interval")) {
+        logsConfig.flushInterval = doc["logging"]["flush_interval"].GetInt();
+    }
+
+    // store query file name and watch mode if present
+    if (doc.HasMember("query")) {
+        _queryConfig.queryFile = doc["query"]["query_file"].GetString();
+        _queryConfig.watchFile = doc["query"]["watch"].GetBool();
+        if (doc["query"].HasMember("dedup_capacity")) {
+            _queryConfig.dedupCapacity = doc["query"]["dedup_capacity"].GetUint64();
+        }
+        if (doc["query"].HasMember("answers_file")) {
+            _queryConfig.answersFile = doc["query"]["answers_file"].GetString();
+        }
+        if (doc["query"].HasMember("answers_format")) {
+            _queryConfig.answersNdjson = std::string(doc["query"]["answers_format"].GetString()) == "ndjson";
+        }
+        if (doc["query"].HasMember("until_ready")) {
+            std::string untilReady = doc["query"]["until_ready"].GetString();
+            _queryConfig.untilReady = untilReady == "wait" ? readyMode::wait : untilReady == "not_ready" ? readyMode::notReady : readyMode::serve;
+        }
+        if (doc["query"].HasMember("ready_timeout")) {
+            _queryConfig.readyTimeout = doc["query"]["ready_timeout"].GetInt();
+        }
+        if (doc["query"].HasMember("server_socket")) {
+            _queryConfig.serverSocket = doc["query"]["server_socket"].GetString();
+        }
+        if (doc["query"].HasMember("server_port")) {
+            _queryConfig.serverPort = doc["query"]["server_port"].GetInt();
+        }
+    }
 
     // close file
     fclose(fileConfig); 
 
-    spdlog::debug("Config file loaded successfully");
+    SPDLOG_DEBUG("Config file loaded successfully");
 }
 
 void exchangeInfo::setSpdLogs(logsInfo& logsConfig){
     
-    spdlog::trace("Starting Logger setup...");
+    SPDLOG_TRACE("Starting Logger setup...");
 
     // Create a vector of sinks
     std::vector<spdlog::sink_ptr> sinks;
@@ -165,305 +783,627 @@ void exchangeInfo::setSpdLogs(logsInfo& logsConfig){
     // Add console sink if enabled
     if (logsConfig.console) {
         sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
-        spdlog::debug("Console logging enabled");
+        SPDLOG_DEBUG("Console logging enabled");
     }
 
     // Add file sink if enabled
     if (logsConfig.file) {
         sinks.push_back(std::make_shared<spdlog::sinks::basic_file_sink_mt>("logs/logfile.log", true));
-        spdlog::debug("File logging enabled");
+        SPDLOG_DEBUG("File logging enabled");
     }
 
-    // Create logger
-    auto logger = std::make_shared<spdlog::logger>("BinanceExchangeLogs", begin(sinks), end(sinks));
+    // Create logger, the async one hands lines to a background thread through a preallocated queue
+    std::shared_ptr<spdlog::logger> logger;
+    if (logsConfig.async) {
+        spdlog::init_thread_pool(logsConfig.queueSize, 1);
+        auto policy = logsConfig.overflow == "drop" ? spdlog::async_overflow_policy::overrun_oldest : spdlog::async_overflow_policy::block;
+        logger = std::make_shared<spdlog::async_logger>("BinanceExchangeLogs", begin(sinks), end(sinks), spdlog::thread_pool(), policy);
+    }
+    else {
+        logger = std::make_shared<spdlog::logger>("BinanceExchangeLogs", begin(sinks), end(sinks));
+    }
 
     // set level
     logger->set_level(spdlog::level::from_str(logsConfig.level));
     
-    // register logger
+    // register logger, replaces the one of an earlier call
+    spdlog::drop("BinanceExchangeLogs");
     spdlog::register_logger(logger);
     spdlog::set_default_logger(logger);
-    logger->flush_on(spdlog::level::from_str(logsConfig.level));
 
-    spdlog::trace("Logger setup completed");
+    // the async logger flushes periodically instead of after every line
+    if (logsConfig.async) {
+        logger->flush_on(spdlog::level::warn);
+        spdlog::flush_every(std::chrono::seconds(logsConfig.flushInterval));
+    }
+    else {
+        logger->flush_on(spdlog::level::from_str(logsConfig.level));
+    }
+
+    SPDLOG_TRACE("Logger setup completed");
 }
 
-// function to make HTTP request and get data
-void exchangeInfo::fetchData(urlInfo& urlConfig, boost::asio::io_context& ioc, boost::asio::ssl::context& ctx) {
+// split "host:port" or "[ipv6]:port" into host and port, port defaults to 443
+static void splitHostPort(const std::string& baseUrl, std::string& host, std::string& port) {
+    port = "443";
+    if (!baseUrl.empty() && baseUrl.front() == '[') {
+        size_t close = baseUrl.find(']');
+        if (close != std::string::npos) {
+            host = baseUrl.substr(1, close - 1);
+            if (close + 1 < baseUrl.size() && baseUrl[close + 1] == ':') {
+                port = baseUrl.substr(close + 2);
+            }
+            return;
+        }
+    }
+    // a bare ipv6 address has several colons and no port
+    size_t colon = baseUrl.rfind(':');
+    if (colon == std::string::npos || baseUrl.find(':') != colon) {
+        host = baseUrl;
+        return;
+    }
+    host = baseUrl.substr(0, colon);
+    port = baseUrl.substr(colon + 1);
+}
 
-    auto const port = "443";
-    int version = 11;
+// "host:port" of base url, the key of its latency stats and pooled sessions
+static std::string hostKey(const std::string& baseUrl) {
+    std::string host, port;
+    splitHostPort(baseUrl, host, port);
+    return host + ":" + port;
+}
 
-    // Launch the asynchronous operation
-    // The session is constructed with a strand to ensure that handlers do not execute concurrently.
+// fewest requests a host needs before its percentiles are trusted
+static constexpr uint64_t minLatencySamples = 5;
 
-    // creating session for spot endpoint
-    spdlog::info("Starting async HTTP request to host: {}, endpoint: {}", urlConfig.spotExchangeBaseUrl, urlConfig.spotExchangeEndpoint);
-    auto spotSession = std::make_shared<session>(boost::asio::make_strand(ioc), ctx, this, urlConfig);
-    spotSession->get(urlConfig.spotExchangeBaseUrl.c_str(), port, urlConfig.spotExchangeEndpoint.c_str(), version);
+// time a host that failed or missed the hedge delay is asked after the others
+static constexpr std::chrono::seconds hostFailureCooldown(60);
 
-    // creating session for usd futures endpoint
-    spdlog::info("Starting async HTTP request to host: {}, endpoint: {}", urlConfig.usdFutureExchangeBaseUrl, urlConfig.usdFutureEndpoint);
-    auto usdFuturesSession = std::make_shared<session>(boost::asio::make_strand(ioc), ctx, this, urlConfig);
-    usdFuturesSession->get(urlConfig.usdFutureExchangeBaseUrl.c_str(), port, urlConfig.usdFutureEndpoint.c_str(), version);
+// Sort base urls by the median refresh time of their host, hosts without samples keep their config order after the others
+// hosts that failed recently go last whatever their latency, their median only covers the requests that succeeded
+static void orderByLatency(const latencyStats& stats, std::vector<std::string>& baseUrls) {
+    std::vector<std::tuple<bool, uint64_t, std::string>> ranked;
+    for (const std::string& baseUrl : baseUrls) {
+        std::string key = hostKey(baseUrl);
+        const latencyHistogram* total = stats.find(key, traceStage::total);
+        ranked.emplace_back(stats.failedWithin(key, hostFailureCooldown), total && total->count() > 0 ? total->percentile(50) : UINT64_MAX, baseUrl);
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+        return std::tie(std::get<0>(a), std::get<1>(a)) < std::tie(std::get<0>(b), std::get<1>(b));
+    });
+    for (size_t index = 0; index < ranked.size(); ++index) {
+        baseUrls[index] = std::move(std::get<2>(ranked[index]));
+    }
+}
 
-    // creating session for coin futures endpoint
-    spdlog::info("Starting async HTTP request to host: {}, endpoint: {}", urlConfig.coinFutureExchangeBaseUrl, urlConfig.coinFutureEndpoint);
-    auto coinFuturesSession = std::make_shared<session>(boost::asio::make_strand(ioc), ctx, this, urlConfig);
-    coinFuturesSession->get(urlConfig.coinFutureExchangeBaseUrl.c_str(), port, urlConfig.coinFutureEndpoint.c_str(), version);
+// Time after which the next host gets the request too, the configured percentile of the refresh time of the first host
+static std::chrono::nanoseconds hedgeDelay(const latencyStats& stats, const std::string& baseUrl, const urlInfo& urlConfig) {
+    if (urlConfig.hedgePercentile <= 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    const latencyHistogram* total = stats.find(hostKey(baseUrl), traceStage::total);
+    std::chrono::nanoseconds delay = std::chrono::milliseconds(urlConfig.hedgeDefaultDelayMs);
+    if (total && total->count() >= minLatencySamples) {
+        delay = std::chrono::nanoseconds(total->percentile(urlConfig.hedgePercentile));
+    }
+    return std::max<std::chrono::nanoseconds>(delay, std::chrono::milliseconds(urlConfig.hedgeMinDelayMs));
+}
 
+// function to make HTTP request and get data
+void exchangeInfo::fetchData(urlInfo& urlConfig, boost::asio::io_context& ioc, boost::asio::ssl::context& ctx) {
+    _scheduler.configure(std::chrono::seconds(urlConfig.requestInterval), std::chrono::seconds(urlConfig.minRequestInterval),
+                         std::chrono::seconds(urlConfig.maxRequestInterval));
+    fetchMarkets(urlConfig, ioc, ctx, ~0u);
 }
 
-// function to perform queries
-void exchangeInfo::processQuery(std::string& queryMarket, std::string& querySymbol, std::string& queryType, std::string& queryStatus){
+// Fetch the markets the scheduler says are due, returns how long to wait before asking again
+std::chrono::steady_clock::duration exchangeInfo::fetchDue(urlInfo& urlConfig, boost::asio::io_context& ioc, boost::asio::ssl::context& ctx) {
+    _scheduler.configure(std::chrono::seconds(urlConfig.requestInterval), std::chrono::seconds(urlConfig.minRequestInterval),
+                         std::chrono::seconds(urlConfig.maxRequestInterval));
+    unsigned due = _scheduler.due(_markets.allBits());
+    if (due) {
+        fetchMarkets(urlConfig, ioc, ctx, due);
+    }
+    else if (_rateLimiter.blockedFor() > std::chrono::steady_clock::duration::zero()) {
+        SPDLOG_DEBUG("Requests blocked by the exchange, no refresh");
+    }
+    return _scheduler.untilNext();
+}
 
-    spdlog::info("Processing query: Market = {}, Symbol = {}, Type = {}", queryMarket, querySymbol, queryType);
+void exchangeInfo::fetchMarkets(urlInfo& urlConfig, boost::asio::io_context& ioc, boost::asio::ssl::context& ctx, unsigned mask) {
 
-    // Check if the symbol exists in any of the markets 
-    spdlog::trace("Checking if symbol exists for market: {}", queryMarket);
-    if(queryMarket == "SPOT"){
-        if(!spotSymbolexists(querySymbol)){
-            spdlog::error("{}: symbol does not exist", querySymbol);
-            return;   
+    int version = 11;
+    std::string host, port;
+
+    _sessionCache.setDnsTtl(std::chrono::seconds(urlConfig.dnsCacheTtl));
+    _rateLimiter.setWeightLimit(urlConfig.weightLimit);
+    [[maybe_unused]] connectionStats stats = _sessionCache.getStats();
+    SPDLOG_DEBUG("DNS cache hits: {}, misses: {}, TLS handshakes resumed: {}, full: {}",
+                 stats.dnsHits, stats.dnsMisses, stats.resumedHandshakes, stats.fullHandshakes);
+
+    // Sessions are kept in a pool bound to the io_context so keep-alive connections are reused on every refresh
+    auto& pool = boost::asio::use_service<connectionPool>(ioc);
+    {
+        std::lock_guard<std::mutex> lock(_poolsMutex);
+        if (_pools.insert(&pool).second) {
+            pool.attach(this);
         }
     }
-    if(queryMarket == "usd_futures"){
-        if(!usdSymbolexists(querySymbol)){
-            spdlog::error("{}: symbol does not exist", querySymbol);
-            return;   
+
+    // built-in markets from their config fields, then the markets added in config.json
+    std::vector<marketEndpoint> markets = {
+        {"SPOT", urlConfig.spotExchangeBaseUrl, urlConfig.spotExchangeEndpoint},
+        {"usd_futures", urlConfig.usdFutureExchangeBaseUrl, urlConfig.usdFutureEndpoint},
+        {"coin_futures", urlConfig.coinFutureExchangeBaseUrl, urlConfig.coinFutureEndpoint},
+    };
+    markets.insert(markets.end(), urlConfig.additionalMarkets.begin(), urlConfig.additionalMarkets.end());
+
+    // Launch the asynchronous operation, one request per market
+    for (const marketEndpoint& market : markets) {
+        size_t index = _markets.find(market.name);
+        if (index == marketRegistry::unknown || !(mask & marketRegistry::bit(index))) {
+            continue;
         }
-    }
-    if(queryMarket == "coin_futures"){
-        if(!coinSymbolexists(querySymbol)){
-            spdlog::error("{}: symbol does not exist", querySymbol);
-            return;   
+        _scheduler.dispatched(index);
+
+        auto alternates = urlConfig.alternateHosts.find(market.name);
+        if (alternates == urlConfig.alternateHosts.end() || alternates->second.empty()) {
+            spdlog::info("Starting async HTTP request to host: {}, endpoint: {}", market.baseUrl, market.endpoint);
+            splitHostPort(market.baseUrl, host, port);
+            pool.getSession(ioc, ctx, this, market.name, host, port, market.endpoint, version)->get();
+            continue;
         }
-    }
-    spdlog::debug("Symbol {} exists in market {}", querySymbol, queryMarket);
-    
-    // Create a RapidJSON document to store the results
-    rapidjson::Document answers;
-    answers.SetObject();
-    auto& allocator = answers.GetAllocator();
-    
-    // lock while performing query on data structure
-    spdlog::trace("Locking binanceExchangeMutex for query processing.");
-    binanceExchangeMutex.lock();
-
-    // Process query based on type
-    if(queryType == "GET"){
 
-        // GET request: retrieve and output symbol to answers.json
-        spdlog::info("Getting spot data for {}", querySymbol);
-
-        // Retrieve symbol info based on specified market
-        symbolInfo temp;
-        if (queryMarket == "SPOT") { 
-            temp = getSpotSymbol(querySymbol); 
-        }
-        if (queryMarket == "usd_futures") { 
-            temp = getUsdSymbol(querySymbol); 
+        // several hosts serve the market, ask the fastest and hedge or fail over to the others
+        // one such refresh per market at a time, a second one could apply its answer while the first is applied
+        if (_requestsInFlight.fetch_or(marketRegistry::bit(index)) & marketRegistry::bit(index)) {
+            spdlog::warn("Refresh of {} still in progress, skipping this refresh", market.name);
+            continue;
         }
-        if (queryMarket == "coin_futures") { 
-            temp = getCoinSymbol(querySymbol); 
+        std::vector<std::string> baseUrls = {market.baseUrl};
+        baseUrls.insert(baseUrls.end(), alternates->second.begin(), alternates->second.end());
+        orderByLatency(_latencyStats, baseUrls);
+        std::vector<std::shared_ptr<session>> sessions;
+        for (const std::string& baseUrl : baseUrls) {
+            splitHostPort(baseUrl, host, port);
+            sessions.push_back(pool.getSession(ioc, ctx, this, market.name, host, port, market.endpoint, version));
         }
+        std::chrono::nanoseconds delay = hedgeDelay(_latencyStats, baseUrls.front(), urlConfig);
+        spdlog::info("Starting async HTTP request to host: {}, endpoint: {}, hedge after {} ms", baseUrls.front(), market.endpoint,
+                     std::chrono::duration_cast<std::chrono::milliseconds>(delay).count());
+        std::make_shared<marketRequest>(ioc, this, market.name, std::move(sessions), delay)->start();
+    }
+}
 
-        rapidjson::Value symbolDetails(rapidjson::kObjectType);
-        symbolDetails.AddMember("symbol", rapidjson::Value(temp.symbol.c_str(), allocator), allocator);
-        symbolDetails.AddMember("quoteAsset", rapidjson::Value(temp.quoteAsset.c_str(), allocator), allocator);
-        symbolDetails.AddMember("status", rapidjson::Value(temp.status.c_str(), allocator), allocator);
-        symbolDetails.AddMember("tickSize", rapidjson::Value(temp.tickSize.c_str(), allocator), allocator);
-        symbolDetails.AddMember("stepSize", rapidjson::Value(temp.stepSize.c_str(), allocator), allocator);
+// function to perform queries
+void exchangeInfo::processQuery(std::string& queryMarket, std::string& querySymbol, std::string& queryType, std::string& queryStatus){
 
-        answers.AddMember("get", symbolDetails, allocator);
-        
-    }
+    SPDLOG_DEBUG("Processing query: Market = {}, Symbol = {}, Type = {}", queryMarket, querySymbol, queryType);
 
-    else if(queryType == "UPDATE"){
+    std::string answer;
+    if (!executeQuery(queryMarket, querySymbol, queryType, queryStatus, answer)) {
+        return;
+    }
 
-        // UPDATE request: modify symbol status and output update details to answers.json
-        spdlog::info("Updating data for symbol: {}", querySymbol);
+    // hand the answer to the answers writer thread
+    writeAnswers(std::move(answer));
+    SPDLOG_DEBUG("Queued query results for {}.", _queryConfig.answersFile);
+}
 
-        if(queryMarket == "SPOT"){
-            rapidjson::Value updateDetails(rapidjson::kObjectType);
-            updateDetails.AddMember("symbol", rapidjson::Value(querySymbol.c_str(), allocator), allocator);
-            
-            spdlog::info("Old Status: {}", getSpotSymbol(querySymbol).status);
-            updateDetails.AddMember("oldstatus", rapidjson::Value(getSpotSymbol(querySymbol).status.c_str(), allocator), allocator);
+// Run query and serialize its answer, returns false if the symbol does not exist in the market
+bool exchangeInfo::executeQuery(const std::string& queryMarket, const std::string& querySymbol, const std::string& queryType, const std::string& queryStatus, std::string& answer){
+    parsedQuery query{0, queryMarket, querySymbol, queryType, queryStatus};
+    return executeQueries(&query, 1, answer) == 1;
+}
 
-            updateSpotStatus(querySymbol, queryStatus);
-            spdlog::info("New Status: {}", getSpotSymbol(querySymbol).status);
+// Run queries in order and serialize all answers in one pass, separated the way the answers file separates them
+// GETs share one snapshot per market until the next change, consecutive changes of one market are applied in a single update
+// queries on unknown symbols or markets are logged and get no answer
+size_t exchangeInfo::executeQueries(const parsedQuery* queries, size_t count, std::string& answers){
+    rapidjson::StringBuffer answerBuffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(answerBuffer);
+    const char* separator = _queryConfig.answersNdjson ? "\n" : ",\n";
+    size_t answered = 0;
+
+    // start the next answer object after the separator
+    auto startAnswer = [&]() {
+        if (answered++ > 0) {
+            for (const char* c = separator; *c; ++c) {
+                answerBuffer.Put(*c);
+            }
+        }
+        writer.Reset(answerBuffer);
+        writer.StartObject();
+    };
+
+    // snapshots read by GETs, dropped before any change because an update waits for all readers of its table
+    std::optional<rcuSnapshot<symbolTable>::readGuard> snapshots[marketRegistry::maxMarkets];
+    bool tablesChanged = false;
+
+    size_t index = 0;
+    while (index < count) {
+        const parsedQuery& query = queries[index];
+
+        // STATS request: latency histograms of the refresh requests, not tied to a market
+        if (query.type == "STATS") {
+            startAnswer();
+            writer.Key("stats");
+            writeLatencyStats(writer, _latencyStats);
+            writer.EndObject();
+            ++index;
+            continue;
+        }
 
-            updateDetails.AddMember("newStatus", rapidjson::Value(queryStatus.c_str(), allocator), allocator);
-            answers.AddMember("update", updateDetails, allocator);
+        size_t market = _markets.find(query.market);
+        if (market == marketRegistry::unknown) {
+            spdlog::error("{}: unknown market {}", query.symbol, query.market);
+            ++index;
+            continue;
         }
+        unsigned bit = marketRegistry::bit(market);
+        rcuSnapshot<symbolTable>& table = _markets[market].symbols;
+
+        if (query.type == "GET") {
+            // GET request: retrieve symbol
+            SPDLOG_DEBUG("Getting data for {}", query.symbol);
+            auto& snapshot = snapshots[market];
+            if (!snapshot) {
+                snapshot.emplace(table);
+            }
+            const symbolRecord* record = (*snapshot)->findRecord(query.symbol);
+            if (!record) {
+                spdlog::error("{}: symbol does not exist", query.symbol);
+                ++index;
+                continue;
+            }
 
-        if(queryMarket == "usd_futures"){
-            rapidjson::Value updateDetails(rapidjson::kObjectType);
-            updateDetails.AddMember("symbol", rapidjson::Value(querySymbol.c_str(), allocator), allocator);
+            startAnswer();
+            writer.Key("get");
+            writeRecord(writer, **snapshot, *record);
 
-            spdlog::info("Old Status: {}", getUsdSymbol(querySymbol).status);
-            updateDetails.AddMember("oldStatus", rapidjson::Value(getUsdSymbol(querySymbol).status.c_str(), allocator), allocator);
+            // data loaded from the snapshot file of a previous run and not refreshed yet
+            if (_staleMarkets.load() & bit) {
+                writer.Key("stale");
+                writer.Bool(true);
+                writer.Key("snapshotTime");
+                writer.Int64(getSnapshotTime());
+            }
+            writer.EndObject();
+            writer.EndObject();
+            ++index;
+            continue;
+        }
 
-            updateUsdStatus(querySymbol, queryStatus);
-            spdlog::info("New Status: {}", getUsdSymbol(querySymbol).status);
+        if (query.type == "LIST" || query.type == "FILTER" || query.type == "PREFIX") {
+            // LIST/FILTER/PREFIX request: walk the matching index and write each symbol straight from its record
+            SPDLOG_DEBUG("{} of {}", query.type, query.market);
+            auto& snapshot = snapshots[market];
+            if (!snapshot) {
+                snapshot.emplace(table);
+            }
+            const symbolTable& symbols = **snapshot;
+            size_t matched = 0;
+            auto writeMatch = [&](const symbolRecord& record) {
+                writeRecord(writer, symbols, record);
+                ++matched;
+            };
+
+            startAnswer();
+            writer.Key(query.type == "LIST" ? "list" : query.type == "FILTER" ? "filter" : "prefix");
+            writer.StartObject();
+            writer.Key("market");
+            writer.String(query.market.c_str(), query.market.size());
+            writer.Key("symbols");
+            writer.StartArray();
+            if (query.type == "PREFIX") {
+                symbols.forEachWithPrefix(query.symbol, writeMatch);
+            }
+            else if (query.type == "FILTER") {
+                symbols.forEachMatching(query.quoteAsset, query.status, writeMatch);
+            }
+            else {
+                symbols.forEachMatching("", "", writeMatch);
+            }
+            writer.EndArray();
+            writer.Key("count");
+            writer.Uint64(matched);
+            if (_staleMarkets.load() & bit) {
+                writer.Key("stale");
+                writer.Bool(true);
+                writer.Key("snapshotTime");
+                writer.Int64(getSnapshotTime());
+            }
+            writer.EndObject();
+            writer.EndObject();
+            ++index;
+            continue;
+        }
 
-            updateDetails.AddMember("newStatus", rapidjson::Value(queryStatus.c_str(), allocator), allocator);
-            answers.AddMember("update", updateDetails, allocator);
+        if (query.type != "UPDATE" && query.type != "DELETE") {
+            spdlog::warn("{}: unknown query type {}", query.symbol, query.type);
+            ++index;
+            continue;
         }
 
-        if(queryMarket == "coin_futures"){
-            rapidjson::Value updateDetails(rapidjson::kObjectType);
-            updateDetails.AddMember("symbol", rapidjson::Value(querySymbol.c_str(), allocator), allocator);
+        // UPDATE and DELETE requests up to the next GET or other market are applied to one copy of the table
+        size_t end = index;
+        while (end < count && queries[end].market == query.market && (queries[end].type == "UPDATE" || queries[end].type == "DELETE")) {
+            ++end;
+        }
+        for (auto& snapshot : snapshots) {
+            snapshot.reset();
+        }
 
-            spdlog::info("Old Status: {}", getCoinSymbol(querySymbol).status);
-            updateDetails.AddMember("oldStatus", rapidjson::Value(getCoinSymbol(querySymbol).status.c_str(), allocator), allocator);
+        std::vector<symbolChange> changes;
+        table.update([&](symbolTable& symbols) {
+            for (size_t next = index; next < end; ++next) {
+                const parsedQuery& change = queries[next];
+                symbolInfo before;
+                if (!symbols.find(change.symbol, before)) {
+                    spdlog::error("{}: symbol does not exist", change.symbol);
+                    continue;
+                }
 
-            updateCoinStatus(querySymbol, queryStatus);
-            spdlog::info("New Status: {}", getCoinSymbol(querySymbol).status);
+                startAnswer();
+                if (change.type == "UPDATE") {
+                    // UPDATE request: modify symbol status and output update details
+                    SPDLOG_DEBUG("Old Status: {}, New Status: {}", before.status, change.status);
+                    changeStatus(symbols, change.market.c_str(), change.symbol, change.status, changes);
+                    writer.Key("update");
+                    writer.StartObject();
+                    writer.Key("symbol");
+                    writer.String(change.symbol.c_str(), change.symbol.size());
+                    // spot answers always used "oldstatus"
+                    writer.Key(market == spotMarket ? "oldstatus" : "oldStatus");
+                    writer.String(before.status.c_str(), before.status.size());
+                    writer.Key("newStatus");
+                    writer.String(change.status.c_str(), change.status.size());
+                    writer.EndObject();
+                }
+                else {
+                    // DELETE request: remove symbol from its market and output delete status
+                    SPDLOG_DEBUG("Deleted symbol {}", change.symbol);
+                    eraseSymbol(symbols, change.market.c_str(), change.symbol, changes);
+                    writer.Key("delete");
+                    writer.StartObject();
+                    writer.Key("deletedSymbol");
+                    writer.String(change.symbol.c_str(), change.symbol.size());
+                    writer.EndObject();
+                }
+                writer.EndObject();
+            }
+        });
+        forgetDigest(market);
+        tablesChanged |= !changes.empty();
+        emitChanges(changes);
+        index = end;
+    }
 
-            updateDetails.AddMember("newStatus", rapidjson::Value(queryStatus.c_str(), allocator), allocator);
-            answers.AddMember("update", updateDetails, allocator);
+    // one publication for the whole batch
+    if (tablesChanged) {
+        publishShared();
+    }
+    answers.assign(answerBuffer.GetString(), answerBuffer.GetSize());
+    return answered;
+}
+
+// Serialize the not ready error of a query while markets are still loading
+void exchangeInfo::notReadyAnswer(unsigned long long queryID, std::string& answer) const {
+    spdlog::warn("Query {} received before all markets were loaded", queryID);
+    rapidjson::StringBuffer answerBuffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(answerBuffer);
+    writer.StartObject();
+    writer.Key("error");
+    writer.StartObject();
+    writer.Key("id");
+    writer.Uint64(queryID);
+    writer.Key("message");
+    writer.String("not ready");
+    writer.EndObject();
+    writer.EndObject();
+    answer.append(answerBuffer.GetString(), answerBuffer.GetSize());
+}
+
+// Check a query of the query file or the query server before it is executed
+queryAdmission exchangeInfo::admitQuery(std::optional<unsigned long long> queryID, std::string& answer) {
+    if (queryID) {
+        std::lock_guard<std::mutex> lock(_prevIDsMutex);
+        if (!_prevIDs.insert(*queryID)) {
+            return queryAdmission::duplicate;
         }
+    }
+    if (_queryConfig.untilReady == readyMode::notReady && !isReady()) {
+        notReadyAnswer(queryID.value_or(0), answer);
+        return queryAdmission::notReady;
+    }
+    return queryAdmission::execute;
+}
 
+// check if queries are held back until every market has its first snapshot
+bool exchangeInfo::holdQueries() const {
+    if (_queryConfig.untilReady != readyMode::wait || isReady()) {
+        return false;
     }
+    return _queryConfig.readyTimeout == 0 || std::chrono::steady_clock::now() - _startTime < std::chrono::seconds(_queryConfig.readyTimeout);
+}
 
-    else if(queryType == "DELETE"){
+// Append answers to the answers file from the writer thread
+void exchangeInfo::writeAnswers(std::string&& answers) {
+    if (!_answersWriter.ensureOpen(_queryConfig.answersFile, _queryConfig.answersNdjson)) {
+        spdlog::error("Query results dropped, answers file {} is not open", _queryConfig.answersFile);
+    }
+    // counted as dropped instead of queued while the writer is not open
+    _answersWriter.write(std::move(answers));
+}
 
-        // DELETE request: remove symbol from respective market and output delete status to answers.json
-        spdlog::info("Deleting data for symbol: {}", querySymbol);
-        rapidjson::Value deleteDetails(rapidjson::kObjectType);
-        if(queryMarket == "SPOT") {
-            deleteSpotSymbol(querySymbol);
-            spdlog::info("Deleted symbol {}", querySymbol);
-            deleteDetails.AddMember("deletedSymbol", rapidjson::Value(querySymbol.c_str(), allocator), allocator);
-            answers.AddMember("delete", deleteDetails, allocator);
-        } 
+// wait until all answers are written to the answers file
+void exchangeInfo::flushAnswers() {
+    _answersWriter.flush();
+}
 
-        else if(queryMarket == "usd_futures") {
-            deleteUsdSymbol(querySymbol);
-            spdlog::info("Deleted symbol {}", querySymbol);
-            deleteDetails.AddMember("deletedSymbol", rapidjson::Value(querySymbol.c_str(), allocator), allocator);
-            answers.AddMember("delete", deleteDetails, allocator);
-        }
-        else if(queryMarket == "coin_futures") {
-            deleteCoinSymbol(querySymbol);
-            spdlog::info("Deleted symbol {}", querySymbol);
-            deleteDetails.AddMember("deletedSymbol", rapidjson::Value(querySymbol.c_str(), allocator), allocator);
-            answers.AddMember("delete", deleteDetails, allocator);
-        }
-        else {
-            spdlog::warn("Symbol {} not found for deletion.", querySymbol);
-        }
+// number of answers lost because the answers file could not be opened or written
+const unsigned long long exchangeInfo::getDroppedAnswers() const {
+    return _answersWriter.dropped();
+}
 
+// dns and tls session cache shared by all sessions
+sessionCache& exchangeInfo::getSessionCache() {
+    return _sessionCache;
+}
+
+// dns cache hits/misses and resumed/full tls handshakes
+const connectionStats exchangeInfo::getConnectionStats() const {
+    return _sessionCache.getStats();
+}
+
+// per host latency histograms of the refresh requests
+latencyStats& exchangeInfo::getLatencyStats() {
+    return _latencyStats;
+}
+
+const latencyStats& exchangeInfo::getLatencyStats() const {
+    return _latencyStats;
+}
+
+rateLimiter& exchangeInfo::getRateLimiter() {
+    return _rateLimiter;
+}
+
+const rateLimiter& exchangeInfo::getRateLimiter() const {
+    return _rateLimiter;
+}
+
+refreshScheduler& exchangeInfo::getScheduler() {
+    return _scheduler;
+}
+
+void exchangeInfo::refreshFailed(const std::string& market) {
+    size_t index = _markets.find(market);
+    if (index != marketRegistry::unknown) {
+        _scheduler.failed(index);
     }
-    // unlock after performing query   
-    spdlog::trace("Unlocking binanceExchangeMutex after query processing."); 
-    binanceExchangeMutex.unlock();
-    
-    // Open the file in "r+" mode to read and write
-    FILE* answersFile = fopen("answers.json", "r+");
-    if (!answersFile) {
-        spdlog::error("Could not open answers.json file.");
-        return;
-    }
-    spdlog::trace("Opened answers.json to append query results.");
+}
 
-    // move to the end of the file and read the last three characters
-    fseek(answersFile, -3, SEEK_END);
-    char lastChar;
-    fread(&lastChar, 1, 1, answersFile);
+void exchangeInfo::poolClosed(connectionPool* pool) {
+    std::lock_guard<std::mutex> lock(_poolsMutex);
+    _pools.erase(pool);
+}
 
-    // check if the last character is '}' or '[' before the closing ']'
-    if (lastChar == '}') {
-        // Move back one position to overwrite ']' with ','
-        fseek(answersFile, -1, SEEK_END);
-        fputc(',', answersFile);
+void exchangeInfo::requestFinished(const std::string& market) {
+    size_t index = _markets.find(market);
+    if (index != marketRegistry::unknown) {
+        _requestsInFlight.fetch_and(~marketRegistry::bit(index));
     }
+}
+
+// set query file and watch mode used by readQuery
+void exchangeInfo::setQueryConfig(const queryInfo& queryConfig) {
+    _queryConfig = queryConfig;
+}
 
-    char writeBuffer[65536];
-    rapidjson::FileWriteStream os(answersFile, writeBuffer, sizeof(writeBuffer));
-    rapidjson::Writer<rapidjson::FileWriteStream> writer(os);
-    answers.Accept(writer);
-    spdlog::debug("Appended query results to answers.json.");
+// query file, answers file and query server settings
+const queryInfo& exchangeInfo::getQueryConfig() const {
+    return _queryConfig;
+}
 
-    // Write closing ']' to complete the array
-    fputs("\n]", answersFile);
+// number of queries executed by readQuery
+const unsigned long long exchangeInfo::getProcessedQueryCount() const {
+    return _processedQueries.load();
+}
 
-    fclose(answersFile);
-    spdlog::trace("Closed answers.json after writing query results.");
+// make readQuery return
+void exchangeInfo::stopQuery() {
+    {
+        std::lock_guard<std::mutex> lock(_readyMutex);
+        _stopWaiting = true;
+    }
+    _readyCondition.notify_all();
+    _queryWatcher.stop();
 }
 
-// function to continuously read and process queries from query.JSON file
+// function to read and process queries from query.JSON file whenever it changes
 void exchangeInfo::readQuery() {
-    spdlog::trace("Starting readQuery function...");
+    SPDLOG_TRACE("Starting readQuery function...");
 
-    FILE* answersFile = fopen("answers.json", "w");
-    if (!answersFile) {
-        spdlog::error("Error: unable to open answers.json for writing.");
+    // truncate answers file and start the answers writer thread
+    if (!_answersWriter.open(_queryConfig.answersFile, _queryConfig.answersNdjson)) {
         return;
     }
+    // ids of queries processed so far
+    {
+        std::lock_guard<std::mutex> lock(_prevIDsMutex);
+        _prevIDs = queryDeduplicator(_queryConfig.dedupCapacity);
+    }
 
-    fputs("[\n]", answersFile);
-    spdlog::debug("Created and initialized answers.json file with empty array.");
-    fclose(answersFile);
-    // variables to keep track of last query ID for each market type
-    std::vector<long long int> prevIDs;
-
-    // infinite loop to continuously process queries
-    spdlog::trace("Starting query processing loop.");
-    while(true){
-        // Variables to store query details
-        unsigned long long int queryID;
-        std::string queryType, queryMarket, querySymbol, queryStatus;
-
-        // Load and parse the JSON query file
-        rapidjson::Document doc;
-        std::string queryFile = "query.json";
-        FILE* fileQuery = fopen(queryFile.c_str(), "r"); 
-        if (!fileQuery) { 
-            spdlog::error("Error: unable to open file {}", queryFile);
-            continue;  // Retry in next iteration
-        } 
-
-        char buffer[65536];
-        rapidjson::FileReadStream is(fileQuery, buffer, sizeof(buffer));
-
-        // Try to parse the JSON
-        if (doc.ParseStream(is).HasParseError()) {
-            fclose(fileQuery);
-            continue;  // Retry in next iteration
-        }
-        
-        fclose(fileQuery); 
-
-        // Process each query 
-        for (rapidjson::Value::ConstValueIterator itr = doc["query"].Begin(); itr != doc["query"].End(); ++itr) {
-            // Extract query details
-            unsigned long long int queryID = (*itr)["id"].GetUint64();
-            std::string queryType = (*itr)["query_type"].GetString();
-            std::string queryMarket = (*itr)["market_type"].GetString();
-            std::string querySymbol = (*itr)["instrument_name"].GetString();
-
-            // Check if the query has a status field
-            if (itr->HasMember("data")) {
-                if ((*itr)["data"].HasMember("status")) {
-                    queryStatus = (*itr)["data"]["status"].GetString();
-                }
+    // query objects appended to the query file since the last read and the ones of them not seen before
+    std::vector<std::string> newQueries;
+    std::vector<parsedQuery> batch;
+    std::string answers;
+    _queryWatcher.watch(_queryConfig.queryFile, _queryConfig.watchFile);
+
+    // hold queries until the first snapshot of every market landed so they are not answered from empty tables
+    if (_queryConfig.untilReady == readyMode::wait && !isReady()) {
+        spdlog::info("Waiting for all markets before serving queries");
+        if (!waitUntilReady(std::chrono::seconds(_queryConfig.readyTimeout))) {
+            spdlog::warn("Markets not loaded after {} seconds, serving queries anyway", _queryConfig.readyTimeout);
+        }
+    }
+
+    // process new queries every time the query file changes
+    SPDLOG_TRACE("Starting query processing loop.");
+    do {
+        newQueries.clear();
+        batch.clear();
+        _queryWatcher.readNewQueries(newQueries);
+
+        // Parse each new query
+        for (const auto& queryText : newQueries) {
+            // Parse the JSON query object
+            rapidjson::Document query;
+            if (query.Parse(queryText.c_str()).HasParseError() || !query.IsObject()) {
+                spdlog::warn("Skipping malformed query: {}", queryText);
+                continue;
+            }
+
+            // queue query if it has not been processed before
+            unsigned long long int queryID = query["id"].GetUint64();
+            std::string notReady;
+            queryAdmission admission = admitQuery(queryID, notReady);
+            if (admission == queryAdmission::duplicate) {
+                continue;
             }
-            bool idFlag = true;
-            // execute query if it has not been processed before for the same market
-            for(int index = 0; index < prevIDs.size(); ++index){
-                if(queryID == prevIDs[index]){
-                    idFlag = false;
-                    break;
+            if (admission == queryAdmission::notReady) {
+                writeAnswers(std::move(notReady));
+                ++_processedQueries;
+                continue;
+            }
+
+            // Extract query details, LIST and FILTER have no instrument_name and PREFIX puts the prefix there, STATS has no market_type
+            batch.push_back(parsedQuery{queryID, query.HasMember("market_type") ? query["market_type"].GetString() : "", "", query["query_type"].GetString(), "", ""});
+            if (query.HasMember("instrument_name")) {
+                batch.back().symbol = query["instrument_name"].GetString();
+            }
+
+            // Check if the query has a status field, FILTER may also match on quote_asset
+            if (query.HasMember("data")) {
+                if (query["data"].HasMember("status")) {
+                    batch.back().status = query["data"]["status"].GetString();
+                }
+                if (query["data"].HasMember("quote_asset")) {
+                    batch.back().quoteAsset = query["data"]["quote_asset"].GetString();
                 }
             }
-            if(idFlag == true){
-                this->processQuery(queryMarket, querySymbol, queryType, queryStatus);
+        }
+
+        // execute all new queries together and hand their answers to the writer thread in one piece
+        if (!batch.empty()) {
+            spdlog::info("Processing {} queries", batch.size());
+            if (executeQueries(batch.data(), batch.size(), answers) > 0) {
+                writeAnswers(std::move(answers));
             }
-            // Update the last processed query ID
-            prevIDs.push_back(queryID);
+            _processedQueries += batch.size();
         }
-    }
+    } while(_queryWatcher.waitForChange());
+
+    SPDLOG_TRACE("Stopped query processing loop.");
 }
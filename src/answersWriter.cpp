@@ -0,0 +1,202 @@
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "answersWriter.h"
+#include "spdlog/spdlog.h"
+
+// max answers written with a single write call
+static const size_t maxBatchSize = 1024;
+
+answersWriter::answersWriter(size_t queueCapacity)
+: _queue(queueCapacity), _open(false), _stop(false), _ndjson(false), _fd(-1), _tail(0), _answersInFile(0),
+  _queued(0), _written(0), _dropped(0), _writerWaiting(false) {}
+
+answersWriter::~answersWriter() {
+    close();
+}
+
+bool answersWriter::open(const std::string& answersFile, bool ndjson) {
+    std::lock_guard<std::mutex> lock(_openMutex);
+    if (_open) {
+        close();
+    }
+    return openLocked(answersFile, ndjson);
+}
+
+bool answersWriter::openLocked(const std::string& answersFile, bool ndjson) {
+    _fd = ::open(answersFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | (ndjson ? O_APPEND : 0), 0644);
+    if (_fd < 0) {
+        spdlog::error("Error: unable to open {} for writing: {}", answersFile, strerror(errno));
+        return false;
+    }
+    _ndjson = ndjson;
+    _answersInFile = 0;
+
+    // json mode keeps the file a valid array at all times
+    if (!_ndjson) {
+        if (::write(_fd, "[\n]", 3) != 3) {
+            spdlog::error("Error: unable to initialize {}", answersFile);
+        }
+        _tail = 1;
+    }
+    SPDLOG_DEBUG("Created and initialized {} in {} mode.", answersFile, _ndjson ? "ndjson" : "json");
+
+    _stop = false;
+    _open = true;
+    _writerThread = std::thread(&answersWriter::run, this);
+    return true;
+}
+
+bool answersWriter::ensureOpen(const std::string& answersFile, bool ndjson) {
+    if (_open) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(_openMutex);
+    if (_open) {
+        return true;
+    }
+    return openLocked(answersFile, ndjson);
+}
+
+bool answersWriter::isOpen() const {
+    return _open;
+}
+
+bool answersWriter::write(std::string&& answer) {
+    // without a writer thread the queue never drains
+    if (!_open) {
+        ++_dropped;
+        return false;
+    }
+    while (!_queue.push(std::move(answer))) {
+        if (!_open) {
+            ++_dropped;
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    ++_queued;
+
+    // only take the mutex if the writer thread is asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_writerWaiting) {
+        std::lock_guard<std::mutex> lock(_waitMutex);
+        _wakeWriter.notify_one();
+    }
+    return true;
+}
+
+void answersWriter::flush() {
+    unsigned long long target = _queued;
+    std::unique_lock<std::mutex> lock(_waitMutex);
+    _batchWritten.wait(lock, [&] { return _written >= target || !_open; });
+}
+
+unsigned long long answersWriter::dropped() const {
+    return _dropped;
+}
+
+void answersWriter::close() {
+    if (!_open) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_waitMutex);
+        _stop = true;
+        _wakeWriter.notify_one();
+    }
+    _writerThread.join();
+    ::close(_fd);
+    _fd = -1;
+    _open = false;
+    _batchWritten.notify_all();
+}
+
+void answersWriter::run() {
+    std::string answer;
+    std::string batch;
+    while (true) {
+        // collect everything queued so far into one buffer
+        batch.clear();
+        size_t count = 0;
+        while (count < maxBatchSize && _queue.pop(answer)) {
+            if (_ndjson) {
+                batch += answer;
+                batch += '\n';
+            }
+            else {
+                if (_answersInFile + count > 0) {
+                    batch += ",\n";
+                }
+                batch += answer;
+            }
+            ++count;
+        }
+
+        if (count > 0) {
+            if (!_ndjson) {
+                batch += "\n]";
+            }
+            long tail = _tail;
+            if (writeBatch(batch)) {
+                _answersInFile += count;
+                SPDLOG_TRACE("Appended {} query results to answers file.", count);
+            }
+            else {
+                // json mode puts the closing "\n]" back where the last good batch ended so the file stays an array
+                spdlog::error("{} query results were not written to the answers file", count);
+                _dropped += count;
+                if (!_ndjson) {
+                    _tail = tail;
+                    if (::pwrite(_fd, "\n]", 2, _tail) != 2 || ::ftruncate(_fd, _tail + 2) != 0) {
+                        spdlog::error("Could not restore the end of the answers file: {}", strerror(errno));
+                    }
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(_waitMutex);
+            _written += count;
+            _batchWritten.notify_all();
+            continue;
+        }
+
+        // queue is empty, sleep until a producer wakes us up
+        std::unique_lock<std::mutex> lock(_waitMutex);
+        if (_stop && _queue.empty()) {
+            break;
+        }
+        _writerWaiting = true;
+        _wakeWriter.wait_for(lock, std::chrono::milliseconds(100), [&] { return !_queue.empty() || _stop; });
+        _writerWaiting = false;
+    }
+}
+
+bool answersWriter::writeBatch(const std::string& batch) {
+    const char* data = batch.data();
+    size_t remaining = batch.size();
+    while (remaining > 0) {
+        // json mode overwrites the closing "\n]" and writes it again after the batch
+        ssize_t written = _ndjson ? ::write(_fd, data, remaining) : ::pwrite(_fd, data, remaining, _tail);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            spdlog::error("Could not write answers file: {}", strerror(errno));
+            return false;
+        }
+        data += written;
+        remaining -= written;
+        if (!_ndjson) {
+            _tail += written;
+        }
+    }
+    // closing "\n]" gets overwritten by the next batch
+    if (!_ndjson) {
+        _tail -= 2;
+    }
+    return true;
+}
@@ -0,0 +1,35 @@
+#include "changeLog.h"
+
+changeLog::changeLog(size_t capacity)
+: _capacity(capacity > 0 ? capacity : 1), _nextSequence(0) {}
+
+void changeLog::append(std::vector<symbolChange>& changes) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& change : changes) {
+        change.sequence = _nextSequence++;
+        if (_events.size() < _capacity) {
+            _events.push_back(change);
+        }
+        else {
+            _events[change.sequence % _capacity] = change;
+        }
+    }
+}
+
+bool changeLog::readSince(uint64_t& cursor, std::vector<symbolChange>& changes) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint64_t oldest = _nextSequence > _events.size() ? _nextSequence - _events.size() : 0;
+    bool complete = cursor >= oldest;
+    if (!complete) {
+        cursor = oldest;
+    }
+    for (; cursor < _nextSequence; ++cursor) {
+        changes.push_back(_events[cursor % _capacity]);
+    }
+    return complete;
+}
+
+uint64_t changeLog::nextSequence() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _nextSequence;
+}
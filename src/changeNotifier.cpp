@@ -0,0 +1,144 @@
+#include "changeNotifier.h"
+
+#include <chrono>
+#include <exception>
+
+#include "spdlog/spdlog.h"
+
+changeNotifier::subscriber::subscriber(unsigned long long subscriberId, const subscriptionFilter& subscriberFilter,
+                                       changeCallback subscriberCallback, size_t queueCapacity)
+: id(subscriberId), filter(subscriberFilter), callback(std::move(subscriberCallback)), queue(queueCapacity),
+  stopping(false), queued(0), delivered(0), dropped(0), waiting(false) {}
+
+bool changeNotifier::subscriber::matches(const symbolChange& change) const {
+    return (filter.market.empty() || filter.market == change.market)
+        && (filter.symbol.empty() || filter.symbol == change.after.symbol || filter.symbol == change.before.symbol)
+        && (filter.fields == 0 || (filter.fields & change.fields) != 0);
+}
+
+void changeNotifier::subscriber::run() {
+    symbolChange change;
+    while (true) {
+        if (queue.pop(change)) {
+            try {
+                callback(change);
+            }
+            catch (const std::exception& e) {
+                spdlog::error("Subscriber {} failed on change of {}: {}", id, change.after.symbol, e.what());
+            }
+            std::lock_guard<std::mutex> lock(waitMutex);
+            ++delivered;
+            drained.notify_all();
+            continue;
+        }
+
+        // queue is empty, sleep until a publisher wakes us up
+        std::unique_lock<std::mutex> lock(waitMutex);
+        if (stopping && queue.empty()) {
+            break;
+        }
+        waiting = true;
+        wake.wait_for(lock, std::chrono::milliseconds(100), [&] { return !queue.empty() || stopping; });
+        waiting = false;
+    }
+}
+
+void changeNotifier::subscriber::stop() {
+    {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        stopping = true;
+        wake.notify_one();
+    }
+    if (thread.joinable()) {
+        thread.join();
+    }
+    drained.notify_all();
+}
+
+changeNotifier::changeNotifier()
+: _nextId(1) {}
+
+changeNotifier::~changeNotifier() {
+    for (const auto& entry : *_subscribers.read()) {
+        entry->stop();
+    }
+}
+
+unsigned long long changeNotifier::subscribe(const subscriptionFilter& filter, changeCallback callback, size_t queueCapacity) {
+    unsigned long long id = _nextId++;
+    auto entry = std::make_shared<subscriber>(id, filter, std::move(callback), queueCapacity);
+    entry->thread = std::thread(&subscriber::run, entry.get());
+    _subscribers.update([&](subscriberList& subscribers) { subscribers.push_back(entry); });
+    SPDLOG_DEBUG("Subscriber {} added for market '{}', symbol '{}'", id, filter.market, filter.symbol);
+    return id;
+}
+
+bool changeNotifier::unsubscribe(unsigned long long id) {
+    std::shared_ptr<subscriber> entry;
+    _subscribers.update([&](subscriberList& subscribers) {
+        for (auto it = subscribers.begin(); it != subscribers.end(); ++it) {
+            if ((*it)->id == id) {
+                entry = *it;
+                subscribers.erase(it);
+                break;
+            }
+        }
+    });
+    if (!entry) {
+        return false;
+    }
+    // no publisher can reach it any more once update returned
+    entry->stop();
+    return true;
+}
+
+void changeNotifier::publish(const std::vector<symbolChange>& changes) {
+    auto subscribers = _subscribers.read();
+    for (const auto& entry : *subscribers) {
+        bool queuedAny = false;
+        for (const auto& change : changes) {
+            if (!entry->matches(change)) {
+                continue;
+            }
+            symbolChange copy = change;
+            if (!entry->queue.push(std::move(copy))) {
+                ++entry->dropped;
+                continue;
+            }
+            ++entry->queued;
+            queuedAny = true;
+        }
+
+        // only take the mutex if the delivery thread is asleep
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (queuedAny && entry->waiting) {
+            std::lock_guard<std::mutex> lock(entry->waitMutex);
+            entry->wake.notify_one();
+        }
+    }
+}
+
+unsigned long long changeNotifier::droppedCount(unsigned long long id) const {
+    auto entry = find(id);
+    return entry ? entry->dropped.load() : 0;
+}
+
+void changeNotifier::flush(unsigned long long id) const {
+    auto entry = find(id);
+    if (!entry) {
+        return;
+    }
+    unsigned long long target = entry->queued;
+    std::unique_lock<std::mutex> lock(entry->waitMutex);
+    entry->drained.wait(lock, [&] { return entry->delivered >= target || entry->stopping; });
+}
+
+std::shared_ptr<changeNotifier::subscriber> changeNotifier::find(unsigned long long id) const {
+    auto subscribers = _subscribers.read();
+    for (const auto& entry : *subscribers) {
+        if (entry->id == id) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
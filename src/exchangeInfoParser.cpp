@@ -0,0 +1,428 @@
+#include <cstring>
+
+#include "exchangeInfoParser.h"
+#include "rapidjson/document.h"
+#include "rapidjson/reader.h"
+#include "rapidjson/memorystream.h"
+#include "spdlog/spdlog.h"
+
+// compare a key from the parser with a string literal without building a std::string
+template <size_t N>
+static bool keyIs(const char* str, unsigned length, const char (&name)[N]) {
+    return length == N - 1 && memcmp(str, name, N - 1) == 0;
+}
+
+symbolsHandler::symbolsHandler() {
+    reset();
+}
+
+void symbolsHandler::reset() {
+    // slots of the previous document stay allocated, their strings are overwritten by the next one
+    _count = 0;
+    _current = nullptr;
+    _pending = field::none;
+    _depth = 0;
+    _symbolsDepth = 0;
+    _filtersDepth = 0;
+    _hasSymbols = false;
+}
+
+bool symbolsHandler::hasSymbols() const {
+    return _hasSymbols;
+}
+
+std::vector<symbolInfo>& symbolsHandler::symbols() {
+    _symbols.resize(_count);
+    return _symbols;
+}
+
+// values we do not keep only clear the pending field
+bool symbolsHandler::Null() { _pending = field::none; return true; }
+bool symbolsHandler::Bool(bool) { _pending = field::none; return true; }
+bool symbolsHandler::Int(int) { _pending = field::none; return true; }
+bool symbolsHandler::Uint(unsigned) { _pending = field::none; return true; }
+bool symbolsHandler::Int64(int64_t) { _pending = field::none; return true; }
+bool symbolsHandler::Uint64(uint64_t) { _pending = field::none; return true; }
+bool symbolsHandler::Double(double) { _pending = field::none; return true; }
+bool symbolsHandler::RawNumber(const char*, unsigned, bool) { _pending = field::none; return true; }
+
+bool symbolsHandler::String(const char* str, unsigned length, bool) {
+    switch (_pending) {
+        case field::symbol:     _current->symbol.assign(str, length); break;
+        case field::quoteAsset: _current->quoteAsset.assign(str, length); break;
+        case field::status:     _current->status.assign(str, length); break;
+        case field::filterType: _filterType.assign(str, length); break;
+        case field::tickSize:   _filterTickSize.assign(str, length); break;
+        case field::stepSize:   _filterStepSize.assign(str, length); break;
+        default: break;
+    }
+    _pending = field::none;
+    return true;
+}
+
+bool symbolsHandler::StartObject() {
+    // new symbol in the symbols array
+    if (_symbolsDepth && _depth == _symbolsDepth) {
+        if (_count == _symbols.size()) {
+            _symbols.emplace_back();
+        }
+        _current = &_symbols[_count];
+        _current->symbol.clear();
+        _current->quoteAsset.clear();
+        _current->status.clear();
+        _current->tickSize.clear();
+        _current->stepSize.clear();
+    }
+    // new filter in the filters array of the current symbol
+    if (_filtersDepth && _depth == _filtersDepth) {
+        _filterType.clear();
+        _filterTickSize.clear();
+        _filterStepSize.clear();
+    }
+    ++_depth;
+    _pending = field::none;
+    return true;
+}
+
+bool symbolsHandler::Key(const char* str, unsigned length, bool) {
+    _pending = field::none;
+    if (_filtersDepth && _depth == _filtersDepth + 1) {
+        if (keyIs(str, length, "filterType")) _pending = field::filterType;
+        else if (keyIs(str, length, "tickSize")) _pending = field::tickSize;
+        else if (keyIs(str, length, "stepSize")) _pending = field::stepSize;
+    }
+    else if (_symbolsDepth && !_filtersDepth && _depth == _symbolsDepth + 1) {
+        if (keyIs(str, length, "symbol")) _pending = field::symbol;
+        else if (keyIs(str, length, "quoteAsset")) _pending = field::quoteAsset;
+        else if (keyIs(str, length, "status")) _pending = field::status;
+        else if (keyIs(str, length, "contractStatus")) _pending = field::status;   // usd futures api has contractStatus instead of status
+        else if (keyIs(str, length, "filters")) _pending = field::filters;
+    }
+    else if (_depth == 1 && !_symbolsDepth && keyIs(str, length, "symbols")) {
+        _pending = field::symbols;
+    }
+    return true;
+}
+
+bool symbolsHandler::EndObject(unsigned) {
+    // end of a filter, keep tick size of PRICE_FILTER and step size of LOT_SIZE
+    if (_filtersDepth && _depth == _filtersDepth + 1) {
+        if (_filterType == "PRICE_FILTER") {
+            _current->tickSize = _filterTickSize;
+        }
+        else if (_filterType == "LOT_SIZE") {
+            _current->stepSize = _filterStepSize;
+        }
+    }
+    // end of a symbol
+    else if (_symbolsDepth && _depth == _symbolsDepth + 1) {
+        ++_count;
+    }
+    --_depth;
+    _pending = field::none;
+    return true;
+}
+
+bool symbolsHandler::StartArray() {
+    ++_depth;
+    if (_pending == field::symbols) {
+        _symbolsDepth = _depth;
+        _hasSymbols = true;
+    }
+    else if (_pending == field::filters) {
+        _filtersDepth = _depth;
+    }
+    _pending = field::none;
+    return true;
+}
+
+bool symbolsHandler::EndArray(unsigned) {
+    if (_depth == _filtersDepth) {
+        _filtersDepth = 0;
+    }
+    else if (_depth == _symbolsDepth) {
+        _symbolsDepth = 0;
+    }
+    --_depth;
+    _pending = field::none;
+    return true;
+}
+
+exchangeInfoStreamParser::exchangeInfoStreamParser() : _recording(nullptr) {
+    reset();
+}
+
+void exchangeInfoStreamParser::reset() {
+    _handler.reset();
+    _containers.clear();
+    _token.clear();
+    _mode = mode::value;
+    _expectKey = false;
+    _isKey = false;
+    _codePoint = 0;
+    _highSurrogate = 0;
+    _hexDigits = 0;
+    if (_recording) {
+        _recording->clear();
+    }
+}
+
+void exchangeInfoStreamParser::record(std::string* recording) {
+    _recording = recording;
+}
+
+bool exchangeInfoStreamParser::hasSymbols() const {
+    return _handler.hasSymbols();
+}
+
+std::vector<symbolInfo>& exchangeInfoStreamParser::symbols() {
+    return _handler.symbols();
+}
+
+void exchangeInfoStreamParser::appendUtf8(unsigned codePoint) {
+    if (codePoint < 0x80) {
+        _token += static_cast<char>(codePoint);
+    }
+    else if (codePoint < 0x800) {
+        _token += static_cast<char>(0xC0 | (codePoint >> 6));
+        _token += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x10000) {
+        _token += static_cast<char>(0xE0 | (codePoint >> 12));
+        _token += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        _token += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else {
+        _token += static_cast<char>(0xF0 | (codePoint >> 18));
+        _token += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        _token += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        _token += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+bool exchangeInfoStreamParser::endToken() {
+    bool valid = true;
+    if (_mode == mode::number) {
+        valid = _handler.RawNumber(_token.data(), _token.size(), true);
+    }
+    else if (_mode == mode::literal) {
+        if (_token == "true") valid = _handler.Bool(true);
+        else if (_token == "false") valid = _handler.Bool(false);
+        else if (_token == "null") valid = _handler.Null();
+        else valid = false;
+    }
+    _token.clear();
+    _mode = valid ? mode::value : mode::failed;
+    return valid;
+}
+
+bool exchangeInfoStreamParser::feed(const char* data, size_t length) {
+    if (_recording) {
+        _recording->append(data, length);
+    }
+    const char* end = data + length;
+    const char* ptr = data;
+    while (ptr < end) {
+        char c = *ptr;
+        switch (_mode) {
+            case mode::failed:
+                return false;
+
+            case mode::string: {
+                // copy everything up to the next quote or backslash at once
+                const char* stop = ptr;
+                while (stop < end && *stop != '"' && *stop != '\\') {
+                    ++stop;
+                }
+                _token.append(ptr, stop - ptr);
+                ptr = stop;
+                if (ptr == end) {
+                    break;
+                }
+                if (*ptr == '\\') {
+                    _mode = mode::escape;
+                }
+                else {
+                    bool valid = _isKey ? _handler.Key(_token.data(), _token.size(), true)
+                                        : _handler.String(_token.data(), _token.size(), true);
+                    _token.clear();
+                    _mode = valid ? mode::value : mode::failed;
+                }
+                ++ptr;
+                break;
+            }
+
+            case mode::escape:
+                switch (c) {
+                    case '"': _token += '"'; break;
+                    case '\\': _token += '\\'; break;
+                    case '/': _token += '/'; break;
+                    case 'b': _token += '\b'; break;
+                    case 'f': _token += '\f'; break;
+                    case 'n': _token += '\n'; break;
+                    case 'r': _token += '\r'; break;
+                    case 't': _token += '\t'; break;
+                    case 'u': _codePoint = 0; _hexDigits = 0; break;
+                    default: _mode = mode::failed; return false;
+                }
+                _mode = c == 'u' ? mode::unicode : mode::string;
+                ++ptr;
+                break;
+
+            case mode::unicode: {
+                int digit = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+                if (digit < 0) {
+                    _mode = mode::failed;
+                    return false;
+                }
+                _codePoint = (_codePoint << 4) | digit;
+                if (++_hexDigits == 4) {
+                    // high surrogate waits for the low one in the next escape
+                    if (_codePoint >= 0xD800 && _codePoint <= 0xDBFF) {
+                        _highSurrogate = _codePoint;
+                    }
+                    else if (_codePoint >= 0xDC00 && _codePoint <= 0xDFFF && _highSurrogate) {
+                        appendUtf8(0x10000 + ((_highSurrogate - 0xD800) << 10) + (_codePoint - 0xDC00));
+                        _highSurrogate = 0;
+                    }
+                    else {
+                        appendUtf8(_codePoint);
+                    }
+                    _mode = mode::string;
+                }
+                ++ptr;
+                break;
+            }
+
+            case mode::number:
+                if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+                    _token += c;
+                    ++ptr;
+                }
+                else if (!endToken()) {
+                    return false;
+                }
+                break;
+
+            case mode::literal:
+                if (c >= 'a' && c <= 'z') {
+                    _token += c;
+                    ++ptr;
+                }
+                else if (!endToken()) {
+                    return false;
+                }
+                break;
+
+            case mode::value:
+                switch (c) {
+                    case ' ': case '\t': case '\n': case '\r': case ':':
+                        break;
+                    case '{':
+                        _containers.push_back('{');
+                        _expectKey = true;
+                        if (!_handler.StartObject()) { _mode = mode::failed; return false; }
+                        break;
+                    case '[':
+                        _containers.push_back('[');
+                        _expectKey = false;
+                        if (!_handler.StartArray()) { _mode = mode::failed; return false; }
+                        break;
+                    case '}':
+                    case ']':
+                        if (_containers.empty() || _containers.back() != (c == '}' ? '{' : '[')) {
+                            _mode = mode::failed;
+                            return false;
+                        }
+                        _containers.pop_back();
+                        _expectKey = false;
+                        if (!(c == '}' ? _handler.EndObject(0) : _handler.EndArray(0))) { _mode = mode::failed; return false; }
+                        break;
+                    case ',':
+                        _expectKey = !_containers.empty() && _containers.back() == '{';
+                        break;
+                    case '"':
+                        _isKey = _expectKey;
+                        _expectKey = false;
+                        _mode = mode::string;
+                        break;
+                    case 't': case 'f': case 'n':
+                        _token += c;
+                        _mode = mode::literal;
+                        break;
+                    default:
+                        if ((c >= '0' && c <= '9') || c == '-') {
+                            _token += c;
+                            _mode = mode::number;
+                            break;
+                        }
+                        _mode = mode::failed;
+                        return false;
+                }
+                ++ptr;
+                break;
+        }
+    }
+    return _mode != mode::failed;
+}
+
+bool exchangeInfoStreamParser::finish() {
+    if (_mode == mode::number || _mode == mode::literal) {
+        endToken();
+    }
+    return _mode == mode::value && _containers.empty();
+}
+
+// Parse exchangeInfo response into a DOM and copy out the symbols
+bool parseExchangeInfoDom(const std::string& body, std::vector<symbolInfo>& symbols) {
+    // Parse body of HTTP response as JSON
+    rapidjson::Document fullData;
+    fullData.Parse(body.c_str());
+
+    // Check if parsed data is object and contains symbols array
+    if (!fullData.IsObject() || !fullData.HasMember("symbols") || !fullData["symbols"].IsArray()) {
+        spdlog::error("Invalid JSON format or missing symbols array.");
+        return false;
+    }
+
+    // Access the "symbols" array
+    const auto& symbolsArray = fullData["symbols"];
+
+    // iterate over array
+    for (const auto& symbol : symbolsArray.GetArray()) {
+        symbolInfo info;                                    // structure to hold symbol info
+        info.symbol = symbol["symbol"].GetString();         // get symbol name
+        info.quoteAsset = symbol["quoteAsset"].GetString(); // get quote asset
+        if (symbol.HasMember("status")){
+            info.status = symbol["status"].GetString();     // get status for spot and coin future
+        }
+        if (symbol.HasMember("contractStatus")){
+            info.status = symbol["contractStatus"].GetString();     // since usd future api has key contractStatus instead of status
+        }
+
+        // Iterate over filters array
+        for (const auto& filter : symbol["filters"].GetArray()) {
+            std::string filterType = filter["filterType"].GetString();  // get filter type
+            if (filterType == "PRICE_FILTER") {
+                info.tickSize = filter["tickSize"].GetString();         // get tick size if filter is PRICE_FILTER
+            } else if (filterType == "LOT_SIZE") {
+                info.stepSize = filter["stepSize"].GetString();         // get step size if filter is LOT_SIZE
+            }
+        }
+        symbols.push_back(std::move(info));
+    }
+    return true;
+}
+
+// Parse exchangeInfo response from a complete buffer with rapidjson::Reader and the symbols handler
+bool parseExchangeInfoSax(const char* data, size_t length, std::vector<symbolInfo>& symbols) {
+    symbolsHandler handler;
+    rapidjson::Reader reader;
+    rapidjson::MemoryStream is(data, length);
+    if (reader.Parse(is, handler).IsError() || !handler.hasSymbols()) {
+        spdlog::error("Invalid JSON format or missing symbols array.");
+        return false;
+    }
+    symbols.swap(handler.symbols());
+    return true;
+}
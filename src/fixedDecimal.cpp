@@ -0,0 +1,89 @@
+#include "fixedDecimal.h"
+
+fixedDecimal::fixedDecimal()
+: _packed(uint64_t(absentScale) << unitsBits) {}
+
+bool fixedDecimal::parse(std::string_view text, fixedDecimal& value) {
+    value = fixedDecimal();
+    if (text.empty()) {
+        return true;
+    }
+
+    uint64_t units = 0;
+    unsigned scale = 0;
+    bool point = false;
+    bool digits = false;
+    for (char c : text) {
+        if (c == '.' && !point) {
+            point = true;
+            continue;
+        }
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        units = units * 10 + (c - '0');
+        digits = true;
+        if (units > unitsMask) {
+            return false;
+        }
+        if (point) {
+            ++scale;
+        }
+    }
+    // leading zeros other than the one before the point would not round-trip
+    if (!digits || scale >= absentScale || (text.size() > 1 && text[0] == '0' && text[1] != '.') || text[0] == '.' || text.back() == '.') {
+        return false;
+    }
+
+    value._packed = (uint64_t(scale) << unitsBits) | units;
+    return true;
+}
+
+bool fixedDecimal::fromUnits(uint64_t units, unsigned scale, fixedDecimal& value) {
+    if (units > unitsMask || scale >= absentScale) {
+        return false;
+    }
+    value._packed = (uint64_t(scale) << unitsBits) | units;
+    return true;
+}
+
+std::string fixedDecimal::toString() const {
+    char text[maxChars];
+    return std::string(text, toChars(text));
+}
+
+size_t fixedDecimal::toChars(char* text) const {
+    if (empty()) {
+        return 0;
+    }
+    // digits of units backwards, padded with zeros up to the one before the point
+    char digits[maxChars];
+    size_t count = 0;
+    unsigned digitsAfterPoint = scale();
+    uint64_t value = units();
+    do {
+        digits[count++] = char('0' + value % 10);
+        value /= 10;
+    } while (value != 0 || count <= digitsAfterPoint);
+
+    size_t length = 0;
+    while (count > 0) {
+        if (count == digitsAfterPoint) {
+            text[length++] = '.';
+        }
+        text[length++] = digits[--count];
+    }
+    return length;
+}
+
+bool fixedDecimal::empty() const {
+    return (_packed >> unitsBits) == absentScale;
+}
+
+int64_t fixedDecimal::units() const {
+    return empty() ? 0 : int64_t(_packed & unitsMask);
+}
+
+unsigned fixedDecimal::scale() const {
+    return empty() ? 0 : unsigned(_packed >> unitsBits);
+}
@@ -1,7 +1,9 @@
 #include "getHttpsData.h"
+#include <charconv>
+#include "boost/asio/dispatch.hpp"
+#include "boost/asio/strand.hpp"
 
 #include "spdlog/spdlog.h"
-#include "rapidjson/document.h"
 
 namespace beast = boost::beast;         // from <boost/beast.hpp>
 namespace http = beast::http;           // from <boost/beast/http.hpp>
@@ -9,168 +11,452 @@ namespace net = boost::asio;            // from <boost/asio.hpp>
 namespace ssl = boost::asio::ssl;       // from <boost/asio/ssl.hpp>
 using tcp = boost::asio::ip::tcp;       // from <boost/asio/ip/tcp.hpp>
 
-session::session(net::any_io_executor ex, ssl::context& ctx, exchangeInfo* exchangeClass, urlInfo& urlConfig) 
-: _resolver(ex), _stream(ex, ctx), _binanceExchangeInfo(exchangeClass), _baseUrls(urlConfig) {}
+session::session(net::any_io_executor ex, ssl::context& ctx, exchangeInfo* exchangeClass, const std::string& market,
+                 const std::string& host, const std::string& port, const std::string& target, int version) 
+: _executor(ex), _ctx(ctx), _resolver(ex), _binanceExchangeInfo(exchangeClass), _market(market), _baseUrl(host), _port(port), _hostKey(host + ":" + port),
+  _busy(false), _connected(false), _reusedConnection(false), _endpointsCached(false), _headerArena(_headerStorage.data(), _headerStorage.size()) {
+
+    // Set up an HTTP GET request message, sent again on every refresh
+    _req.version(version);
+    _req.method(http::verb::get);
+    _req.target(target);
+    _req.set(http::field::host, host);
+    _req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+    _req.keep_alive(true);
+}
 
     // Start the asynchronous operation
-void session::get( char const* host, char const* port, char const* target, int version)
+void session::get(std::shared_ptr<marketRequest> request)
+{
+    // previous request on this connection has not finished yet
+    if(_busy.exchange(true)){
+        spdlog::warn("Request to {} still in progress, skipping this refresh", _baseUrl);
+        if(request){
+            request->failed();
+        }
+        return;
+    }
+    net::dispatch(_executor, [self = shared_from_this(), request = std::move(request)]() mutable {
+        self->_request = std::move(request);
+        self->startRequest();
+    });
+}
+
+bool session::isConnected() const
+{
+    return _connected;
+}
+
+const std::string& session::hostKey() const
 {
-    spdlog::trace("Setting up get request for {} ", host);
-    _baseUrl = host;
+    return _hostKey;
+}
+
+void session::startRequest()
+{
+    SPDLOG_TRACE("Setting up get request for {} ", _baseUrl);
+    _trace.start();
+    _buffer.consume(_buffer.size());
+
+    // new parser for every response, the body is parsed while it arrives so the size is not limited
+    // the parse state is the session's and the header fields go to the arena, so a steady refresh allocates almost nothing
+    _parser.reset();
+    _headerArena.release();
+    _parser.emplace(std::piecewise_construct, std::make_tuple(&_body), std::make_tuple(headerAllocator(&_headerArena)));
+    _parser->body_limit(boost::none);
+    _body.record(_binanceExchangeInfo->isRecording() ? &_recording : nullptr);
+
+    // Send the request right away if the connection from the last refresh is still open
+    if(_connected){
+        _reusedConnection = true;
+        beast::get_lowest_layer(*_stream).expires_after(std::chrono::seconds(40));
+        http::async_write(*_stream, _req, beast::bind_front_handler(&session::onWrite, shared_from_this()));
+        return;
+    }
+
+    _reusedConnection = false;
+    _stream = std::make_unique<ssl::stream<beast::tcp_stream>>(_executor, _ctx);
+
     // Set SNI Hostname (many hosts need this to handshake successfully)
-    if(! SSL_set_tlsext_host_name(_stream.native_handle(), host))
+    if(! SSL_set_tlsext_host_name(_stream->native_handle(), _baseUrl.c_str()))
     {
         beast::error_code ec{static_cast<int>(::ERR_get_error()), net::error::get_ssl_category()};
-        spdlog::error("{}", ec.message());
-        return;
+        return session::fail(ec, "sni");
     }
 
-    // Set up an HTTP GET request message
-    _req.version(version);
-    _req.method(http::verb::get);
-    _req.target(target);
-    _req.set(http::field::host, host);
-    _req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+    // Skip the lookup if the host was resolved recently
+    tcp::resolver::results_type endpoints;
+    _endpointsCached = _binanceExchangeInfo->getSessionCache().findEndpoints(_baseUrl, _port, endpoints);
+    if(_endpointsCached){
+        return onResolve({}, endpoints);
+    }
 
     // Look up the domain name
-    _resolver.async_resolve(host, port, beast::bind_front_handler(&session::onResolve, shared_from_this()));
+    _resolver.async_resolve(_baseUrl, _port, beast::bind_front_handler(&session::onResolve, shared_from_this()));
+}
+
+void session::reconnect()
+{
+    SPDLOG_DEBUG("Connection to {} was closed by the server, reconnecting", _baseUrl);
+    _connected = false;
+    beast::error_code ec;
+    beast::get_lowest_layer(*_stream).socket().close(ec);
+    startRequest();
 }
 
 void session::onResolve(beast::error_code ec, tcp::resolver::results_type results)
 {
+    _trace.mark(traceStage::resolve);
     if(ec){
         return session::fail(ec, "resolve");
     }
+    if(!_endpointsCached){
+        _binanceExchangeInfo->getSessionCache().storeEndpoints(_baseUrl, _port, results);
+    }
     // Set a timeout on the operation
-    beast::get_lowest_layer(_stream).expires_after(std::chrono::seconds(40));
+    beast::get_lowest_layer(*_stream).expires_after(std::chrono::seconds(40));
 
     // Make the connection on the IP address we get from a lookup
-    beast::get_lowest_layer(_stream).async_connect(results, beast::bind_front_handler(&session::onConnect, shared_from_this()));
+    beast::get_lowest_layer(*_stream).async_connect(results, beast::bind_front_handler(&session::onConnect, shared_from_this()));
 }
 
 void session::onConnect(beast::error_code ec, tcp::resolver::results_type::endpoint_type)
 {
+    _trace.mark(traceStage::connect);
     if(ec){
+        _binanceExchangeInfo->getSessionCache().forgetEndpoints(_baseUrl, _port);
         return session::fail(ec, "connect");
     }
+    // Offer the tls session of an earlier connection so the server can resume it
+    _binanceExchangeInfo->getSessionCache().applyTlsSession(_baseUrl, _port, _stream->native_handle());
+
     // Perform the SSL handshake
-    _stream.async_handshake(ssl::stream_base::client, beast::bind_front_handler(&session::onHandshake, shared_from_this()));
+    _stream->async_handshake(ssl::stream_base::client, beast::bind_front_handler(&session::onHandshake, shared_from_this()));
 }
 
 void session::onHandshake(beast::error_code ec)
 {
+    _trace.mark(traceStage::handshake);
     if(ec){
         return session::fail(ec, "handshake");
     }
+    _connected = true;
+
+    // count resumed handshakes and keep the session for the next connection
+    sessionCache& cache = _binanceExchangeInfo->getSessionCache();
+    cache.countHandshake(SSL_session_reused(_stream->native_handle()));
+    cache.storeTlsSession(_baseUrl, _port, _stream->native_handle());
+
     // Set a timeout on the operation
-    beast::get_lowest_layer(_stream).expires_after(std::chrono::seconds(40));
+    beast::get_lowest_layer(*_stream).expires_after(std::chrono::seconds(40));
 
     // Send the HTTP request to the remote host
-    http::async_write(_stream, _req, beast::bind_front_handler(&session::onWrite, shared_from_this()));
+    http::async_write(*_stream, _req, beast::bind_front_handler(&session::onWrite, shared_from_this()));
 }
 
 void session::onWrite(beast::error_code ec, std::size_t bytes_transferred)
 {
     boost::ignore_unused(bytes_transferred);
+    _trace.mark(traceStage::write);
 
     if(ec){
+        // idle keep-alive connection was dropped by the server, open a new one once
+        if(_reusedConnection){
+            return reconnect();
+        }
         return session::fail(ec, "write");
     }
     // Receive the HTTP response
-    http::async_read(_stream, _buffer, _res, beast::bind_front_handler(&session::onRead, shared_from_this()));
+    http::async_read(*_stream, _buffer, *_parser, beast::bind_front_handler(&session::onRead, shared_from_this()));
 }
 
 void session::onRead(beast::error_code ec, std::size_t bytes_transferred)
 {
-    spdlog::trace("Reading http data from {} ", _baseUrl);
-    boost::ignore_unused(bytes_transferred);
+    SPDLOG_TRACE("Reading http data from {} ", _baseUrl);
+    _trace.mark(traceStage::read);
+
+    // used weight and rejections count even if the body could not be read
+    if(_parser->is_header_done()){
+        updateRateLimit();
+    }
 
     if(ec){
+        // server closed the idle connection before answering, open a new one once
+        if(_reusedConnection && bytes_transferred == 0){
+            return reconnect();
+        }
         return session::fail(ec, "read");
     }
 
     this->processResponse();
+    _trace.mark(traceStage::process);
     spdlog::info("HTTP request of {} completed.", _baseUrl);
 
+    // tls 1.3 tickets arrive after the handshake, store the session again
+    _binanceExchangeInfo->getSessionCache().storeTlsSession(_baseUrl, _port, _stream->native_handle());
+
+    // Keep the connection for the next refresh if the server allows it
+    if(_parser->get().keep_alive()){
+        beast::get_lowest_layer(*_stream).expires_never();
+        recordTrace();
+        _busy = false;
+        return;
+    }
+
     // Set a timeout on the operation
-    beast::get_lowest_layer(_stream).expires_after(std::chrono::seconds(40));
+    beast::get_lowest_layer(*_stream).expires_after(std::chrono::seconds(40));
 
     // Gracefully close the stream
-    _stream.async_shutdown(beast::bind_front_handler(&session::onShutdown, shared_from_this()));
+    _connected = false;
+    _stream->async_shutdown(beast::bind_front_handler(&session::onShutdown, shared_from_this()));
 }
 
 void session::processResponse(){
-    spdlog::trace("Processing http data from {} ", _baseUrl);
-    // Parse body of HTTP response as JSON
-    rapidjson::Document fullData;
-    fullData.Parse(_res.body().c_str());
+    SPDLOG_TRACE("Processing http data from {} ", _baseUrl);
 
-    // Check if parsed data is object and contains symbols array
-    if (!fullData.IsObject() || !fullData.HasMember("symbols") || !fullData["symbols"].IsArray()) {
+    // symbols were already pulled out of the body while it was read
+    exchangeInfoStreamParser& parsed = _body;
+    if (_parser->get().result() != http::status::ok) {
+        spdlog::error("{} answered with status {}", _baseUrl, _parser->get().result_int());
+    }
+
+    // Check if parsed data contains symbols array
+    if (!parsed.hasSymbols()) {
         spdlog::error("Invalid JSON format or missing symbols array.");
+        reportFailure();
         return;
     }
 
-    // Access the "symbols" array
-    const auto& symbolsArray = fullData["symbols"];
+    // another host of the market answered first
+    std::shared_ptr<marketRequest> request = std::move(_request);
+    if (request && !request->claim()) {
+        SPDLOG_DEBUG("{} answered {} after another host, response dropped", _baseUrl, _market);
+        return;
+    }
 
-    // iterate over array
-    for (const auto& symbol : symbolsArray.GetArray()) {
-        symbolInfo info;                                    // structure to hold symbol info
-        info.symbol = symbol["symbol"].GetString();         // get symbol name
-        info.quoteAsset = symbol["quoteAsset"].GetString(); // get quote asset
-        if (symbol.HasMember("status")){
-            info.status = symbol["status"].GetString();     // get status for spot and coin future
-        }
-        if (symbol.HasMember("contractStatus")){
-            info.status = symbol["contractStatus"].GetString();     // since usd future api has key contractStatus instead of status
-        }           
-
-        // Iterate over filters array
-        for (const auto& filter : symbol["filters"].GetArray()) {
-            std::string filterType = filter["filterType"].GetString();  // get filter type
-            if (filterType == "PRICE_FILTER") {
-                info.tickSize = filter["tickSize"].GetString();         // get tick size if filter is PRICE_FILTER
-            } else if (filterType == "LOT_SIZE") {
-                info.stepSize = filter["stepSize"].GetString();         // get step size if filter is LOT_SIZE
-            }
-        }
+    // keep the raw response for offline replay
+    if (_parser->get().result() == http::status::ok && _binanceExchangeInfo->isRecording()) {
+        _binanceExchangeInfo->recordResponse(_market, _recording);
+    }
 
-        // Store symbol info in binanceExchange relevant map with symbol name as key
-        if(_baseUrl == _baseUrls.spotExchangeBaseUrl) { 
-            _binanceExchangeInfo->setSpotSymbol(info.symbol, info); 
-        }
-        if(_baseUrl == _baseUrls.usdFutureExchangeBaseUrl) { 
-            _binanceExchangeInfo->setUsdSymbol(info.symbol, info); 
-        }
-        if(_baseUrl == _baseUrls.coinFutureExchangeBaseUrl) { 
-            _binanceExchangeInfo->setCoinSymbol(info.symbol, info); 
-        } 
-   
+    // apply only what changed since the last refresh, readers keep using the previous table until it is published
+    _binanceExchangeInfo->refreshMarket(_market, parsed.symbols());
+    if (request) {
+        _binanceExchangeInfo->requestFinished(_market);
     }
 
     // Output total number of symbols found
-    if(_baseUrl == _baseUrls.spotExchangeBaseUrl) { 
-        spdlog::info("Total SPOT symbols: {}", _binanceExchangeInfo->getSpotSymbolsSize()); 
+    spdlog::info("Total {} symbols: {}", _market, _binanceExchangeInfo->getSymbolsSize(_market));
+}
+
+// Header value as a number, 0 if it is missing or not a number
+static unsigned headerNumber(boost::beast::string_view value)
+{
+    unsigned number = 0;
+    std::from_chars(value.data(), value.data() + value.size(), number);
+    return number;
+}
+
+void session::updateRateLimit()
+{
+    auto& response = _parser->get();
+    rateLimiter& limiter = _binanceExchangeInfo->getRateLimiter();
+
+    // futures apis only send the header without interval
+    auto weight = response.find("X-MBX-USED-WEIGHT-1M");
+    if(weight == response.end()){
+        weight = response.find("X-MBX-USED-WEIGHT");
     }
-    if(_baseUrl == _baseUrls.usdFutureExchangeBaseUrl) { 
-        spdlog::info("Total usd futures symbols: {}", _binanceExchangeInfo->getUsdSymbolsSize()); 
+    if(weight != response.end()){
+        limiter.updateUsedWeight(headerNumber(weight->value()));
     }
-    if(_baseUrl == _baseUrls.coinFutureExchangeBaseUrl) { 
-        spdlog::info("Total coin futures symbols: {}", _binanceExchangeInfo->getCoinSymbolsSize());
+
+    // 429 asks to slow down, 418 means the ip is banned for Retry-After seconds
+    unsigned status = response.result_int();
+    if(status == 429 || status == 418){
+        limiter.reject(status, std::chrono::seconds(headerNumber(response[http::field::retry_after])));
+    }
+    else{
+        limiter.accept();
     }
 }
 
 void session::onShutdown(beast::error_code ec)
 {
-    if(ec != net::ssl::error::stream_truncated){
+    _trace.mark(traceStage::shutdown);
+    recordTrace();
+    _busy = false;
+    if(ec && ec != net::ssl::error::stream_truncated){
         return session::fail(ec, "shutdown");
     }
 }
 
+void session::recordTrace()
+{
+    _trace.finish();
+    _binanceExchangeInfo->getLatencyStats().record(_hostKey, _trace);
+    SPDLOG_DEBUG("{} {}: total {} us, read {} us, process {} us", _baseUrl, _market,
+                 _trace.duration(traceStage::total) / 1000, _trace.duration(traceStage::read) / 1000, _trace.duration(traceStage::process) / 1000);
+}
+
 // Report a failure
 void session::fail(beast::error_code ec, char const* what)
 {
     spdlog::error("{}: {}\n", what, ec.message());
+
+    // shutdown errors come after the refresh finished
+    if(_busy){
+        reportFailure();
+    }
+
+    // drop the connection, the next refresh opens a new one
+    if(_stream){
+        beast::error_code closeEc;
+        beast::get_lowest_layer(*_stream).socket().close(closeEc);
+    }
+    _connected = false;
+    _busy = false;
+}
+
+void session::reportFailure()
+{
+    // asked after the other hosts of the market for a while
+    _binanceExchangeInfo->getLatencyStats().recordFailure(_hostKey);
+    if(_request){
+        _request->failed();
+        _request.reset();
+        return;
+    }
+    // tried again after the interval of the market
+    _binanceExchangeInfo->refreshFailed(_market);
+}
+
+marketRequest::marketRequest(net::io_context& ioc, exchangeInfo* exchangeClass, const std::string& market,
+                             std::vector<std::shared_ptr<session>> sessions, std::chrono::nanoseconds hedgeDelay)
+: _strand(net::make_strand(ioc)), _timer(_strand), _binanceExchangeInfo(exchangeClass), _market(market), _sessions(std::move(sessions)),
+  _hedgeDelay(hedgeDelay), _next(0), _inFlight(0), _done(false) {}
+
+void marketRequest::start()
+{
+    net::dispatch(_strand, [self = shared_from_this()] { self->sendNext(); });
+}
+
+void marketRequest::failed()
+{
+    // posted so a session failing inside sendNext does not run into it again
+    net::post(_strand, [self = shared_from_this()] {
+        --self->_inFlight;
+        if(self->_done){
+            return;
+        }
+        self->_timer.cancel();
+        if(!self->sendNext() && self->_inFlight == 0){
+            spdlog::error("All hosts of {} failed", self->_market);
+            self->_binanceExchangeInfo->refreshFailed(self->_market);
+            self->_binanceExchangeInfo->requestFinished(self->_market);
+        }
+    });
+}
+
+bool marketRequest::claim()
+{
+    if(_done.exchange(true)){
+        return false;
+    }
+    // no hedge is needed anymore
+    net::post(_strand, [self = shared_from_this()] { self->_timer.cancel(); });
+    return true;
+}
+
+bool marketRequest::sendNext()
+{
+    if(_done || _next == _sessions.size()){
+        return false;
+    }
+    size_t index = _next++;
+    ++_inFlight;
+    _sessions[index]->get(shared_from_this());
+
+    // next host gets the request too if this one is slower than usual
+    if(_next < _sessions.size() && _hedgeDelay.count() > 0){
+        _timer.expires_after(_hedgeDelay);
+        _timer.async_wait(beast::bind_front_handler(&marketRequest::onHedge, shared_from_this()));
+    }
+    return true;
+}
+
+void marketRequest::onHedge(beast::error_code ec)
+{
+    if(ec || _done){
+        return;
+    }
+    spdlog::info("No answer for {} within {} ms, hedging to the next host", _market,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(_hedgeDelay).count());
+    // a host that keeps stalling is not asked first on the next refreshes
+    _binanceExchangeInfo->getLatencyStats().recordFailure(_sessions[_next - 1]->hostKey());
+    sendNext();
+}
+
+net::execution_context::id connectionPool::id;
+
+connectionPool::connectionPool(net::execution_context& context) 
+: net::execution_context::service(context) {}
+
+std::shared_ptr<session> connectionPool::getSession(net::io_context& ioc, ssl::context& ctx, exchangeInfo* exchangeClass,
+                                                    const std::string& market, const std::string& host, const std::string& port,
+                                                    const std::string& target, int version)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto key = std::make_pair(static_cast<const exchangeInfo*>(exchangeClass), market + "|" + host + ":" + port + target);
+    auto it = _sessions.find(key);
+    if(it != _sessions.end()){
+        return it->second;
+    }
+
+    // The session is constructed with a strand to ensure that handlers do not execute concurrently.
+    auto newSession = std::make_shared<session>(net::make_strand(ioc), ctx, exchangeClass, market, host, port, target, version);
+    _sessions.emplace(key, newSession);
+    return newSession;
+}
+
+void connectionPool::attach(exchangeInfo* exchangeClass)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _owners.insert(exchangeClass);
+}
+
+void connectionPool::release(const exchangeInfo* exchangeClass)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _owners.erase(const_cast<exchangeInfo*>(exchangeClass));
+    for(auto it = _sessions.begin(); it != _sessions.end(); ){
+        if(it->first.first == exchangeClass){
+            it = _sessions.erase(it);
+        }
+        else{
+            ++it;
+        }
+    }
+}
+
+size_t connectionPool::size()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _sessions.size();
+}
+
+// io_context is being destroyed, close connections while its services still exist
+void connectionPool::shutdown()
+{
+    std::set<exchangeInfo*> owners;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        owners.swap(_owners);
+        _sessions.clear();
+    }
+    // owners must not release this pool anymore, it goes away with the io_context
+    for(exchangeInfo* owner : owners){
+        owner->poolClosed(this);
+    }
 }
 
@@ -1,23 +1,98 @@
 #ifndef getHttpsData_H
 #define getHttpsData_H
 
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <vector>
+
 #include "example/common/root_certificates.hpp"
 #include "boost/beast/core.hpp"
 #include "boost/beast/http.hpp"
 #include "boost/beast/version.hpp"
 #include "boost/asio/ssl.hpp"
+#include "boost/asio/steady_timer.hpp"
+#include "boost/asio/strand.hpp"
 #include "BinanceExchange.h"
+#include "exchangeInfoParser.h"
+
+// beast body that parses the exchangeInfo response chunk by chunk while it is being received
+// the body is a pointer to a parser owned by the session, so its buffers and symbol slots are reused by every response
+struct exchangeInfoBody
+{
+    using value_type = exchangeInfoStreamParser*;
+
+    class reader
+    {
+        public:
+            template<bool isRequest, class Fields>
+            reader(boost::beast::http::header<isRequest, Fields>&, value_type& body) : _body(body) {}
+
+            void init(boost::optional<std::uint64_t> const&, boost::beast::error_code& ec) {
+                _body->reset();
+                ec = {};
+            }
+
+            template<class ConstBufferSequence>
+            std::size_t put(ConstBufferSequence const& buffers, boost::beast::error_code& ec) {
+                std::size_t parsed = 0;
+                for(auto it = boost::asio::buffer_sequence_begin(buffers); it != boost::asio::buffer_sequence_end(buffers); ++it){
+                    boost::asio::const_buffer buffer = *it;
+                    if(!_body->feed(static_cast<const char*>(buffer.data()), buffer.size())){
+                        ec = boost::asio::error::invalid_argument;
+                        return parsed;
+                    }
+                    parsed += buffer.size();
+                }
+                ec = {};
+                return parsed;
+            }
+
+            void finish(boost::beast::error_code& ec) {
+                ec = {};
+                if(!_body->finish()){
+                    ec = boost::asio::error::invalid_argument;
+                }
+            }
+
+        private:
+            value_type& _body;
+    };
+};
+
+// allocator of the response header fields, they live in the header arena of the session
+using headerAllocator = std::pmr::polymorphic_allocator<char>;
 
-// Performs an HTTP GET and prints the response
+class marketRequest;
+
+// Performs HTTP GETs for one market and keeps the connection open between requests
 class session : public std::enable_shared_from_this<session>
 {
     public:
-        session(boost::asio::any_io_executor, boost::asio::ssl::context&, exchangeInfo*, urlInfo&);
+        session(boost::asio::any_io_executor, boost::asio::ssl::context&, exchangeInfo*, const std::string&,
+                const std::string&, const std::string&, const std::string&, int);
+
+        // Start the asynchronous operation, reuses the open connection if there is one
+        // with a market request the response is only applied if it is the first of its hosts, failures go to it
+        void get(std::shared_ptr<marketRequest> request = nullptr);
+
+        // check if connection to host is open
+        bool isConnected() const;
+
+        // "host:port" the session connects to, its latency stats are kept under it
+        const std::string& hostKey() const;
+
+    private:
+        void startRequest();
 
-        // Start the asynchronous operation
-        void get(char const*, char const*, char const*, int);
+        // close current connection and start again from resolve
+        void reconnect();
 
-    private: 
         void onResolve(boost::beast::error_code, boost::asio::ip::tcp::resolver::results_type);
 
         void onConnect(boost::beast::error_code, boost::asio::ip::tcp::resolver::results_type::endpoint_type);
@@ -27,23 +102,110 @@ class session : public std::enable_shared_from_this<session>
         void onWrite(boost::beast::error_code, std::size_t);
 
         void onRead(boost::beast::error_code, std::size_t);
-        
+
         void processResponse();
 
+        // Pass used weight, 429 and 418 answers of the response to the rate limiter
+        void updateRateLimit();
+
         void onShutdown(boost::beast::error_code);
 
+        // Add the timings of the finished request to the stats of the host
+        void recordTrace();
+
         // Report a failure
         void fail(boost::beast::error_code, char const*);
 
+        // Request brought no symbols, the market request tries the next host, without one the refresh failed
+        void reportFailure();
+
+        boost::asio::any_io_executor _executor;
+        boost::asio::ssl::context& _ctx;
         boost::asio::ip::tcp::resolver _resolver;
-        ssl::stream<boost::beast::tcp_stream> _stream;
+        std::unique_ptr<ssl::stream<boost::beast::tcp_stream>> _stream;
         boost::beast::flat_buffer _buffer;
         boost::beast::http::request<boost::beast::http::empty_body> _req;
-        boost::beast::http::response<boost::beast::http::string_body> _res;
-        exchangeInfo* _binanceExchangeInfo; 
+        exchangeInfo* _binanceExchangeInfo;
+        std::string _market;
         std::string _baseUrl;
-        urlInfo _baseUrls;
+        std::string _port;
+        std::string _hostKey;           // host and port, alternates on one host with different ports have their own stats
+        std::atomic<bool> _busy;        // request in progress, new requests are skipped
+        std::atomic<bool> _connected;   // keep-alive connection is open
+        bool _reusedConnection;         // current request was sent on a connection opened earlier
+        bool _endpointsCached;          // endpoints of current connection came from the session cache
+        std::string _recording;         // raw body of the current response while record mode is on
+        sessionTrace _trace;            // stage timings of the current request
+        std::shared_ptr<marketRequest> _request;    // refresh over several hosts the current request belongs to
+        exchangeInfoStreamParser _body;     // parse state and symbols, reused across refresh cycles
+        std::array<char, 4096> _headerStorage;
+        std::pmr::monotonic_buffer_resource _headerArena;   // header fields of the current response, released before the next one
+        std::optional<boost::beast::http::response_parser<exchangeInfoBody, headerAllocator>> _parser;
+};
+
+// one refresh of a market over several hosts, ordered by latency with the fastest first
+// the next host gets the request when the previous one failed or has not answered within the hedge delay
+// the first response with symbols is applied, later ones are dropped
+class marketRequest : public std::enable_shared_from_this<marketRequest>
+{
+    public:
+        marketRequest(boost::asio::io_context&, exchangeInfo*, const std::string&, std::vector<std::shared_ptr<session>>,
+                      std::chrono::nanoseconds);
+
+        // Send the request to the first host
+        void start();
+
+        // Request to one of the hosts failed, send it to the next one right away
+        void failed();
+
+        // Session has a response with symbols, returns true if it is the first and should be applied
+        bool claim();
+
+    private:
+        // Send to the next host and arm the hedge timer while hosts are left, returns false if none is left
+        bool sendNext();
+
+        void onHedge(boost::beast::error_code);
+
+        boost::asio::strand<boost::asio::io_context::executor_type> _strand;
+        boost::asio::steady_timer _timer;
+        exchangeInfo* _binanceExchangeInfo;
+        std::string _market;
+        std::vector<std::shared_ptr<session>> _sessions;
+        std::chrono::nanoseconds _hedgeDelay;   // zero only fails over
+        size_t _next;           // index of the next host, used on the strand only
+        size_t _inFlight;       // requests sent that have not failed, used on the strand only
+        std::atomic<bool> _done;
+};
+
+// keeps one session per market alive across refresh cycles, lives as long as the io_context it belongs to
+class connectionPool : public boost::asio::execution_context::service
+{
+    public:
+        using key_type = connectionPool;
+        static boost::asio::execution_context::id id;
+
+        explicit connectionPool(boost::asio::execution_context&);
+
+        // Get session of owner for market, creates it with the given arguments if there is none
+        std::shared_ptr<session> getSession(boost::asio::io_context&, boost::asio::ssl::context&, exchangeInfo*,
+                                            const std::string&, const std::string&, const std::string&, const std::string&, int);
+
+        // Remember owner, it is told with poolClosed when the io_context shuts the pool down
+        void attach(exchangeInfo*);
+
+        // Drop all sessions of owner, open connections are closed
+        void release(const exchangeInfo*);
+
+        // number of sessions in the pool
+        size_t size();
+
+    private:
+        void shutdown() override;
 
+        std::mutex _mutex;
+        std::map<std::pair<const exchangeInfo*, std::string>, std::shared_ptr<session>> _sessions;
+        std::set<exchangeInfo*> _owners;
 };
 
-#endif // getHttpsData_H
\ No newline at end of file
+#endif // getHttpsData_H
@@ -0,0 +1,49 @@
+#include "ioThreadPool.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+
+#include "spdlog/spdlog.h"
+
+ioThreadPool::ioThreadPool(boost::asio::io_context& ioc) : _ioc(ioc) {}
+
+ioThreadPool::~ioThreadPool() {
+    join();
+}
+
+void ioThreadPool::start(size_t threads, const std::vector<int>& cpus) {
+    threads = threads == 0 ? 1 : threads;
+    for (size_t index = 0; index < threads; ++index) {
+        int cpu = cpus.empty() ? -1 : cpus[index % cpus.size()];
+        _threads.emplace_back([this, index, cpu] {
+            // name and pin the thread before it runs any handler
+            std::string name = "io-" + std::to_string(index);
+            pthread_setname_np(pthread_self(), name.c_str());
+            if (cpu >= 0) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpu, &set);
+                int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+                if (error != 0) {
+                    spdlog::warn("Unable to pin {} to cpu {}: error {}", name, cpu, error);
+                }
+            }
+            _ioc.run();
+        });
+    }
+    SPDLOG_DEBUG("Running io_context on {} threads", _threads.size());
+}
+
+void ioThreadPool::join() {
+    for (auto& thread : _threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    _threads.clear();
+}
+
+size_t ioThreadPool::size() const {
+    return _threads.size();
+}
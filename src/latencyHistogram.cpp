@@ -0,0 +1,74 @@
+#include "latencyHistogram.h"
+
+#include <cmath>
+
+latencyHistogram::latencyHistogram() : _count(0), _sum(0), _max(0) {
+    for (auto& bucket : _buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+unsigned latencyHistogram::bucketOf(uint64_t value) {
+    // values below 2 * subBuckets get a bucket each, above that every power of two is split into subBuckets
+    if (value < 2 * subBuckets) {
+        return unsigned(value);
+    }
+    unsigned shift = 63 - __builtin_clzll(value) - subBucketBits;
+    return shift * subBuckets + unsigned(value >> shift);
+}
+
+uint64_t latencyHistogram::highestValueOf(unsigned bucket) {
+    if (bucket < 2 * subBuckets) {
+        return bucket;
+    }
+    unsigned shift = bucket / subBuckets - 1;
+    uint64_t lowest = uint64_t(bucket % subBuckets + subBuckets) << shift;
+    return lowest + ((uint64_t(1) << shift) - 1);
+}
+
+void latencyHistogram::record(int64_t duration) {
+    if (duration < 0) {
+        return;
+    }
+    uint64_t value = uint64_t(duration);
+    _buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t previous = _max.load(std::memory_order_relaxed);
+    while (value > previous && !_max.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {
+    }
+    _count.fetch_add(1, std::memory_order_release);
+}
+
+uint64_t latencyHistogram::count() const {
+    return _count.load(std::memory_order_acquire);
+}
+
+uint64_t latencyHistogram::percentile(double percent) const {
+    uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t target = uint64_t(std::ceil(percent / 100.0 * double(total)));
+    target = target == 0 ? 1 : target;
+
+    // counts may move on while we walk, the answer is then close to a concurrent state
+    uint64_t seen = 0;
+    uint64_t largest = max();
+    for (unsigned bucket = 0; bucket < bucketCount; ++bucket) {
+        seen += _buckets[bucket].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            uint64_t value = highestValueOf(bucket);
+            return value < largest ? value : largest;
+        }
+    }
+    return largest;
+}
+
+uint64_t latencyHistogram::max() const {
+    return _max.load(std::memory_order_relaxed);
+}
+
+uint64_t latencyHistogram::mean() const {
+    uint64_t total = count();
+    return total == 0 ? 0 : _sum.load(std::memory_order_relaxed) / total;
+}
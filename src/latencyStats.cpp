@@ -0,0 +1,79 @@
+#include "latencyStats.h"
+
+const char* traceStageName(traceStage stage) {
+    static const char* names[] = {"resolve", "connect", "handshake", "write", "read", "process", "shutdown", "total"};
+    return stage < traceStage::count ? names[size_t(stage)] : "unknown";
+}
+
+sessionTrace::sessionTrace() {
+    start();
+}
+
+void sessionTrace::start() {
+    _durations.fill(-1);
+    _started = std::chrono::steady_clock::now();
+    _last = _started;
+}
+
+void sessionTrace::mark(traceStage stage) {
+    auto now = std::chrono::steady_clock::now();
+    _durations[size_t(stage)] = std::chrono::duration_cast<std::chrono::nanoseconds>(now - _last).count();
+    _last = now;
+}
+
+void sessionTrace::finish() {
+    _durations[size_t(traceStage::total)] = std::chrono::duration_cast<std::chrono::nanoseconds>(_last - _started).count();
+}
+
+int64_t sessionTrace::duration(traceStage stage) const {
+    return _durations[size_t(stage)];
+}
+
+void latencyStats::record(const std::string& host, const sessionTrace& trace) {
+    histograms* hostHistograms;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto& entry = _hosts[host];
+        if (!entry) {
+            entry.reset(new histograms());
+        }
+        hostHistograms = entry.get();
+    }
+    // histograms are never removed, recording needs no lock
+    for (size_t stage = 0; stage < sessionTrace::stageCount; ++stage) {
+        (*hostHistograms)[stage].record(trace.duration(traceStage(stage)));
+    }
+}
+
+void latencyStats::forEachHost(const std::function<void(const std::string&, const histograms&)>& fn) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& host : _hosts) {
+        fn(host.first, *host.second);
+    }
+}
+
+const latencyHistogram* latencyStats::find(const std::string& host, traceStage stage) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _hosts.find(host);
+    return it == _hosts.end() ? nullptr : &(*it->second)[size_t(stage)];
+}
+
+void latencyStats::recordFailure(const std::string& host, std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    hostFailures& failures = _failures[host];
+    ++failures.count;
+    failures.last = now;
+}
+
+bool latencyStats::failedWithin(const std::string& host, std::chrono::steady_clock::duration duration,
+                                std::chrono::steady_clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _failures.find(host);
+    return it != _failures.end() && now - it->second.last < duration;
+}
+
+uint64_t latencyStats::failures(const std::string& host) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _failures.find(host);
+    return it == _failures.end() ? 0 : it->second.count;
+}
@@ -0,0 +1,42 @@
+#include "marketRegistry.h"
+
+#include "spdlog/spdlog.h"
+
+marketRegistry::marketRegistry() : _size(0) {
+    add("SPOT");
+    add("usd_futures");
+    add("coin_futures");
+}
+
+size_t marketRegistry::add(const std::string& name) {
+    size_t existing = find(name);
+    if (existing != unknown) {
+        return existing;
+    }
+    size_t index = _size.load();
+    if (index == maxMarkets) {
+        spdlog::error("Market {} not added, at most {} markets are supported", name, maxMarkets);
+        return unknown;
+    }
+    _markets[index].reset(new marketState());
+    _markets[index]->name = name;
+    // readers only look at markets below size, publish the new one after it is complete
+    _size.store(index + 1, std::memory_order_release);
+    return index;
+}
+
+size_t marketRegistry::find(std::string_view name) const {
+    size_t count = size();
+    for (size_t index = 0; index < count; ++index) {
+        const std::string& candidate = _markets[index]->name;
+        if (candidate.size() == name.size() && candidate == name) {
+            return index;
+        }
+    }
+    return unknown;
+}
+
+unsigned marketRegistry::allBits() const {
+    size_t count = size();
+    return count == maxMarkets ? ~0u : (1u << count) - 1;
+}
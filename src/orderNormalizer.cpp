@@ -0,0 +1,57 @@
+#include "orderNormalizer.h"
+
+// powers of ten that fit into 64 bits
+static const uint64_t powersOfTen[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+    10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+    1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+bool roundToStep(const fixedDecimal& value, const fixedDecimal& step, roundingMode mode, fixedDecimal& rounded, bool& changed) {
+    changed = false;
+    if (step.empty() || step.units() == 0) {
+        rounded = value;
+        return true;
+    }
+
+    // bring both to the larger scale, 128 bit so the shifted values cannot overflow
+    unsigned scale = value.scale() > step.scale() ? value.scale() : step.scale();
+    if (scale - value.scale() >= 20 || scale - step.scale() >= 20) {
+        return false;
+    }
+    unsigned __int128 units = (unsigned __int128)value.units() * powersOfTen[scale - value.scale()];
+    unsigned __int128 stepUnits = (unsigned __int128)step.units() * powersOfTen[scale - step.scale()];
+
+    unsigned __int128 steps = units / stepUnits;
+    unsigned __int128 remainder = units % stepUnits;
+    changed = remainder != 0;
+    if (changed) {
+        if (mode == roundingMode::up || (mode == roundingMode::nearest && remainder * 2 >= stepUnits)) {
+            ++steps;
+        }
+    }
+    if (mode == roundingMode::validate) {
+        rounded = value;
+        return true;
+    }
+
+    unsigned __int128 result = steps * stepUnits;
+    if (result > UINT64_MAX) {
+        return false;
+    }
+    return fixedDecimal::fromUnits(uint64_t(result), scale, rounded);
+}
+
+normalizeStatus normalizeOrder(const symbolRecord& record, const fixedDecimal& price, const fixedDecimal& quantity, roundingMode mode, orderResult& result) {
+    bool priceChanged, quantityChanged;
+    if (price.empty() || !roundToStep(price, record.tickSize, mode, result.price, priceChanged) || result.price.units() == 0) {
+        return result.status = normalizeStatus::invalidPrice;
+    }
+    if (quantity.empty() || !roundToStep(quantity, record.stepSize, mode, result.quantity, quantityChanged) || result.quantity.units() == 0) {
+        return result.status = normalizeStatus::invalidQuantity;
+    }
+    if (!priceChanged && !quantityChanged) {
+        return result.status = normalizeStatus::ok;
+    }
+    return result.status = mode == roundingMode::validate ? normalizeStatus::offGrid : normalizeStatus::adjusted;
+}
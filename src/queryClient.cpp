@@ -0,0 +1,118 @@
+#include "queryClient.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "spdlog/spdlog.h"
+
+queryClient::queryClient()
+: _fd(-1) {}
+
+queryClient::~queryClient() {
+    close();
+}
+
+bool queryClient::connectUnix(const std::string& path) {
+    close();
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        spdlog::error("Socket path {} is too long", path);
+        return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size());
+
+    _fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (_fd < 0 || ::connect(_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        spdlog::error("Unable to connect to {}: {}", path, strerror(errno));
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool queryClient::connectTcp(const std::string& host, unsigned short port) {
+    close();
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* results = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &results) != 0) {
+        spdlog::error("Unable to resolve {}", host);
+        return false;
+    }
+    for (addrinfo* result = results; result; result = result->ai_next) {
+        _fd = ::socket(result->ai_family, result->ai_socktype | SOCK_CLOEXEC, result->ai_protocol);
+        if (_fd >= 0 && ::connect(_fd, result->ai_addr, result->ai_addrlen) == 0) {
+            break;
+        }
+        close();
+    }
+    freeaddrinfo(results);
+    if (_fd < 0) {
+        spdlog::error("Unable to connect to {}:{}", host, port);
+        return false;
+    }
+    int noDelay = 1;
+    setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return true;
+}
+
+bool queryClient::send(const std::string& lines) {
+    const char* data = lines.data();
+    size_t remaining = lines.size();
+    while (remaining > 0) {
+        ssize_t written = ::send(_fd, data, remaining, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        remaining -= written;
+    }
+    return true;
+}
+
+bool queryClient::receive(std::string& answer) {
+    size_t newline;
+    while ((newline = _buffer.find('\n')) == std::string::npos) {
+        char chunk[16384];
+        ssize_t length = ::recv(_fd, chunk, sizeof(chunk), 0);
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length <= 0) {
+            return false;
+        }
+        _buffer.append(chunk, length);
+    }
+    answer.assign(_buffer, 0, newline);
+    _buffer.erase(0, newline + 1);
+    return true;
+}
+
+bool queryClient::request(const std::string& line, std::string& answer) {
+    if (line.empty() || line.back() != '\n') {
+        return send(line + '\n') && receive(answer);
+    }
+    return send(line) && receive(answer);
+}
+
+void queryClient::close() {
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+    _buffer.clear();
+}
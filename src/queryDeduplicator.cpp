@@ -0,0 +1,82 @@
+#include "queryDeduplicator.h"
+
+#include <limits>
+
+queryDeduplicator::queryDeduplicator(size_t capacity)
+: _capacity(capacity > 0 ? capacity : 1), _hasRun(false), _runFirst(0), _runLast(0) {
+    _ids.reserve(_capacity < 65536 ? _capacity : 65536);
+}
+
+bool queryDeduplicator::insert(unsigned long long id) {
+    if (seen(id)) {
+        return false;
+    }
+
+    // the first id starts the run, it grows at both ends
+    if (!_hasRun) {
+        _runFirst = _runLast = id;
+        _hasRun = true;
+        return true;
+    }
+    if (id > _runLast && id - _runLast == 1) {
+        _runLast = id;
+        extendRun();
+        return true;
+    }
+    if (id < _runFirst && _runFirst - id == 1) {
+        _runFirst = id;
+        extendRun();
+        return true;
+    }
+
+    _ids.insert(id);
+    _order.push_back(id);
+
+    // forget the oldest out of order id once over capacity, never the one just added
+    if (_ids.size() > _capacity) {
+        while (_ids.erase(_order.front()) == 0) {
+            _order.pop_front();
+        }
+        _order.pop_front();
+    }
+
+    // drop ids the run took over so the order does not grow while the set stays small
+    if (_order.size() > 2 * _capacity) {
+        std::deque<unsigned long long> order;
+        for (unsigned long long stored : _order) {
+            if (_ids.count(stored)) {
+                order.push_back(stored);
+            }
+        }
+        _order.swap(order);
+    }
+    return true;
+}
+
+void queryDeduplicator::extendRun() {
+    while (_runLast != std::numeric_limits<unsigned long long>::max() && _ids.erase(_runLast + 1)) {
+        ++_runLast;
+    }
+    while (_runFirst != 0 && _ids.erase(_runFirst - 1)) {
+        --_runFirst;
+    }
+}
+
+bool queryDeduplicator::seen(unsigned long long id) const {
+    if (_hasRun && id >= _runFirst && id <= _runLast) {
+        return true;
+    }
+    return _ids.find(id) != _ids.end();
+}
+
+size_t queryDeduplicator::size() const {
+    return _ids.size();
+}
+
+void queryDeduplicator::clear() {
+    _ids.clear();
+    _order.clear();
+    _hasRun = false;
+    _runFirst = 0;
+    _runLast = 0;
+}
@@ -0,0 +1,253 @@
+#include "queryServer.h"
+
+#include <charconv>
+#include <optional>
+#include <type_traits>
+#include <unistd.h>
+
+#include "boost/asio/read.hpp"
+#include "boost/asio/steady_timer.hpp"
+#include "boost/asio/write.hpp"
+#include "spdlog/spdlog.h"
+
+namespace net = boost::asio;
+using tcp = boost::asio::ip::tcp;
+
+// interval at which held requests check again if every market is loaded
+static const auto holdInterval = std::chrono::milliseconds(50);
+
+// one client connection, reads request lines and writes the answers back
+template <typename Socket>
+class queryConnection : public std::enable_shared_from_this<queryConnection<Socket>>
+{
+    public:
+        queryConnection(Socket&& socket, exchangeInfo& exchange, std::shared_ptr<std::atomic<unsigned long long>> requests)
+        : _socket(std::move(socket)), _exchange(exchange), _requests(std::move(requests)), _holdTimer(_socket.get_executor()) {}
+
+        void start() {
+            doRead();
+        }
+
+    private:
+        void doRead() {
+            auto self = this->shared_from_this();
+            _socket.async_read_some(net::buffer(_readBuffer), [self](boost::system::error_code ec, std::size_t length) {
+                self->onRead(ec, length);
+            });
+        }
+
+        void onRead(boost::system::error_code ec, std::size_t length) {
+            if (ec) {
+                return;
+            }
+            _input.append(_readBuffer, length);
+
+            // requests wait for the markets like the ones of the query file, the line stays in the input until then
+            if (_exchange.holdQueries()) {
+                auto self = this->shared_from_this();
+                _holdTimer.expires_after(holdInterval);
+                _holdTimer.async_wait([self](boost::system::error_code ec) {
+                    self->onRead(ec, 0);
+                });
+                return;
+            }
+
+            // answer every complete line, a partial line waits for the next read
+            size_t start = 0;
+            size_t end;
+            unsigned long long answered = 0;
+            while ((end = _input.find('\n', start)) != std::string::npos) {
+                std::string_view line(_input.data() + start, end - start);
+                if (!line.empty() && line.back() == '\r') {
+                    line.remove_suffix(1);
+                }
+                queryServer::handleRequest(_exchange, line, _output);
+                start = end + 1;
+                ++answered;
+            }
+            _input.erase(0, start);
+            *_requests += answered;
+
+            // a partial line this long is no request, do not buffer it any further
+            if (_input.size() > queryServer::maxRequestLength) {
+                spdlog::warn("Query server request longer than {} bytes, closing the connection", queryServer::maxRequestLength);
+                boost::system::error_code closeEc;
+                _socket.close(closeEc);
+                return;
+            }
+
+            if (_output.empty()) {
+                return doRead();
+            }
+            auto self = this->shared_from_this();
+            net::async_write(_socket, net::buffer(_output), [self](boost::system::error_code ec, std::size_t) {
+                self->onWrite(ec);
+            });
+        }
+
+        void onWrite(boost::system::error_code ec) {
+            if (ec) {
+                return;
+            }
+            _output.clear();
+            doRead();
+        }
+
+        Socket _socket;
+        exchangeInfo& _exchange;
+        std::shared_ptr<std::atomic<unsigned long long>> _requests;
+        net::steady_timer _holdTimer;
+        char _readBuffer[16384];
+        std::string _input;
+        std::string _output;
+};
+
+queryServer::queryServer(net::io_context& ioc, exchangeInfo& exchange)
+: _ioc(ioc), _exchange(exchange), _requests(std::make_shared<std::atomic<unsigned long long>>(0)) {}
+
+queryServer::~queryServer() {
+    stop();
+}
+
+bool queryServer::listenUnix(const std::string& path) {
+    boost::system::error_code ec;
+    ::unlink(path.c_str());
+    net::local::stream_protocol::endpoint endpoint(path);
+    _unixAcceptor.reset(new net::local::stream_protocol::acceptor(_ioc));
+    _unixAcceptor->open(endpoint.protocol(), ec);
+    if (!ec) {
+        _unixAcceptor->bind(endpoint, ec);
+    }
+    if (!ec) {
+        _unixAcceptor->listen(net::socket_base::max_listen_connections, ec);
+    }
+    if (ec) {
+        spdlog::error("Query server can not listen on {}: {}", path, ec.message());
+        _unixAcceptor.reset();
+        return false;
+    }
+    _unixPath = path;
+    spdlog::info("Query server listening on {}", path);
+    doAccept(*_unixAcceptor);
+    return true;
+}
+
+unsigned short queryServer::listenTcp(unsigned short port) {
+    boost::system::error_code ec;
+    tcp::endpoint endpoint(net::ip::make_address("127.0.0.1"), port);
+    _tcpAcceptor.reset(new tcp::acceptor(_ioc));
+    _tcpAcceptor->open(endpoint.protocol(), ec);
+    if (!ec) {
+        _tcpAcceptor->set_option(net::socket_base::reuse_address(true), ec);
+        _tcpAcceptor->bind(endpoint, ec);
+    }
+    if (!ec) {
+        _tcpAcceptor->listen(net::socket_base::max_listen_connections, ec);
+    }
+    if (ec) {
+        spdlog::error("Query server can not listen on 127.0.0.1:{}: {}", port, ec.message());
+        _tcpAcceptor.reset();
+        return 0;
+    }
+    unsigned short boundPort = _tcpAcceptor->local_endpoint().port();
+    spdlog::info("Query server listening on 127.0.0.1:{}", boundPort);
+    doAccept(*_tcpAcceptor);
+    return boundPort;
+}
+
+void queryServer::stop() {
+    boost::system::error_code ec;
+    if (_unixAcceptor) {
+        _unixAcceptor->close(ec);
+        ::unlink(_unixPath.c_str());
+    }
+    if (_tcpAcceptor) {
+        _tcpAcceptor->close(ec);
+    }
+}
+
+unsigned long long queryServer::requestCount() const {
+    return _requests->load();
+}
+
+template <typename Acceptor>
+void queryServer::doAccept(Acceptor& acceptor) {
+    acceptor.async_accept([this, &acceptor](boost::system::error_code ec, typename Acceptor::protocol_type::socket socket) {
+        if (ec) {
+            return;
+        }
+        // answers are small and latency matters more than packet count
+        if constexpr (std::is_same<typename Acceptor::protocol_type, tcp>::value) {
+            socket.set_option(tcp::no_delay(true), ec);
+        }
+        std::make_shared<queryConnection<typename Acceptor::protocol_type::socket>>(std::move(socket), _exchange, _requests)->start();
+        doAccept(acceptor);
+    });
+}
+
+// Split next space separated word off line
+static std::string_view nextWord(std::string_view& line) {
+    size_t start = line.find_first_not_of(' ');
+    if (start == std::string_view::npos) {
+        line = std::string_view();
+        return std::string_view();
+    }
+    size_t end = line.find(' ', start);
+    std::string_view word = line.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+    line = end == std::string_view::npos ? std::string_view() : line.substr(end);
+    return word;
+}
+
+void queryServer::handleRequest(exchangeInfo& exchange, std::string_view line, std::string& out) {
+    parsedQuery query;
+    query.id = 0;
+    std::optional<unsigned long long> queryID;
+    std::string_view first = nextWord(line);
+    if (!first.empty() && first.find_first_not_of("0123456789") == std::string_view::npos) {
+        std::from_chars(first.data(), first.data() + first.size(), query.id);
+        queryID = query.id;
+        first = nextWord(line);
+    }
+    query.type = first;
+    query.market = nextWord(line);
+    std::string_view third = nextWord(line);
+    std::string_view fourth = nextWord(line);
+
+    // FILTER takes quote asset and status, "*" matches any
+    bool listing = query.type == "LIST" || query.type == "FILTER" || query.type == "PREFIX";
+    if (query.type == "FILTER") {
+        query.quoteAsset = third == "*" ? std::string_view() : third;
+        query.status = fourth == "*" ? std::string_view() : fourth;
+    }
+    else {
+        query.symbol = third;
+        query.status = fourth;
+    }
+
+    bool valid = query.type == "STATS" || (!query.market.empty()
+              && (query.type == "LIST" || (query.type == "FILTER" && !fourth.empty()) || (query.type == "PREFIX" && !query.symbol.empty())
+                  || (!query.symbol.empty() && (query.type == "GET" || query.type == "DELETE" || (query.type == "UPDATE" && !query.status.empty())))));
+    std::string answer;
+    if (!valid) {
+        out += "{\"error\":\"bad request\"}\n";
+        return;
+    }
+
+    // same checks as the queries of the query file
+    queryAdmission admission = exchange.admitQuery(queryID, answer);
+    if (admission == queryAdmission::duplicate) {
+        out += "{\"error\":\"duplicate id\"}\n";
+        return;
+    }
+    if (admission == queryAdmission::notReady) {
+        out += answer;
+        out += '\n';
+        return;
+    }
+    if (exchange.executeQueries(&query, 1, answer) == 0) {
+        out += listing ? "{\"error\":\"unknown market\"}\n" : "{\"error\":\"symbol does not exist\"}\n";
+        return;
+    }
+    out += answer;
+    out += '\n';
+}
@@ -0,0 +1,212 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+#include "queryWatcher.h"
+#include "spdlog/spdlog.h"
+
+// interval used to re-check the query file when inotify is not available
+static const auto pollInterval = std::chrono::milliseconds(50);
+
+// json depth of the objects inside {"query":[ ... ]}
+static const int queryObjectDepth = 2;
+
+queryWatcher::queryWatcher()
+: _useInotify(false), _inotifyFd(-1), _watchFd(-1), _stopFd(-1), _stopped(false), _offset(0), _depth(0), _inode(0) {
+#ifdef __linux__
+    _inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    _stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+}
+
+queryWatcher::~queryWatcher() {
+    if (_inotifyFd >= 0) {
+        close(_inotifyFd);
+    }
+    if (_stopFd >= 0) {
+        close(_stopFd);
+    }
+}
+
+bool queryWatcher::watch(const std::string& queryFile, bool useInotify) {
+    _queryFile = queryFile;
+    resetOffset();
+
+    // split query file into directory and file name, the directory is watched so that replaced files are seen too
+    std::string directory = ".";
+    _queryFileName = queryFile;
+    size_t slash = queryFile.find_last_of('/');
+    if (slash != std::string::npos) {
+        directory = slash == 0 ? "/" : queryFile.substr(0, slash);
+        _queryFileName = queryFile.substr(slash + 1);
+    }
+
+    _useInotify = false;
+#ifdef __linux__
+    if (useInotify && _inotifyFd >= 0 && _stopFd >= 0) {
+        // a stop requested before watch stays pending in the eventfd, it is never drained
+        if (_watchFd >= 0) {
+            inotify_rm_watch(_inotifyFd, _watchFd);
+        }
+        _watchFd = inotify_add_watch(_inotifyFd, directory.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (_watchFd < 0) {
+            spdlog::warn("Unable to watch {} with inotify: {}, falling back to polling", directory, strerror(errno));
+        }
+        else {
+            _useInotify = true;
+        }
+    }
+#endif
+    SPDLOG_DEBUG("Watching query file {} using {}", _queryFile, _useInotify ? "inotify" : "polling");
+    return true;
+}
+
+bool queryWatcher::waitForChange() {
+    if (!_useInotify) {
+        std::this_thread::sleep_for(pollInterval);
+        return !_stopped;
+    }
+
+#ifdef __linux__
+    alignas(struct inotify_event) char events[4096];
+    pollfd fds[2] = {{_inotifyFd, POLLIN, 0}, {_stopFd, POLLIN, 0}};
+
+    // sleep until an event for the query file arrives or stop is requested
+    while (!_stopped) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            spdlog::error("poll on query file watch failed: {}", strerror(errno));
+            return false;
+        }
+        if (fds[1].revents & POLLIN) {
+            return false;
+        }
+
+        bool queryFileChanged = false;
+        ssize_t length;
+        while ((length = read(_inotifyFd, events, sizeof(events))) > 0) {
+            for (char* ptr = events; ptr < events + length; ) {
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+                if (event->len > 0 && _queryFileName == event->name) {
+                    queryFileChanged = true;
+                }
+                ptr += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        if (queryFileChanged) {
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+void queryWatcher::stop() {
+    _stopped = true;
+#ifdef __linux__
+    if (_stopFd >= 0) {
+        eventfd_write(_stopFd, 1);
+    }
+#endif
+}
+
+void queryWatcher::resetOffset() {
+    _offset = 0;
+    _depth = 0;
+    _inode = 0;
+}
+
+size_t queryWatcher::readNewQueries(std::vector<std::string>& queries) {
+    struct stat fileStat;
+    if (stat(_queryFile.c_str(), &fileStat) != 0) {
+        spdlog::error("Error: unable to open file {}", _queryFile);
+        return 0;
+    }
+
+    // file was replaced or truncated, start again from the beginning
+    if (fileStat.st_ino != _inode || fileStat.st_size < _offset) {
+        SPDLOG_DEBUG("Query file {} was replaced, reading it again", _queryFile);
+        resetOffset();
+        _inode = fileStat.st_ino;
+    }
+    if (fileStat.st_size == _offset) {
+        return 0;
+    }
+
+    FILE* fileQuery = fopen(_queryFile.c_str(), "r");
+    if (!fileQuery) {
+        spdlog::error("Error: unable to open file {}", _queryFile);
+        return 0;
+    }
+
+    // read from the last consumed byte so we can check the file was only appended to
+    long readFrom = _offset > 0 ? _offset - 1 : 0;
+    std::string appended(fileStat.st_size - readFrom, '\0');
+    fseek(fileQuery, readFrom, SEEK_SET);
+    appended.resize(fread(&appended[0], 1, appended.size(), fileQuery));
+    fclose(fileQuery);
+
+    size_t start = 0;
+    if (_offset > 0) {
+        if (appended.empty() || appended[0] != '}') {
+            // bytes before the offset were rewritten in place, fall back to a full read
+            resetOffset();
+            _inode = fileStat.st_ino;
+            return readNewQueries(queries);
+        }
+        start = 1;
+    }
+
+    // scan appended bytes and cut out every complete object inside the query array
+    size_t found = 0;
+    int depth = _depth;
+    bool inString = false, escaped = false;
+    size_t objectStart = 0;
+    for (size_t i = start; i < appended.size(); ++i) {
+        char c = appended[i];
+        if (inString) {
+            if (escaped) {
+                escaped = false;
+            }
+            else if (c == '\\') {
+                escaped = true;
+            }
+            else if (c == '"') {
+                inString = false;
+            }
+            continue;
+        }
+        if (c == '"') {
+            inString = true;
+        }
+        else if (c == '{' || c == '[') {
+            if (c == '{' && depth == queryObjectDepth) {
+                objectStart = i;
+            }
+            ++depth;
+        }
+        else if (c == '}' || c == ']') {
+            --depth;
+            if (c == '}' && depth == queryObjectDepth) {
+                queries.emplace_back(appended, objectStart, i + 1 - objectStart);
+                ++found;
+                _offset = readFrom + i + 1;
+                _depth = depth;
+            }
+        }
+    }
+
+    SPDLOG_TRACE("Read {} new queries from {}", found, _queryFile);
+    return found;
+}
@@ -0,0 +1,73 @@
+#include "rateLimiter.h"
+
+#include <algorithm>
+
+#include "spdlog/spdlog.h"
+
+// the exchange counts weight per minute
+static constexpr std::chrono::seconds weightWindow(60);
+
+// longest backoff without a Retry-After header
+static constexpr std::chrono::seconds maxBackoff(300);
+
+rateLimiter::rateLimiter(unsigned weightLimit)
+: _weightLimit(weightLimit), _usedWeight(0), _backoffs(0), _rejections(0), _jitter(std::random_device{}()) {}
+
+void rateLimiter::setWeightLimit(unsigned weightLimit) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _weightLimit = weightLimit == 0 ? 1 : weightLimit;
+}
+
+void rateLimiter::updateUsedWeight(unsigned weight, clock::time_point now) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _usedWeight = weight;
+    _reportedAt = now;
+}
+
+void rateLimiter::reject(unsigned status, std::chrono::seconds retryAfter, clock::time_point now) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_rejections;
+    clock::duration delay = retryAfter;
+    if (retryAfter.count() <= 0) {
+        // answers to requests sent before the block started belong to the same window, back off one step per window
+        bool newWindow = now >= _blockedUntil;
+        unsigned step = newWindow || _backoffs == 0 ? _backoffs : _backoffs - 1;
+        delay = std::min<clock::duration>(std::chrono::seconds(1u << std::min(step, 8u)), maxBackoff);
+        if (newWindow) {
+            ++_backoffs;
+        }
+    }
+    // up to a quarter more so sessions do not all come back at the same moment
+    delay += std::chrono::duration_cast<clock::duration>(delay * (double(_jitter() % 1000) / 4000));
+    _blockedUntil = std::max(_blockedUntil, now + delay);
+    spdlog::warn("Exchange answered {}, requests blocked for {} ms", status,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(_blockedUntil - now).count());
+}
+
+void rateLimiter::accept() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _backoffs = 0;
+}
+
+double rateLimiter::usedFraction(clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_reportedAt == clock::time_point() || now - _reportedAt >= weightWindow) {
+        return 0;
+    }
+    return double(_usedWeight) / _weightLimit;
+}
+
+rateLimiter::clock::duration rateLimiter::blockedFor(clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _blockedUntil > now ? _blockedUntil - now : clock::duration::zero();
+}
+
+unsigned rateLimiter::usedWeight() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _usedWeight;
+}
+
+unsigned long long rateLimiter::rejections() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _rejections;
+}
@@ -0,0 +1,107 @@
+#include "refreshScheduler.h"
+
+#include <algorithm>
+
+#include "spdlog/spdlog.h"
+
+// part of the weight budget up to which intervals are not stretched
+static constexpr double budgetTarget = 0.5;
+
+refreshScheduler::refreshScheduler(const rateLimiter& limiter)
+: _limiter(limiter), _base(std::chrono::seconds(60)), _min(std::chrono::seconds(5)), _max(std::chrono::seconds(300)), _scheduled(0) {}
+
+void refreshScheduler::configure(std::chrono::seconds base, std::chrono::seconds min, std::chrono::seconds max) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _min = std::max(min, std::chrono::seconds(1));
+    _max = std::max<clock::duration>(max, _min);
+    _base = std::clamp<clock::duration>(base, _min, _max);
+    for (auto& market : _markets) {
+        if (market.interval != clock::duration::zero()) {
+            market.interval = std::clamp(market.interval, _min, _max);
+        }
+    }
+}
+
+unsigned refreshScheduler::due(unsigned candidates, clock::time_point now) {
+    if (_limiter.blockedFor(now) > clock::duration::zero()) {
+        return 0;
+    }
+    unsigned dueMarkets = 0;
+    for (size_t index = 0; index < marketRegistry::maxMarkets; ++index) {
+        unsigned bit = marketRegistry::bit(index);
+        if (!(candidates & bit)) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if ((_scheduled & bit) && _markets[index].next > now) {
+                continue;
+            }
+        }
+        dispatched(index, now);
+        dueMarkets |= bit;
+    }
+    return dueMarkets;
+}
+
+void refreshScheduler::dispatched(size_t index, clock::time_point now) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    marketSchedule& market = _markets[index];
+    if (market.interval == clock::duration::zero()) {
+        market.interval = _base;
+    }
+    // poll again after the interval if the request never finishes
+    market.next = now + market.interval;
+    _scheduled |= marketRegistry::bit(index);
+}
+
+void refreshScheduler::completed(size_t index, bool changed, clock::time_point now) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    marketSchedule& market = _markets[index];
+    if (market.interval == clock::duration::zero()) {
+        market.interval = _base;
+    }
+    // listings and delistings come in bursts, look again soon after a change and slow down while nothing happens
+    market.interval = changed ? std::max(market.interval / 2, _min) : std::min(market.interval + market.interval / 4, _max);
+    market.next = now + budgeted(market.interval, now);
+    _scheduled |= marketRegistry::bit(index);
+    SPDLOG_DEBUG("Market {} polled again in {} ms", index, std::chrono::duration_cast<std::chrono::milliseconds>(market.next - now).count());
+}
+
+void refreshScheduler::failed(size_t index, clock::time_point now) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    marketSchedule& market = _markets[index];
+    if (market.interval == clock::duration::zero()) {
+        market.interval = _base;
+    }
+    market.next = now + budgeted(market.interval, now);
+    _scheduled |= marketRegistry::bit(index);
+}
+
+refreshScheduler::clock::duration refreshScheduler::untilNext(clock::time_point now) const {
+    clock::duration blocked = _limiter.blockedFor(now);
+    std::lock_guard<std::mutex> lock(_mutex);
+    // wake up at least every min interval, a refresh finishing in between may have moved its market earlier
+    clock::duration wait = _min;
+    for (size_t index = 0; index < marketRegistry::maxMarkets; ++index) {
+        if (_scheduled & marketRegistry::bit(index)) {
+            wait = std::min(wait, std::max(_markets[index].next - now, clock::duration::zero()));
+        }
+    }
+    return std::max(wait, blocked);
+}
+
+refreshScheduler::clock::duration refreshScheduler::interval(size_t index) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _markets[index].interval == clock::duration::zero() ? _base : _markets[index].interval;
+}
+
+refreshScheduler::clock::duration refreshScheduler::budgeted(clock::duration interval, clock::time_point now) const {
+    double used = _limiter.usedFraction(now);
+    if (used <= budgetTarget) {
+        return interval;
+    }
+    // quadratic so polling slows down hard as the budget runs out
+    double stretch = (used / budgetTarget) * (used / budgetTarget);
+    return std::chrono::duration_cast<clock::duration>(interval * stretch);
+}
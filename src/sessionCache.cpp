@@ -0,0 +1,84 @@
+#include "sessionCache.h"
+
+// key used for both caches
+static std::string hostKey(const std::string& host, const std::string& port) {
+    return host + ":" + port;
+}
+
+sessionCache::sessionCache(std::chrono::seconds dnsTtl)
+: _dnsTtl(dnsTtl), _dnsHits(0), _dnsMisses(0), _resumedHandshakes(0), _fullHandshakes(0) {}
+
+sessionCache::~sessionCache() {
+    for (auto& tlsSession : _tlsSessions) {
+        SSL_SESSION_free(tlsSession.second);
+    }
+}
+
+void sessionCache::setDnsTtl(std::chrono::seconds dnsTtl) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _dnsTtl = dnsTtl;
+}
+
+bool sessionCache::findEndpoints(const std::string& host, const std::string& port, boost::asio::ip::tcp::resolver::results_type& endpoints) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _endpoints.find(hostKey(host, port));
+    if (it == _endpoints.end() || it->second.expiry < std::chrono::steady_clock::now()) {
+        ++_dnsMisses;
+        return false;
+    }
+    ++_dnsHits;
+    endpoints = it->second.endpoints;
+    return true;
+}
+
+void sessionCache::storeEndpoints(const std::string& host, const std::string& port, const boost::asio::ip::tcp::resolver::results_type& endpoints) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_dnsTtl.count() <= 0) {
+        return;
+    }
+    _endpoints[hostKey(host, port)] = {endpoints, std::chrono::steady_clock::now() + _dnsTtl};
+}
+
+void sessionCache::forgetEndpoints(const std::string& host, const std::string& port) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _endpoints.erase(hostKey(host, port));
+}
+
+void sessionCache::applyTlsSession(const std::string& host, const std::string& port, SSL* ssl) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _tlsSessions.find(hostKey(host, port));
+    if (it != _tlsSessions.end()) {
+        SSL_set_session(ssl, it->second);
+    }
+}
+
+void sessionCache::storeTlsSession(const std::string& host, const std::string& port, SSL* ssl) {
+    SSL_SESSION* tlsSession = SSL_get1_session(ssl);
+    if (!tlsSession) {
+        return;
+    }
+    if (!SSL_SESSION_is_resumable(tlsSession)) {
+        SSL_SESSION_free(tlsSession);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    SSL_SESSION*& cached = _tlsSessions[hostKey(host, port)];
+    if (cached) {
+        SSL_SESSION_free(cached);
+    }
+    cached = tlsSession;
+}
+
+void sessionCache::countHandshake(bool resumed) {
+    if (resumed) {
+        ++_resumedHandshakes;
+    }
+    else {
+        ++_fullHandshakes;
+    }
+}
+
+connectionStats sessionCache::getStats() const {
+    return {_dnsHits, _dnsMisses, _resumedHandshakes, _fullHandshakes};
+}
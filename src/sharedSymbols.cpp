@@ -0,0 +1,206 @@
+#include "sharedSymbols.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "spdlog/spdlog.h"
+
+template <typename T>
+static void put(std::string& buffer, size_t offset, const T& value) {
+    memcpy(&buffer[offset], &value, sizeof(T));
+}
+
+sharedSymbols::sharedSymbols() : _header(nullptr), _mappedSize(0) {}
+
+sharedSymbols::~sharedSymbols() {
+    close();
+}
+
+// Create or reopen segment name with buffers of bufferSize bytes
+bool sharedSymbols::open(const std::string& name, size_t bufferSize) {
+    close();
+    if (bufferSize > UINT32_MAX) {
+        spdlog::error("Shared memory buffers of {} bytes are too large, at most {} are supported", bufferSize, UINT32_MAX);
+        return false;
+    }
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        spdlog::error("Unable to open shared memory {}: {}", name, strerror(errno));
+        return false;
+    }
+
+    size_t mappedSize = sizeof(sharedHeader) + 2 * bufferSize;
+    struct stat info;
+    bool sameSize = fstat(fd, &info) == 0 && size_t(info.st_size) == mappedSize;
+    if (!sameSize && ftruncate(fd, mappedSize) != 0) {
+        spdlog::error("Unable to size shared memory {}: {}", name, strerror(errno));
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        spdlog::error("Unable to map shared memory {}: {}", name, strerror(errno));
+        return false;
+    }
+    _header = static_cast<sharedHeader*>(mapped);
+    _mappedSize = mappedSize;
+
+    // keep the counters of a segment left by a previous run, readers compare generations across restarts
+    bool reusable = sameSize && memcmp(_header->magic, sharedSymbolsMagic, sizeof(sharedSymbolsMagic)) == 0
+                 && _header->version == sharedSymbolsVersion && _header->bufferSize == bufferSize;
+    if (!reusable) {
+        memset(static_cast<void*>(_header), 0, _mappedSize);
+        _header->version = sharedSymbolsVersion;
+        _header->bufferSize = bufferSize;
+        _header->generation.store(0);
+        _header->sequence[0].store(0);
+        _header->sequence[1].store(0);
+        // readers check the magic first, write it last
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(_header->magic, sharedSymbolsMagic, sizeof(sharedSymbolsMagic));
+    }
+    else {
+        // a run that died while writing left its buffer odd, every later publication would end on odd and readers retry forever
+        for (auto& sequence : _header->sequence) {
+            uint64_t value = sequence.load();
+            if (value & 1) {
+                sequence.store(value + 1);
+            }
+        }
+    }
+    spdlog::info("Publishing symbols to shared memory {} ({} bytes per buffer)", name, bufferSize);
+    return true;
+}
+
+// Write tables into the spare buffer and make it current
+bool sharedSymbols::publish(const std::vector<std::pair<std::string, const symbolTable*>>& markets) {
+    if (!_header) {
+        return false;
+    }
+
+    // directory of markets first, then slots, records and strings of each market
+    for (const auto& market : markets) {
+        if (market.first.size() >= sizeof(sharedMarket::name)) {
+            spdlog::error("Market name {} is longer than {} characters, not published to shared memory", market.first, sizeof(sharedMarket::name) - 1);
+            return false;
+        }
+    }
+    _staging.assign(sizeof(uint32_t) + markets.size() * sizeof(sharedMarket), '\0');
+    put(_staging, 0, uint32_t(markets.size()));
+    for (size_t index = 0; index < markets.size(); ++index) {
+        const symbolTable& symbols = *markets[index].second;
+        sharedMarket market;
+        memset(&market, 0, sizeof(market));
+        memcpy(market.name, markets[index].first.data(), markets[index].first.size());
+        market.slotCount = 16;
+        while (market.slotCount < symbols.size() * 2) {
+            market.slotCount *= 2;
+        }
+        market.recordCount = symbols.size();
+        market.slotsOffset = _staging.size();
+        market.recordsOffset = market.slotsOffset + market.slotCount * sizeof(uint32_t);
+        _staging.resize(market.recordsOffset + market.recordCount * sizeof(sharedRecord), '\0');
+
+        // statuses and quote assets repeat across symbols, store each once per market
+        std::vector<uint32_t> stringOffsets;
+        auto addString = [&](uint16_t id) {
+            if (id < stringOffsets.size() && stringOffsets[id] != 0) {
+                return stringOffsets[id];
+            }
+            if (id >= stringOffsets.size()) {
+                stringOffsets.resize(id + 1, 0);
+            }
+            stringOffsets[id] = _staging.size();
+            _staging += symbolStrings().lookup(id);
+            return stringOffsets[id];
+        };
+
+        uint32_t recordIndex = 0;
+        uint32_t mask = market.slotCount - 1;
+        bool tooLong = false;
+        symbols.forEach([&](const symbolRecord& record) {
+            std::string_view name = symbols.name(record);
+            const std::string& quoteAsset = symbolStrings().lookup(record.quoteAsset);
+            const std::string& status = symbolStrings().lookup(record.status);
+            // lengths are one byte in the layout
+            if (name.size() > UINT8_MAX || quoteAsset.size() > UINT8_MAX || status.size() > UINT8_MAX) {
+                if (!tooLong) {
+                    spdlog::error("Symbol {} of {} has a field longer than {} characters, not published to shared memory",
+                                  name, markets[index].first, UINT8_MAX);
+                }
+                tooLong = true;
+                return;
+            }
+
+            sharedRecord shared;
+            memset(&shared, 0, sizeof(shared));
+            shared.tickSize = record.tickSize.packed();
+            shared.stepSize = record.stepSize.packed();
+            shared.quoteAssetOffset = addString(record.quoteAsset);
+            shared.statusOffset = addString(record.status);
+            shared.quoteAssetLength = quoteAsset.size();
+            shared.statusLength = status.size();
+            shared.nameOffset = _staging.size();
+            shared.nameLength = name.size();
+            _staging.append(name.data(), name.size());
+            put(_staging, market.recordsOffset + recordIndex * sizeof(sharedRecord), shared);
+
+            uint32_t slot = sharedSymbolHash(name) & mask;
+            uint32_t entry;
+            while (memcpy(&entry, &_staging[market.slotsOffset + slot * sizeof(uint32_t)], sizeof(entry)), entry != 0) {
+                slot = (slot + 1) & mask;
+            }
+            put(_staging, market.slotsOffset + slot * sizeof(uint32_t), recordIndex + 1);
+            ++recordIndex;
+        });
+        if (tooLong) {
+            return false;
+        }
+        put(_staging, sizeof(uint32_t) + index * sizeof(sharedMarket), market);
+    }
+
+    if (_staging.size() > _header->bufferSize) {
+        spdlog::error("Symbol tables need {} bytes, shared memory buffers hold {}", _staging.size(), _header->bufferSize);
+        return false;
+    }
+
+    // seqlock write of the spare buffer, readers still on it see the sequence change and retry on the new current buffer
+    uint64_t generation = _header->generation.load(std::memory_order_relaxed);
+    unsigned spare = (generation + 1) & 1;
+    char* buffer = reinterpret_cast<char*>(_header + 1) + spare * _header->bufferSize;
+    uint64_t sequence = _header->sequence[spare].load(std::memory_order_relaxed);
+    _header->sequence[spare].store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(buffer, _staging.data(), _staging.size());
+    _header->sequence[spare].store(sequence + 2, std::memory_order_release);
+    _header->generation.store(generation + 1, std::memory_order_release);
+    return true;
+}
+
+// check if a segment is open
+bool sharedSymbols::isOpen() const {
+    return _header != nullptr;
+}
+
+// number of publications in the segment
+uint64_t sharedSymbols::generation() const {
+    return _header ? _header->generation.load() : 0;
+}
+
+// Unmap segment, it stays in place for readers
+void sharedSymbols::close() {
+    if (_header) {
+        munmap(_header, _mappedSize);
+        _header = nullptr;
+        _mappedSize = 0;
+    }
+}
+
+// Remove segment name from the system
+bool sharedSymbols::remove(const std::string& name) {
+    return shm_unlink(name.c_str()) == 0;
+}
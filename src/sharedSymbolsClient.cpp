@@ -0,0 +1,171 @@
+#include "sharedSymbolsClient.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+sharedSymbolsClient::sharedSymbolsClient() : _header(nullptr), _mappedSize(0), _retries(0) {}
+
+sharedSymbolsClient::~sharedSymbolsClient() {
+    close();
+}
+
+// Map segment name read-only
+bool sharedSymbolsClient::open(const std::string& name) {
+    close();
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(sharedHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    const sharedHeader* header = static_cast<const sharedHeader*>(mapped);
+    bool valid = memcmp(header->magic, sharedSymbolsMagic, sizeof(sharedSymbolsMagic)) == 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    valid = valid && header->version == sharedSymbolsVersion
+         && sizeof(sharedHeader) + 2 * size_t(header->bufferSize) <= size_t(info.st_size);
+    if (!valid) {
+        munmap(mapped, info.st_size);
+        return false;
+    }
+    _header = header;
+    _mappedSize = info.st_size;
+    return true;
+}
+
+// Get tickSize and stepSize of symbol in market
+bool sharedSymbolsClient::findFilters(std::string_view market, std::string_view symbol, fixedDecimal& tickSize, fixedDecimal& stepSize) const {
+    symbolCopy copy;
+    if (!lookup(market, symbol, copy, false)) {
+        return false;
+    }
+    tickSize = fixedDecimal::fromPacked(copy.tickSize);
+    stepSize = fixedDecimal::fromPacked(copy.stepSize);
+    return true;
+}
+
+// Get all fields of symbol in market
+bool sharedSymbolsClient::find(std::string_view market, std::string_view symbol, symbolInfo& info) const {
+    symbolCopy copy;
+    if (!lookup(market, symbol, copy, true)) {
+        return false;
+    }
+    info.symbol.assign(copy.text, copy.nameLength);
+    info.quoteAsset.assign(copy.text + copy.nameLength, copy.quoteAssetLength);
+    info.status.assign(copy.text + copy.nameLength + copy.quoteAssetLength, copy.statusLength);
+    info.tickSize = fixedDecimal::fromPacked(copy.tickSize).toString();
+    info.stepSize = fixedDecimal::fromPacked(copy.stepSize).toString();
+    return true;
+}
+
+// Run lookup against the current buffer until it is not overlapped by a publication
+bool sharedSymbolsClient::lookup(std::string_view market, std::string_view symbol, symbolCopy& copy, bool withText) const {
+    if (!_header) {
+        return false;
+    }
+    const char* buffers = reinterpret_cast<const char*>(_header + 1);
+    for (;;) {
+        uint64_t generation = _header->generation.load(std::memory_order_acquire);
+        unsigned current = generation & 1;
+        uint64_t sequence = _header->sequence[current].load(std::memory_order_acquire);
+        if (sequence & 1) {
+            // the publisher lapped this reader and is rewriting the buffer, the other one is current by now
+            ++_retries;
+            continue;
+        }
+        bool found = lookupInBuffer(buffers + current * size_t(_header->bufferSize), market, symbol, copy, withText);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_header->sequence[current].load(std::memory_order_relaxed) == sequence) {
+            return found;
+        }
+        ++_retries;
+    }
+}
+
+// Look up symbol in one buffer, every offset is checked because the buffer may change underneath
+bool sharedSymbolsClient::lookupInBuffer(const char* buffer, std::string_view market, std::string_view symbol, symbolCopy& copy, bool withText) const {
+    size_t bufferSize = _header->bufferSize;
+    auto fits = [bufferSize](size_t offset, size_t length) { return offset <= bufferSize && length <= bufferSize - offset; };
+
+    uint32_t marketCount;
+    memcpy(&marketCount, buffer, sizeof(marketCount));
+    if (!fits(sizeof(uint32_t), size_t(marketCount) * sizeof(sharedMarket))) {
+        return false;
+    }
+    sharedMarket entry;
+    uint32_t marketIndex = 0;
+    for (; marketIndex < marketCount; ++marketIndex) {
+        memcpy(&entry, buffer + sizeof(uint32_t) + marketIndex * sizeof(sharedMarket), sizeof(entry));
+        if (market.size() < sizeof(entry.name) && entry.name[market.size()] == '\0' && memcmp(entry.name, market.data(), market.size()) == 0) {
+            break;
+        }
+    }
+    bool validMarket = marketIndex < marketCount && entry.slotCount != 0 && (entry.slotCount & (entry.slotCount - 1)) == 0
+                    && fits(entry.slotsOffset, size_t(entry.slotCount) * sizeof(uint32_t))
+                    && fits(entry.recordsOffset, size_t(entry.recordCount) * sizeof(sharedRecord));
+    if (!validMarket) {
+        return false;
+    }
+
+    // linear probing, at most slotCount steps even if the slots are torn
+    uint32_t mask = entry.slotCount - 1;
+    uint32_t slot = sharedSymbolHash(symbol) & mask;
+    for (uint32_t probe = 0; probe < entry.slotCount; ++probe, slot = (slot + 1) & mask) {
+        uint32_t recordIndex;
+        memcpy(&recordIndex, buffer + entry.slotsOffset + slot * sizeof(uint32_t), sizeof(recordIndex));
+        if (recordIndex == 0 || recordIndex > entry.recordCount) {
+            return false;
+        }
+        sharedRecord record;
+        memcpy(&record, buffer + entry.recordsOffset + (recordIndex - 1) * sizeof(sharedRecord), sizeof(record));
+        if (record.nameLength != symbol.size() || !fits(record.nameOffset, record.nameLength)
+            || memcmp(buffer + record.nameOffset, symbol.data(), symbol.size()) != 0) {
+            continue;
+        }
+
+        copy.tickSize = record.tickSize;
+        copy.stepSize = record.stepSize;
+        if (withText) {
+            if (!fits(record.quoteAssetOffset, record.quoteAssetLength) || !fits(record.statusOffset, record.statusLength)) {
+                return false;
+            }
+            copy.nameLength = record.nameLength;
+            copy.quoteAssetLength = record.quoteAssetLength;
+            copy.statusLength = record.statusLength;
+            memcpy(copy.text, buffer + record.nameOffset, record.nameLength);
+            memcpy(copy.text + record.nameLength, buffer + record.quoteAssetOffset, record.quoteAssetLength);
+            memcpy(copy.text + record.nameLength + record.quoteAssetLength, buffer + record.statusOffset, record.statusLength);
+        }
+        return true;
+    }
+    return false;
+}
+
+// number of publications seen in the segment
+uint64_t sharedSymbolsClient::generation() const {
+    return _header ? _header->generation.load() : 0;
+}
+
+// lookups repeated because a publication overlapped them
+unsigned long long sharedSymbolsClient::retryCount() const {
+    return _retries;
+}
+
+void sharedSymbolsClient::close() {
+    if (_header) {
+        munmap(const_cast<sharedHeader*>(_header), _mappedSize);
+        _header = nullptr;
+        _mappedSize = 0;
+    }
+}
@@ -0,0 +1,200 @@
+#include "snapshotFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "spdlog/spdlog.h"
+
+static const char snapshotMagic[8] = {'B', 'X', 'S', 'N', 'A', 'P', '\0', '\1'};
+
+// fixed size start of the file
+struct snapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t marketCount;
+    int64_t writtenAtMs;    // milliseconds since epoch
+    uint64_t checksum;      // fnv-1a of everything after the header
+};
+
+// fixed size start of every symbol, followed by name, quote asset and status
+struct snapshotSymbol {
+    uint64_t tickSize;
+    uint64_t stepSize;
+    uint8_t nameLength;
+    uint8_t quoteAssetLength;
+    uint8_t statusLength;
+};
+
+static uint64_t fnv1a(const char* data, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t index = 0; index < length; ++index) {
+        hash ^= uint8_t(data[index]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+template <typename T>
+static void append(std::string& buffer, const T& value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// bounds checked reads from the mapped file
+class snapshotReader{
+    public:
+        snapshotReader(const char* data, size_t length) : _data(data), _length(length), _offset(0) {}
+
+        template <typename T>
+        bool read(T& value) {
+            if (_length - _offset < sizeof(T)) {
+                return false;
+            }
+            memcpy(&value, _data + _offset, sizeof(T));
+            _offset += sizeof(T);
+            return true;
+        }
+
+        bool read(size_t length, std::string_view& text) {
+            if (_length - _offset < length) {
+                return false;
+            }
+            text = std::string_view(_data + _offset, length);
+            _offset += length;
+            return true;
+        }
+
+        bool atEnd() const { return _offset == _length; }
+
+    private:
+        const char* _data;
+        size_t _length;
+        size_t _offset;
+};
+
+bool snapshotFile::save(const std::string& path, const std::vector<std::pair<std::string, const symbolTable*>>& markets, int64_t writtenAtMs) {
+    std::string body;
+    for (const auto& market : markets) {
+        uint8_t marketLength = market.first.size();
+        append(body, marketLength);
+        body.append(market.first, 0, marketLength);
+        append(body, uint32_t(market.second->size()));
+
+        const symbolTable& symbols = *market.second;
+        symbols.forEach([&](const symbolRecord& record) {
+            std::string_view name = symbols.name(record);
+            const std::string& quoteAsset = symbolStrings().lookup(record.quoteAsset);
+            const std::string& status = symbolStrings().lookup(record.status);
+
+            snapshotSymbol symbol;
+            memset(&symbol, 0, sizeof(symbol));
+            symbol.tickSize = record.tickSize.packed();
+            symbol.stepSize = record.stepSize.packed();
+            symbol.nameLength = name.size() < 256 ? name.size() : 255;
+            symbol.quoteAssetLength = quoteAsset.size() < 256 ? quoteAsset.size() : 255;
+            symbol.statusLength = status.size() < 256 ? status.size() : 255;
+            append(body, symbol);
+            body.append(name.data(), symbol.nameLength);
+            body.append(quoteAsset, 0, symbol.quoteAssetLength);
+            body.append(status, 0, symbol.statusLength);
+        });
+    }
+
+    snapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+    header.version = formatVersion;
+    header.marketCount = markets.size();
+    header.writtenAtMs = writtenAtMs;
+    header.checksum = fnv1a(body.data(), body.size());
+
+    std::string temporaryPath = path + ".tmp";
+    FILE* file = fopen(temporaryPath.c_str(), "wb");
+    if (!file) {
+        spdlog::error("Unable to write snapshot file {}", temporaryPath);
+        return false;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+                && fwrite(body.data(), 1, body.size(), file) == body.size()
+                && fflush(file) == 0
+                && fsync(fileno(file)) == 0;
+    fclose(file);
+    if (!written || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        spdlog::error("Unable to write snapshot file {}", path);
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+    SPDLOG_DEBUG("Saved snapshot of {} markets to {} ({} bytes)", markets.size(), path, sizeof(header) + body.size());
+    return true;
+}
+
+bool snapshotFile::load(const std::string& path, std::vector<snapshotMarket>& markets, int64_t& writtenAtMs) {
+    markets.clear();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        SPDLOG_DEBUG("No snapshot file {}", path);
+        return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || size_t(fileStat.st_size) < sizeof(snapshotHeader)) {
+        spdlog::warn("Snapshot file {} is too short", path);
+        close(fd);
+        return false;
+    }
+    size_t length = fileStat.st_size;
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        spdlog::error("Unable to map snapshot file {}", path);
+        return false;
+    }
+    const char* data = static_cast<const char*>(mapped);
+
+    snapshotHeader header;
+    memcpy(&header, data, sizeof(header));
+    const char* body = data + sizeof(header);
+    size_t bodyLength = length - sizeof(header);
+    bool valid = memcmp(header.magic, snapshotMagic, sizeof(header.magic)) == 0
+              && header.version == formatVersion
+              && header.checksum == fnv1a(body, bodyLength);
+
+    snapshotReader reader(body, bodyLength);
+    for (uint32_t marketIndex = 0; valid && marketIndex < header.marketCount; ++marketIndex) {
+        snapshotMarket market;
+        uint8_t marketLength;
+        uint32_t symbolCount;
+        std::string_view marketName;
+        valid = reader.read(marketLength) && reader.read(marketLength, marketName) && reader.read(symbolCount);
+        if (!valid) {
+            break;
+        }
+        market.market = std::string(marketName);
+        market.symbols.reset(new symbolTable());
+        market.symbols->reserve(symbolCount);
+
+        for (uint32_t symbolIndex = 0; valid && symbolIndex < symbolCount; ++symbolIndex) {
+            snapshotSymbol symbol;
+            std::string_view name, quoteAsset, status;
+            valid = reader.read(symbol) && reader.read(symbol.nameLength, name)
+                 && reader.read(symbol.quoteAssetLength, quoteAsset) && reader.read(symbol.statusLength, status);
+            if (valid) {
+                market.symbols->insertRecord(name, quoteAsset, status,
+                                             fixedDecimal::fromPacked(symbol.tickSize), fixedDecimal::fromPacked(symbol.stepSize));
+            }
+        }
+        markets.push_back(std::move(market));
+    }
+    valid = valid && reader.atEnd();
+    munmap(mapped, length);
+
+    if (!valid) {
+        spdlog::warn("Snapshot file {} is corrupt or of another version, ignored", path);
+        markets.clear();
+        return false;
+    }
+    writtenAtMs = header.writtenAtMs;
+    return true;
+}
@@ -0,0 +1,64 @@
+#include "snapshotWriter.h"
+
+#include "spdlog/spdlog.h"
+
+snapshotWriter::snapshotWriter(std::function<bool()> save)
+: _save(std::move(save)), _requested(false), _saving(false), _stop(false), _saves(0) {}
+
+snapshotWriter::~snapshotWriter() {
+    stop();
+}
+
+void snapshotWriter::request() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_stop) {
+        return;
+    }
+    _requested = true;
+    if (!_writerThread.joinable()) {
+        _writerThread = std::thread(&snapshotWriter::run, this);
+    }
+    _wakeWriter.notify_one();
+}
+
+void snapshotWriter::flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _saved.wait(lock, [this] { return !_requested && !_saving; });
+}
+
+void snapshotWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+        _wakeWriter.notify_one();
+    }
+    if (_writerThread.joinable()) {
+        _writerThread.join();
+    }
+}
+
+unsigned long long snapshotWriter::saves() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _saves;
+}
+
+void snapshotWriter::run() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _wakeWriter.wait(lock, [this] { return _requested || _stop; });
+        if (!_requested) {
+            return;
+        }
+        // every request up to here is covered by this save, the tables are read when it starts
+        _requested = false;
+        _saving = true;
+        lock.unlock();
+        if (!_save()) {
+            SPDLOG_DEBUG("Snapshot file not saved");
+        }
+        lock.lock();
+        _saving = false;
+        ++_saves;
+        _saved.notify_all();
+    }
+}
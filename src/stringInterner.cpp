@@ -0,0 +1,69 @@
+#include "stringInterner.h"
+
+#include "spdlog/spdlog.h"
+
+stringInterner::stringInterner(std::initializer_list<const char*> strings)
+: _size(0) {
+    for (auto& chunk : _chunks) {
+        chunk.store(nullptr);
+    }
+    uint16_t id;
+    intern("", id);
+    for (const char* text : strings) {
+        intern(text, id);
+    }
+}
+
+stringInterner::~stringInterner() {
+    for (auto& chunk : _chunks) {
+        delete[] chunk.load();
+    }
+}
+
+bool stringInterner::intern(std::string_view text, uint16_t& interned) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _ids.find(text);
+    if (it != _ids.end()) {
+        interned = it->second;
+        return true;
+    }
+
+    size_t id = _size.load(std::memory_order_relaxed);
+    if (id >= chunkSize * chunkCount) {
+        spdlog::error("String table full, can not add {}", text);
+        return false;
+    }
+
+    std::string* chunk = _chunks[id / chunkSize].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new std::string[chunkSize];
+        _chunks[id / chunkSize].store(chunk, std::memory_order_release);
+    }
+    chunk[id % chunkSize] = std::string(text);
+    _ids.emplace(std::string_view(chunk[id % chunkSize]), uint16_t(id));
+    _size.store(id + 1, std::memory_order_release);
+    interned = uint16_t(id);
+    return true;
+}
+
+bool stringInterner::find(std::string_view text, uint16_t& id) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _ids.find(text);
+    if (it == _ids.end()) {
+        return false;
+    }
+    id = it->second;
+    return true;
+}
+
+const std::string& stringInterner::lookup(uint16_t id) const {
+    static const std::string empty;
+    if (id >= _size.load(std::memory_order_acquire)) {
+        return empty;
+    }
+    return _chunks[id / chunkSize].load(std::memory_order_acquire)[id % chunkSize];
+}
+
+size_t stringInterner::size() const {
+    return _size.load(std::memory_order_acquire);
+}
@@ -0,0 +1,74 @@
+#include "symbolDiff.h"
+
+static void hashField(uint64_t& hash, const std::string& field) {
+    for (char c : field) {
+        hash ^= uint8_t(c);
+        hash *= 1099511628211ULL;
+    }
+    // separator so "AB","C" and "A","BC" differ
+    hash ^= 0xFF;
+    hash *= 1099511628211ULL;
+}
+
+uint64_t symbolsDigest(const std::vector<symbolInfo>& symbols) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const auto& info : symbols) {
+        hashField(hash, info.symbol);
+        hashField(hash, info.quoteAsset);
+        hashField(hash, info.status);
+        hashField(hash, info.tickSize);
+        hashField(hash, info.stepSize);
+    }
+    return hash;
+}
+
+void diffSymbols(const symbolTable& current, const std::vector<symbolInfo>& fresh, const std::string& market, std::vector<symbolChange>& changes) {
+    symbolTable freshNames;
+    freshNames.reserve(fresh.size());
+
+    for (const auto& info : fresh) {
+        freshNames.insertRecord(info.symbol, std::string_view(), std::string_view(), fixedDecimal(), fixedDecimal());
+        const symbolRecord* record = current.findRecord(info.symbol);
+        if (!record) {
+            changes.push_back(symbolChange{0, changeType::added, statusField | quoteAssetField | tickSizeField | stepSizeField, market, symbolInfo(), info});
+            continue;
+        }
+
+        // compare in string form so values that do not parse as decimals still compare correctly
+        symbolInfo before = current.toSymbolInfo(*record);
+        unsigned fields = 0;
+        if (before.status != info.status) {
+            fields |= statusField;
+        }
+        if (before.quoteAsset != info.quoteAsset) {
+            fields |= quoteAssetField;
+        }
+        if (before.tickSize != info.tickSize) {
+            fields |= tickSizeField;
+        }
+        if (before.stepSize != info.stepSize) {
+            fields |= stepSizeField;
+        }
+        if (fields) {
+            changes.push_back(symbolChange{0, changeType::changed, fields, market, std::move(before), info});
+        }
+    }
+
+    current.forEach([&](const symbolRecord& record) {
+        if (!freshNames.contains(current.name(record))) {
+            changes.push_back(symbolChange{0, changeType::removed, statusField | quoteAssetField | tickSizeField | stepSizeField,
+                                           market, current.toSymbolInfo(record), symbolInfo()});
+        }
+    });
+}
+
+void applyChanges(symbolTable& symbols, const std::vector<symbolChange>& changes) {
+    for (const auto& change : changes) {
+        if (change.type == changeType::removed) {
+            symbols.erase(change.before.symbol);
+        }
+        else {
+            symbols.insert(change.after);
+        }
+    }
+}
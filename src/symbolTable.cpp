@@ -0,0 +1,293 @@
+#include "symbolTable.h"
+
+#include <functional>
+
+#include "spdlog/spdlog.h"
+
+stringInterner& symbolStrings() {
+    // order has to match symbolStatus
+    static stringInterner strings{
+        "PRE_TRADING", "TRADING", "POST_TRADING", "END_OF_DAY", "HALT", "AUCTION_MATCH", "BREAK",
+        "PENDING_TRADING", "PRE_DELIVERING", "DELIVERING", "DELIVERED", "PRE_SETTLE", "SETTLING", "CLOSE"
+    };
+    return strings;
+}
+
+// parse tick or step size, logs and stores an absent value if it is not a plain decimal
+static fixedDecimal toFixedDecimal(const std::string& symbol, const char* field, const std::string& text) {
+    fixedDecimal value;
+    if (!fixedDecimal::parse(text, value)) {
+        spdlog::warn("{}: {} {} is not a decimal, dropped", symbol, field, text);
+    }
+    return value;
+}
+
+// dead name bytes from which the arena is compacted once they are more than half of it
+static constexpr size_t minCompactBytes = 4096;
+
+symbolTable::symbolTable()
+: _deadNameBytes(0), _size(0), _usedSlots(0) {}
+
+void symbolTable::reserve(size_t count) {
+    _records.reserve(count);
+    _byName.reserve(count);
+    _quoteAssetPositions.reserve(count);
+    _statusPositions.reserve(count);
+    _names.reserve(count * 12);
+    if (count * 2 > _slots.size()) {
+        rehash(count * 2);
+    }
+}
+
+bool symbolTable::insert(const symbolInfo& info) {
+    return insertRecord(info.symbol, info.quoteAsset, info.status,
+                        toFixedDecimal(info.symbol, "tickSize", info.tickSize), toFixedDecimal(info.symbol, "stepSize", info.stepSize));
+}
+
+bool symbolTable::insertRecord(std::string_view symbol, std::string_view quoteAsset, std::string_view status,
+                               const fixedDecimal& tickSize, const fixedDecimal& stepSize) {
+    if (symbol.size() > UINT16_MAX || _names.size() + symbol.size() > UINT32_MAX) {
+        spdlog::error("{}: symbol name does not fit into the table", symbol);
+        return false;
+    }
+    uint16_t quoteAssetId, statusId;
+    if (!symbolStrings().intern(quoteAsset, quoteAssetId) || !symbolStrings().intern(status, statusId)) {
+        spdlog::error("{}: quote asset {} or status {} does not fit into the string table, symbol dropped", symbol, quoteAsset, status);
+        return false;
+    }
+    // keep the index at most half full
+    if ((_usedSlots + 1) * 2 > _slots.size()) {
+        rehash(_size * 4 > 16 ? _size * 4 : 16);
+    }
+
+    bool found;
+    size_t slot = findSlot(symbol, found);
+    uint32_t index;
+    if (found) {
+        index = _slots[slot] - 1;
+        symbolRecord& record = _records[index];
+        if (record.quoteAsset != quoteAssetId) {
+            removeFromIndex(_byQuoteAsset, _quoteAssetPositions, record.quoteAsset, index);
+            addToIndex(_byQuoteAsset, _quoteAssetPositions, quoteAssetId, index);
+        }
+        if (record.status != statusId) {
+            removeFromIndex(_byStatus, _statusPositions, record.status, index);
+            addToIndex(_byStatus, _statusPositions, statusId, index);
+        }
+    }
+    else {
+        if (!_freeRecords.empty()) {
+            index = _freeRecords.back();
+            _freeRecords.pop_back();
+        }
+        else {
+            index = _records.size();
+            _records.emplace_back();
+            _quoteAssetPositions.push_back(0);
+            _statusPositions.push_back(0);
+        }
+        symbolRecord& record = _records[index];
+        record.nameOffset = _names.size();
+        record.nameLength = symbol.size();
+        record.live = true;
+        _names.insert(_names.end(), symbol.begin(), symbol.end());
+
+        if (_slots[slot] == emptySlot) {
+            ++_usedSlots;
+        }
+        _slots[slot] = index + 1;
+        ++_size;
+
+        _byName.insert(_byName.begin() + (lowerBound(symbol) - _byName.cbegin()), index);
+        addToIndex(_byQuoteAsset, _quoteAssetPositions, quoteAssetId, index);
+        addToIndex(_byStatus, _statusPositions, statusId, index);
+    }
+
+    symbolRecord& record = _records[index];
+    record.quoteAsset = quoteAssetId;
+    record.status = statusId;
+    record.tickSize = tickSize;
+    record.stepSize = stepSize;
+    return !found;
+}
+
+bool symbolTable::find(std::string_view symbol, symbolInfo& info) const {
+    const symbolRecord* record = findRecord(symbol);
+    if (!record) {
+        return false;
+    }
+    info = toSymbolInfo(*record);
+    return true;
+}
+
+const symbolRecord* symbolTable::findRecord(std::string_view symbol) const {
+    if (_size == 0) {
+        return nullptr;
+    }
+    bool found;
+    size_t slot = findSlot(symbol, found);
+    return found ? &_records[_slots[slot] - 1] : nullptr;
+}
+
+bool symbolTable::contains(std::string_view symbol) const {
+    return findRecord(symbol) != nullptr;
+}
+
+bool symbolTable::setStatus(std::string_view symbol, std::string_view status) {
+    symbolRecord* record = const_cast<symbolRecord*>(findRecord(symbol));
+    if (!record) {
+        return false;
+    }
+    uint16_t statusId;
+    if (!symbolStrings().intern(status, statusId)) {
+        spdlog::error("{}: status {} does not fit into the string table, not changed", symbol, status);
+        return false;
+    }
+    if (record->status != statusId) {
+        uint32_t index = record - _records.data();
+        removeFromIndex(_byStatus, _statusPositions, record->status, index);
+        addToIndex(_byStatus, _statusPositions, statusId, index);
+        record->status = statusId;
+    }
+    return true;
+}
+
+bool symbolTable::erase(std::string_view symbol) {
+    if (_size == 0) {
+        return false;
+    }
+    bool found;
+    size_t slot = findSlot(symbol, found);
+    if (!found) {
+        return false;
+    }
+    // name stays in the arena until enough of it is dead to compact it
+    uint32_t index = _slots[slot] - 1;
+    _byName.erase(_byName.begin() + (lowerBound(symbol) - _byName.cbegin()));
+    removeFromIndex(_byQuoteAsset, _quoteAssetPositions, _records[index].quoteAsset, index);
+    removeFromIndex(_byStatus, _statusPositions, _records[index].status, index);
+    _records[index].live = false;
+    _freeRecords.push_back(index);
+    _slots[slot] = erasedSlot;
+    --_size;
+    _deadNameBytes += _records[index].nameLength;
+    if (_deadNameBytes >= minCompactBytes && _deadNameBytes * 2 > _names.size()) {
+        compactNames();
+    }
+    return true;
+}
+
+size_t symbolTable::size() const {
+    return _size;
+}
+
+std::string_view symbolTable::name(const symbolRecord& record) const {
+    return std::string_view(_names.data() + record.nameOffset, record.nameLength);
+}
+
+symbolInfo symbolTable::toSymbolInfo(const symbolRecord& record) const {
+    symbolInfo info;
+    info.symbol = std::string(name(record));
+    info.quoteAsset = symbolStrings().lookup(record.quoteAsset);
+    info.status = symbolStrings().lookup(record.status);
+    info.tickSize = record.tickSize.toString();
+    info.stepSize = record.stepSize.toString();
+    return info;
+}
+
+size_t symbolTable::memoryUsage() const {
+    size_t bytes = _records.capacity() * sizeof(symbolRecord) + _freeRecords.capacity() * sizeof(uint32_t)
+                 + _names.capacity() + _slots.capacity() * sizeof(uint32_t) + _byName.capacity() * sizeof(uint32_t)
+                 + (_quoteAssetPositions.capacity() + _statusPositions.capacity()) * sizeof(uint32_t)
+                 + (_byQuoteAsset.capacity() + _byStatus.capacity()) * sizeof(std::vector<uint32_t>);
+    for (const auto& bucket : _byQuoteAsset) {
+        bytes += bucket.capacity() * sizeof(uint32_t);
+    }
+    for (const auto& bucket : _byStatus) {
+        bytes += bucket.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+size_t symbolTable::findSlot(std::string_view symbol, bool& found) const {
+    size_t mask = _slots.size() - 1;
+    size_t slot = std::hash<std::string_view>()(symbol) & mask;
+    size_t firstErased = _slots.size();
+    while (true) {
+        uint32_t entry = _slots[slot];
+        if (entry == emptySlot) {
+            found = false;
+            return firstErased < _slots.size() ? firstErased : slot;
+        }
+        if (entry == erasedSlot) {
+            if (firstErased == _slots.size()) {
+                firstErased = slot;
+            }
+        }
+        else if (name(_records[entry - 1]) == symbol) {
+            found = true;
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+std::vector<uint32_t>::const_iterator symbolTable::lowerBound(std::string_view symbol) const {
+    return std::lower_bound(_byName.begin(), _byName.end(), symbol, [this](uint32_t index, std::string_view key) {
+        return name(_records[index]) < key;
+    });
+}
+
+void symbolTable::addToIndex(std::vector<std::vector<uint32_t>>& index, std::vector<uint32_t>& positions, uint16_t id, uint32_t record) {
+    if (id >= index.size()) {
+        index.resize(id + 1);
+    }
+    positions[record] = index[id].size();
+    index[id].push_back(record);
+}
+
+void symbolTable::removeFromIndex(std::vector<std::vector<uint32_t>>& index, std::vector<uint32_t>& positions, uint16_t id, uint32_t record) {
+    // move the last record of the bucket into the hole
+    std::vector<uint32_t>& bucket = index[id];
+    uint32_t last = bucket.back();
+    bucket[positions[record]] = last;
+    positions[last] = positions[record];
+    bucket.pop_back();
+}
+
+void symbolTable::rehash(size_t minimumSlots) {
+    size_t slotCount = 16;
+    while (slotCount < minimumSlots) {
+        slotCount *= 2;
+    }
+    _slots.assign(slotCount, emptySlot);
+    _usedSlots = 0;
+
+    size_t mask = slotCount - 1;
+    for (size_t index = 0; index < _records.size(); ++index) {
+        if (!_records[index].live) {
+            continue;
+        }
+        size_t slot = std::hash<std::string_view>()(name(_records[index])) & mask;
+        while (_slots[slot] != emptySlot) {
+            slot = (slot + 1) & mask;
+        }
+        _slots[slot] = index + 1;
+        ++_usedSlots;
+    }
+}
+
+void symbolTable::compactNames() {
+    std::vector<char> names;
+    names.reserve(_names.size() - _deadNameBytes);
+    for (auto& record : _records) {
+        if (!record.live) {
+            continue;
+        }
+        uint32_t offset = names.size();
+        names.insert(names.end(), _names.begin() + record.nameOffset, _names.begin() + record.nameOffset + record.nameLength);
+        record.nameOffset = offset;
+    }
+    _names.swap(names);
+    _deadNameBytes = 0;
+}
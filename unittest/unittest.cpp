@@ -1,22 +1,67 @@
 #include "gtest/gtest.h"
 #include "BinanceExchange.h"
+#include "queryDeduplicator.h"
+#include "queryWatcher.h"
+#include "mockServer.h"
+#include "exchangeInfoParser.h"
+#include "symbolTable.h"
+#include "queryServer.h"
+#include "queryClient.h"
+#include "sharedSymbolsClient.h"
+#include "snapshotWriter.h"
+#include "ioThreadPool.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/async.h"
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include "rapidjson/document.h"
+#include <fstream>
+#include <atomic>
+#include <thread>
+#include <sstream>
+#include <regex>
 #include "example/common/root_certificates.hpp"
 #include <boost/asio/ssl.hpp>
 
 
+// small exchangeInfo response in the format of the binance api
+static const std::string testExchangeInfo = R"({"timezone":"UTC","serverTime":1730000000000,"symbols":[
+{"symbol":"ETHBTC","status":"TRADING","baseAsset":"ETH","quoteAsset":"BTC","orderTypes":["LIMIT","MARKET"],"filters":[
+{"filterType":"PRICE_FILTER","minPrice":"0.00001000","maxPrice":"922327.00000000","tickSize":"0.00001000"},
+{"filterType":"LOT_SIZE","minQty":"0.00010000","maxQty":"100000.00000000","stepSize":"0.00010000"}]},
+{"symbol":"BTCUSDT","status":"TRADING","baseAsset":"BTC","quoteAsset":"USDT","orderTypes":["LIMIT","MARKET"],"filters":[
+{"filterType":"PRICE_FILTER","minPrice":"0.01000000","maxPrice":"1000000.00000000","tickSize":"0.01000000"},
+{"filterType":"LOT_SIZE","minQty":"0.00001000","maxQty":"9000.00000000","stepSize":"0.00001000"}]}]})";
+
+// point all three markets at a local mock server
+static void useMockServer(mockServer& server, urlInfo& urlConfig, boost::asio::ssl::context& ctx) {
+    urlConfig.spotExchangeEndpoint = "/api/v3/exchangeInfo";
+    urlConfig.usdFutureEndpoint = "/dapi/v1/exchangeInfo";
+    urlConfig.coinFutureEndpoint = "/fapi/v1/exchangeInfo";
+    server.setResponse(urlConfig.spotExchangeEndpoint, testExchangeInfo);
+    server.setResponse(urlConfig.usdFutureEndpoint, testExchangeInfo);
+    server.setResponse(urlConfig.coinFutureEndpoint, testExchangeInfo);
+    server.start();
+
+    urlConfig.spotExchangeBaseUrl = server.baseUrl();
+    urlConfig.usdFutureExchangeBaseUrl = server.baseUrl();
+    urlConfig.coinFutureExchangeBaseUrl = server.baseUrl();
+    urlConfig.requestInterval = 1;
+
+    ctx.add_certificate_authority(boost::asio::buffer(server.certificate()));
+    ctx.set_verify_mode(ssl::verify_peer);
+}
+
 // Test fetchData function
 TEST(fetchDataFunctionTest, validResponse) {
     exchangeInfo binanceExchange;
+    mockServer server;
     urlInfo urlConfig;
-    logsInfo logsConfig;
-
-    // read configuration file
-    binanceExchange.readConfig("config.json", urlConfig, logsConfig);
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    useMockServer(server, urlConfig, ctx);
 
     boost::asio::io_context io;
-    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
-    load_root_certificates(ctx);
-    ctx.set_verify_mode(ssl::verify_peer);
 
     // Call fetchData 
     binanceExchange.fetchData(urlConfig, io, ctx);
@@ -31,6 +76,198 @@ TEST(fetchDataFunctionTest, validResponse) {
     EXPECT_EQ(binanceExchange.getSpotSymbol(symbolName).quoteAsset, "USDT");
 }
 
+// Test that every refresh reuses the keep-alive connection of each market
+TEST(fetchDataFunctionTest, connectionReuse) {
+    mockServer server;
+    urlInfo urlConfig;
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    useMockServer(server, urlConfig, ctx);
+
+    exchangeInfo binanceExchange;
+    boost::asio::io_context io;
+
+    for (int refresh = 0; refresh < 3; ++refresh) {
+        binanceExchange.fetchData(urlConfig, io, ctx);
+        io.run();
+        io.restart();
+    }
+
+    // one connection and handshake per market, one request per market and refresh
+    EXPECT_EQ(server.connectionCount(), 3);
+    EXPECT_EQ(server.handshakeCount(), 3);
+    EXPECT_EQ(server.requestCount(), 9);
+    ASSERT_EQ(binanceExchange.spotSymbolexists("BTCUSDT"), true);
+    EXPECT_EQ(binanceExchange.getSpotSymbol("BTCUSDT").quoteAsset, "USDT");
+    EXPECT_EQ(binanceExchange.getCoinSymbol("ETHBTC").tickSize, "0.00001000");
+}
+
+// Test that reconnects use cached endpoints and resume the tls session
+TEST(fetchDataFunctionTest, sessionResumption) {
+    mockServer server;
+    server.setKeepAlive(false);
+    urlInfo urlConfig;
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    useMockServer(server, urlConfig, ctx);
+
+    exchangeInfo binanceExchange;
+    boost::asio::io_context io;
+
+    for (int refresh = 0; refresh < 2; ++refresh) {
+        binanceExchange.fetchData(urlConfig, io, ctx);
+        io.run();
+        io.restart();
+    }
+
+    // first refresh resolves and does full handshakes, second one reconnects from the caches
+    connectionStats stats = binanceExchange.getConnectionStats();
+    EXPECT_EQ(server.connectionCount(), 6);
+    EXPECT_EQ(stats.dnsMisses, 3);
+    EXPECT_EQ(stats.dnsHits, 3);
+    EXPECT_EQ(stats.fullHandshakes, 3);
+    EXPECT_EQ(stats.resumedHandshakes, 3);
+}
+
+// Test that recorded responses replay through the mock server with latency, chunking and scaling
+TEST(fetchDataFunctionTest, recordAndReplay) {
+    exchangeInfo recorder;
+    recorder.setRecordDirectory("recorded_test");
+    {
+        mockServer server;
+        urlInfo urlConfig;
+        boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+        useMockServer(server, urlConfig, ctx);
+        boost::asio::io_context io;
+        recorder.fetchData(urlConfig, io, ctx);
+        io.run();
+    }
+    std::ifstream recorded("recorded_test/usd_futures.json");
+    std::stringstream recordedBody;
+    recordedBody << recorded.rdbuf();
+    EXPECT_EQ(recordedBody.str(), testExchangeInfo);
+
+    mockServer replay;
+    urlInfo urlConfig;
+    urlConfig.spotExchangeEndpoint = "/api/v3/exchangeInfo";
+    urlConfig.usdFutureEndpoint = "/fapi/v1/exchangeInfo";
+    urlConfig.coinFutureEndpoint = "/dapi/v1/exchangeInfo";
+    ASSERT_EQ(replay.setResponseFromFile(urlConfig.spotExchangeEndpoint, "recorded_test/SPOT.json"), true);
+    ASSERT_EQ(replay.setResponseFromFile(urlConfig.usdFutureEndpoint, "recorded_test/usd_futures.json"), true);
+    ASSERT_EQ(replay.setResponseFromFile(urlConfig.coinFutureEndpoint, "recorded_test/coin_futures.json"), true);
+    EXPECT_EQ(replay.setResponseFromFile("/missing", "recorded_test/missing.json"), false);
+    replay.setResponse(urlConfig.coinFutureEndpoint, mockServer::scalePayload(testExchangeInfo, 50));
+    replay.setLatency(std::chrono::milliseconds(20));
+    replay.setChunking(100, std::chrono::microseconds(100));
+    replay.start();
+    urlConfig.spotExchangeBaseUrl = urlConfig.usdFutureExchangeBaseUrl = urlConfig.coinFutureExchangeBaseUrl = replay.baseUrl();
+
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    ctx.add_certificate_authority(boost::asio::buffer(replay.certificate()));
+    ctx.set_verify_mode(ssl::verify_peer);
+    exchangeInfo binanceExchange;
+    boost::asio::io_context io;
+    auto start = std::chrono::steady_clock::now();
+    binanceExchange.fetchData(urlConfig, io, ctx);
+    io.run();
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+    EXPECT_EQ(binanceExchange.getSpotSymbolsSize(), 2);
+    EXPECT_EQ(binanceExchange.getCoinSymbolsSize(), 100);
+    EXPECT_EQ(binanceExchange.getCoinSymbol("BTCUSDT_49").tickSize, "0.01000000");
+    EXPECT_EQ(binanceExchange.getUsdSymbol("ETHBTC").stepSize, "0.00010000");
+}
+
+// Test histogram accuracy and that every stage of the refresh requests is traced per host
+TEST(latencyStatsTest, stagesPerHost) {
+    latencyHistogram histogram;
+    for (int64_t value = 1; value <= 100000; ++value) {
+        histogram.record(value * 1000);
+    }
+    histogram.record(-1);
+    EXPECT_EQ(histogram.count(), 100000);
+    EXPECT_EQ(histogram.max(), 100000000);
+    EXPECT_NEAR(double(histogram.percentile(50)), 50000000.0, 50000000.0 * 0.04);
+    EXPECT_NEAR(double(histogram.percentile(99)), 99000000.0, 99000000.0 * 0.04);
+    EXPECT_EQ(histogram.percentile(100), 100000000);
+    for (uint64_t value : {0ull, 63ull, 64ull, 1000ull, 123456789ull, ~0ull}) {
+        EXPECT_GE(latencyHistogram::highestValueOf(latencyHistogram::bucketOf(value)), value);
+        EXPECT_LT(latencyHistogram::bucketOf(value), latencyHistogram::bucketCount);
+    }
+
+    mockServer server;
+    server.setLatency(std::chrono::milliseconds(20));
+    urlInfo urlConfig;
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    useMockServer(server, urlConfig, ctx);
+    exchangeInfo binanceExchange;
+    boost::asio::io_context io;
+    for (int refresh = 0; refresh < 2; ++refresh) {
+        binanceExchange.fetchData(urlConfig, io, ctx);
+        io.run();
+        io.restart();
+    }
+
+    const latencyStats& stats = binanceExchange.getLatencyStats();
+    const latencyHistogram* read = stats.find(server.baseUrl(), traceStage::read);
+    ASSERT_NE(read, nullptr);
+    EXPECT_EQ(read->count(), 6);
+    EXPECT_GE(read->percentile(50), 20000000);
+    EXPECT_EQ(stats.find(server.baseUrl(), traceStage::handshake)->count(), 3);
+    EXPECT_EQ(stats.find(server.baseUrl(), traceStage::total)->count(), 6);
+    EXPECT_EQ(stats.find("localhost", traceStage::read), nullptr);
+
+    std::string answer;
+    parsedQuery query{1, "", "", "STATS", "", ""};
+    ASSERT_EQ(binanceExchange.executeQueries(&query, 1, answer), 1);
+    rapidjson::Document doc;
+    doc.Parse(answer.c_str());
+    ASSERT_EQ(doc.HasParseError(), false);
+    EXPECT_EQ(std::string(doc["stats"]["hosts"][0]["host"].GetString()), server.baseUrl());
+    EXPECT_EQ(doc["stats"]["hosts"][0]["read"]["count"].GetUint64(), 6);
+    EXPECT_GE(doc["stats"]["hosts"][0]["read"]["p99Us"].GetUint64(), 20000);
+}
+
+// Test that the streaming parser fed one byte at a time finds the same symbols as the DOM parser
+TEST(parserTest, streamingMatchesDom) {
+    std::vector<symbolInfo> domSymbols;
+    ASSERT_EQ(parseExchangeInfoDom(testExchangeInfo, domSymbols), true);
+
+    exchangeInfoStreamParser parser;
+    for (char c : testExchangeInfo) {
+        ASSERT_EQ(parser.feed(&c, 1), true);
+    }
+    ASSERT_EQ(parser.finish(), true);
+    ASSERT_EQ(parser.hasSymbols(), true);
+    ASSERT_EQ(parser.symbols().size(), domSymbols.size());
+
+    for (size_t index = 0; index < domSymbols.size(); ++index) {
+        EXPECT_EQ(parser.symbols()[index].symbol, domSymbols[index].symbol);
+        EXPECT_EQ(parser.symbols()[index].quoteAsset, domSymbols[index].quoteAsset);
+        EXPECT_EQ(parser.symbols()[index].status, domSymbols[index].status);
+        EXPECT_EQ(parser.symbols()[index].tickSize, domSymbols[index].tickSize);
+        EXPECT_EQ(parser.symbols()[index].stepSize, domSymbols[index].stepSize);
+    }
+}
+
+// Test that a parser reused for the next document keeps its symbol slots and leaves no fields of the previous one behind
+TEST(parserTest, reusedAcrossDocuments) {
+    exchangeInfoStreamParser parser;
+    ASSERT_EQ(parser.feed(testExchangeInfo.data(), testExchangeInfo.size()), true);
+    ASSERT_EQ(parser.finish(), true);
+    ASSERT_EQ(parser.symbols().size(), 2);
+    const symbolInfo* slots = parser.symbols().data();
+
+    std::string shorter = R"({"symbols":[{"symbol":"BNBUSDT","status":"BREAK","quoteAsset":"USDT","filters":[]}]})";
+    parser.reset();
+    ASSERT_EQ(parser.feed(shorter.data(), shorter.size()), true);
+    ASSERT_EQ(parser.finish(), true);
+    ASSERT_EQ(parser.symbols().size(), 1);
+    EXPECT_EQ(parser.symbols().data(), slots);
+    EXPECT_EQ(parser.symbols()[0].symbol, "BNBUSDT");
+    EXPECT_EQ(parser.symbols()[0].status, "BREAK");
+    EXPECT_EQ(parser.symbols()[0].tickSize, "");
+    EXPECT_EQ(parser.symbols()[0].stepSize, "");
+}
+
 // Test for update operation in query function
 TEST(queryFunctionTest, updateRequest) {
     exchangeInfo binanceExchange;
@@ -58,16 +295,12 @@ TEST(queryFunctionTest, updateRequest) {
 
 TEST(queryFunctionTest, deleteRequest) {
     exchangeInfo binanceExchange;
+    mockServer server;
     urlInfo urlConfig;
-    logsInfo logsConfig;
-
-    // read configuration file
-    binanceExchange.readConfig("config.json", urlConfig, logsConfig);
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    useMockServer(server, urlConfig, ctx);
 
     boost::asio::io_context io;
-    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
-    load_root_certificates(ctx);
-    ctx.set_verify_mode(ssl::verify_peer);
 
     // Call fetchData 
     binanceExchange.fetchData(urlConfig, io, ctx);
@@ -83,6 +316,1188 @@ TEST(queryFunctionTest, deleteRequest) {
     EXPECT_EQ(binanceExchange.spotSymbolexists(symbol), false);
 }
 
+// Test that batched answers keep the answers file a valid json array
+TEST(queryFunctionTest, answersFileValidJson) {
+    exchangeInfo binanceExchange;
+    queryInfo queryConfig;
+    queryConfig.answersFile = "test_answers.json";
+    binanceExchange.setQueryConfig(queryConfig);
+
+    symbolInfo testSymbol{"BTCUSDT", "USDT", "TRADING", "0.01", "0.001"};
+    binanceExchange.setSpotSymbol(testSymbol.symbol, testSymbol);
+
+    std::string market = "SPOT", symbol = "BTCUSDT", queryType = "GET", queryStatus = "";
+    for (int index = 0; index < 100; ++index) {
+        binanceExchange.processQuery(market, symbol, queryType, queryStatus);
+    }
+    binanceExchange.flushAnswers();
+
+    std::ifstream answersFile("test_answers.json");
+    std::stringstream answers;
+    answers << answersFile.rdbuf();
+
+    rapidjson::Document doc;
+    ASSERT_EQ(doc.Parse(answers.str().c_str()).HasParseError(), false);
+    ASSERT_EQ(doc.IsArray(), true);
+    EXPECT_EQ(doc.Size(), 100);
+    EXPECT_EQ(std::string(doc[0]["get"]["tickSize"].GetString()), "0.01");
+}
+
+// Test that answers are dropped instead of blocking the query thread when the answers file can not be opened
+TEST(queryFunctionTest, answersFileNotOpen) {
+    exchangeInfo binanceExchange;
+    queryInfo queryConfig;
+    queryConfig.answersFile = "missing_dir/test_answers.json";
+    binanceExchange.setQueryConfig(queryConfig);
+    binanceExchange.setSpotSymbol("BTCUSDT", {"BTCUSDT", "USDT", "TRADING", "0.01", "0.001"});
+
+    // more than the queue of the writer holds
+    std::string market = "SPOT", symbol = "BTCUSDT", queryType = "GET", queryStatus = "";
+    for (int index = 0; index < 5000; ++index) {
+        binanceExchange.processQuery(market, symbol, queryType, queryStatus);
+    }
+    binanceExchange.flushAnswers();
+    EXPECT_EQ(binanceExchange.getDroppedAnswers(), 5000);
+}
+
+// Test that a batch runs its queries in order and joins the answers the way the answers file does
+TEST(queryFunctionTest, batchedQueries) {
+    exchangeInfo binanceExchange;
+    binanceExchange.setSpotSymbol("BTCUSDT", {"BTCUSDT", "USDT", "TRADING", "0.01", "0.001"});
+    binanceExchange.setSpotSymbol("ETHBTC", {"ETHBTC", "BTC", "TRADING", "0.00001", "0.0001"});
+    binanceExchange.setUsdSymbol("BTCUSDT", {"BTCUSDT", "USDT", "TRADING", "0.1", "0.001"});
+
+    std::vector<parsedQuery> batch = {
+        {1, "SPOT", "BTCUSDT", "GET", ""},
+        {2, "SPOT", "BTCUSDT", "UPDATE", "BREAK"},
+        {3, "SPOT", "ETHBTC", "DELETE", ""},
+        {4, "SPOT", "DOGEUSDT", "UPDATE", "HALT"},
+        {5, "usd_futures", "BTCUSDT", "UPDATE", "SETTLING"},
+        {6, "SPOT", "BTCUSDT", "GET", ""},
+        {7, "SPOT", "ETHBTC", "GET", ""},
+    };
+    std::string answers;
+    ASSERT_EQ(binanceExchange.executeQueries(batch.data(), batch.size(), answers), 5);
+
+    rapidjson::Document doc;
+    ASSERT_EQ(doc.Parse(("[" + answers + "]").c_str()).HasParseError(), false);
+    ASSERT_EQ(doc.Size(), 5);
+    EXPECT_EQ(std::string(doc[0]["get"]["status"].GetString()), "TRADING");
+    EXPECT_EQ(std::string(doc[1]["update"]["oldstatus"].GetString()), "TRADING");
+    EXPECT_EQ(std::string(doc[2]["delete"]["deletedSymbol"].GetString()), "ETHBTC");
+    EXPECT_EQ(std::string(doc[3]["update"]["oldStatus"].GetString()), "TRADING");
+    EXPECT_EQ(std::string(doc[4]["get"]["status"].GetString()), "BREAK");
+
+    uint64_t cursor = 0;
+    std::vector<symbolChange> changes;
+    binanceExchange.readChanges(cursor, changes);
+    EXPECT_EQ(changes.size(), 3);
+    EXPECT_EQ(binanceExchange.getUsdSymbol("BTCUSDT").status, "SETTLING");
+}
+
+// Test that LIST, FILTER and PREFIX follow refreshes and local changes through the secondary indexes
+TEST(queryFunctionTest, listFilterPrefix) {
+    exchangeInfo binanceExchange;
+    std::vector<symbolInfo> symbols = {
+        {"BTCUSDT", "USDT", "TRADING", "0.01", "0.001"},
+        {"ETHUSDT", "USDT", "BREAK", "0.01", "0.001"},
+        {"BTCBUSD", "BUSD", "TRADING", "0.01", "0.001"},
+        {"ETHBTC", "BTC", "TRADING", "0.00001", "0.0001"},
+    };
+    binanceExchange.refreshMarket("usd_futures", symbols);
+
+    auto run = [&](const parsedQuery& query) {
+        std::string answer;
+        binanceExchange.executeQueries(&query, 1, answer);
+        rapidjson::Document doc;
+        doc.Parse(answer.c_str());
+        std::vector<std::string> names;
+        const auto& result = doc.MemberBegin()->value;
+        for (const auto& symbol : result["symbols"].GetArray()) {
+            names.push_back(symbol["symbol"].GetString());
+        }
+        EXPECT_EQ(result["count"].GetUint64(), names.size());
+        return names;
+    };
+
+    parsedQuery list{1, "usd_futures", "", "LIST", "", ""};
+    parsedQuery tradingUsdt{2, "usd_futures", "", "FILTER", "TRADING", "USDT"};
+    parsedQuery btcPrefix{3, "usd_futures", "BTC", "PREFIX", "", ""};
+    EXPECT_EQ(run(list), std::vector<std::string>({"BTCBUSD", "BTCUSDT", "ETHBTC", "ETHUSDT"}));
+    EXPECT_EQ(run(tradingUsdt), std::vector<std::string>({"BTCUSDT"}));
+    EXPECT_EQ(run(btcPrefix), std::vector<std::string>({"BTCBUSD", "BTCUSDT"}));
+
+    // indexes follow status updates, deletes and refreshes
+    binanceExchange.updateUsdStatus("ETHUSDT", "TRADING");
+    binanceExchange.deleteUsdSymbol("BTCUSDT");
+    symbols.erase(symbols.begin());
+    symbols[0].status = "TRADING";
+    symbols.push_back({"BTCUSDC", "USDC", "TRADING", "0.1", "0.001"});
+    binanceExchange.refreshMarket("usd_futures", symbols);
+    EXPECT_EQ(run(tradingUsdt), std::vector<std::string>({"ETHUSDT"}));
+    EXPECT_EQ(run(btcPrefix), std::vector<std::string>({"BTCBUSD", "BTCUSDC"}));
+
+    parsedQuery unknownStatus{4, "usd_futures", "", "FILTER", "NO_SUCH_STATUS", ""};
+    EXPECT_EQ(run(unknownStatus).size(), 0);
+}
+
+// Test a market added at runtime behaves like the built-in ones
+TEST(marketRegistryTest, addedMarket) {
+    exchangeInfo binanceExchange;
+    EXPECT_EQ(binanceExchange.getMarkets().size(), 3);
+    EXPECT_EQ(binanceExchange.addMarket("options"), 3);
+    EXPECT_EQ(binanceExchange.addMarket("options"), 3);
+    EXPECT_EQ(binanceExchange.getMarkets().find("margin"), marketRegistry::unknown);
+
+    // readiness now waits for the added market too
+    std::vector<symbolInfo> symbols = {{"BTCUSDT", "USDT", "TRADING", "0.01", "0.001"}};
+    binanceExchange.refreshMarket("SPOT", symbols);
+    binanceExchange.refreshMarket("usd_futures", symbols);
+    binanceExchange.refreshMarket("coin_futures", symbols);
+    EXPECT_FALSE(binanceExchange.isReady());
+    binanceExchange.refreshMarket("options", {{"BTC-261225-100000-C", "USDT", "TRADING", "5", "0.01"}});
+    EXPECT_TRUE(binanceExchange.isReady());
+
+    EXPECT_TRUE(binanceExchange.symbolExists("options", "BTC-261225-100000-C"));
+    EXPECT_FALSE(binanceExchange.symbolExists("SPOT", "BTC-261225-100000-C"));
+    EXPECT_EQ(binanceExchange.getSymbolsSize("options"), 1);
+    EXPECT_EQ(binanceExchange.getSymbol("options", "BTC-261225-100000-C").tickSize, "5");
+    EXPECT_EQ(binanceExchange.getSymbol<marketId::coinFutures>("BTCUSDT").status, "TRADING");
+
+    std::string answer;
+    parsedQuery queries[] = {
+        {1, "options", "BTC-261225-100000-C", "UPDATE", "BREAK", ""},
+        {2, "options", "", "LIST", "", ""},
+        {3, "no_such_market", "", "LIST", "", ""},
+    };
+    binanceExchange.executeQueries(queries, 3, answer);
+    EXPECT_NE(answer.find("\"oldStatus\":\"TRADING\""), std::string::npos);
+    EXPECT_NE(answer.find("\"count\":1"), std::string::npos);
+    EXPECT_EQ(binanceExchange.getSymbol("options", "BTC-261225-100000-C").status, "BREAK");
+
+    binanceExchange.deleteSymbol("options", "BTC-261225-100000-C");
+    EXPECT_EQ(binanceExchange.getSymbolsSize("options"), 0);
+}
+
+// Test that answers which can not be written are counted as dropped and do not block flush
+TEST(answersWriterTest, failedWrites) {
+    answersWriter writer;
+    ASSERT_EQ(writer.open("/dev/full", true), true);
+    writer.write("{\"get\":{}}");
+    writer.write("{\"get\":{}}");
+    writer.flush();
+    EXPECT_EQ(writer.dropped(), 2);
+    writer.close();
+}
+
+// Test query id de-duplication with a memory cap
+TEST(queryDedupTest, boundedCapacity) {
+    queryDeduplicator prevIDs(2);
+
+    EXPECT_EQ(prevIDs.insert(100), true);
+    EXPECT_EQ(prevIDs.insert(100), false);
+    EXPECT_EQ(prevIDs.insert(1), true);
+    EXPECT_EQ(prevIDs.insert(2), true);
+
+    // the oldest out of order id is forgotten, ids that never arrived are still processed
+    EXPECT_EQ(prevIDs.insert(3), true);
+    EXPECT_EQ(prevIDs.size(), 2);
+    EXPECT_EQ(prevIDs.seen(1), false);
+    EXPECT_EQ(prevIDs.insert(50), true);
+    EXPECT_EQ(prevIDs.insert(4), true);
+    EXPECT_EQ(prevIDs.size(), 2);
+
+    // the id just added is never the one forgotten
+    EXPECT_EQ(prevIDs.seen(4), true);
+    EXPECT_EQ(prevIDs.insert(4), false);
+
+    // consecutive ids grow the run at either end and take no room in the set
+    EXPECT_EQ(prevIDs.insert(99), true);
+    EXPECT_EQ(prevIDs.insert(101), true);
+    for (unsigned long long id = 102; id < 1000; ++id) {
+        EXPECT_EQ(prevIDs.insert(id), true);
+    }
+    EXPECT_EQ(prevIDs.size(), 2);
+    EXPECT_EQ(prevIDs.seen(500), true);
+    EXPECT_EQ(prevIDs.insert(100), false);
+
+    // the run takes over stored ids it reaches
+    for (unsigned long long id = 98; id > 50; --id) {
+        EXPECT_EQ(prevIDs.insert(id), true);
+    }
+    EXPECT_EQ(prevIDs.size(), 1);
+    EXPECT_EQ(prevIDs.seen(50), true);
+    EXPECT_EQ(prevIDs.insert(5), true);
+    EXPECT_EQ(prevIDs.size(), 2);
+}
+
+// Test that a stop requested before the query file is watched is not lost
+TEST(queryWatcherTest, stopBeforeWatch) {
+    std::ofstream("stop_query.json") << "{\"query\":[\n]}";
+    for (bool useInotify : {true, false}) {
+        queryWatcher watcher;
+        watcher.stop();
+        EXPECT_EQ(watcher.watch("stop_query.json", useInotify), true);
+        EXPECT_EQ(watcher.waitForChange(), false);
+        EXPECT_EQ(watcher.waitForChange(), false);
+    }
+}
+
+// Test that only query objects appended since the last read are returned, also when an object is written in two parts
+TEST(queryWatcherTest, incrementalReads) {
+    queryWatcher watcher;
+    std::vector<std::string> queries;
+    std::ofstream("watch_query.json") << "{\"query\":[\n{\"id\":1,\"query_type\":\"GET\"}\n]}";
+    ASSERT_EQ(watcher.watch("watch_query.json", false), true);
+    ASSERT_EQ(watcher.readNewQueries(queries), 1);
+    EXPECT_EQ(queries[0], "{\"id\":1,\"query_type\":\"GET\"}");
+    EXPECT_EQ(watcher.readNewQueries(queries), 0);
+
+    // two objects appended, only they are read
+    std::string content = "{\"query\":[\n{\"id\":1,\"query_type\":\"GET\"},\n{\"id\":2,\"data\":{\"status\":\"HALT\"}},\n{\"id\":3}";
+    std::ofstream("watch_query.json") << content << "\n]}";
+    queries.clear();
+    ASSERT_EQ(watcher.readNewQueries(queries), 2);
+    EXPECT_EQ(queries[0], "{\"id\":2,\"data\":{\"status\":\"HALT\"}}");
+    EXPECT_EQ(queries[1], "{\"id\":3}");
+
+    // an object cut off in the middle is returned once it is complete
+    content += ",\n{\"id\":4,\"query_type\":\"G";
+    std::ofstream("watch_query.json") << content;
+    queries.clear();
+    EXPECT_EQ(watcher.readNewQueries(queries), 0);
+    content += "ET\"}";
+    std::ofstream("watch_query.json") << content << "\n]}";
+    ASSERT_EQ(watcher.readNewQueries(queries), 1);
+    EXPECT_EQ(queries[0], "{\"id\":4,\"query_type\":\"GET\"}");
+
+    // braces, brackets and escaped quotes inside strings do not end the object
+    std::string tricky = "{\"id\":5,\"instrument_name\":\"}]{[\\\"}\\\\\",\"data\":{\"status\":\"\\\"{\"}}";
+    content += ",\n" + tricky;
+    std::ofstream("watch_query.json") << content << "\n]}";
+    queries.clear();
+    ASSERT_EQ(watcher.readNewQueries(queries), 1);
+    EXPECT_EQ(queries[0], tricky);
+    EXPECT_EQ(watcher.readNewQueries(queries), 0);
+}
+
+// Test that a truncated, replaced or rewritten query file is read again from the beginning
+TEST(queryWatcherTest, replacedFile) {
+    queryWatcher watcher;
+    std::vector<std::string> queries;
+    std::ofstream("replace_query.json") << "{\"query\":[\n{\"id\":1},\n{\"id\":2},\n{\"id\":3}\n]}";
+    ASSERT_EQ(watcher.watch("replace_query.json", false), true);
+    ASSERT_EQ(watcher.readNewQueries(queries), 3);
+
+    // truncated below the last read object
+    std::ofstream("replace_query.json") << "{\"query\":[\n{\"id\":4}\n]}";
+    queries.clear();
+    ASSERT_EQ(watcher.readNewQueries(queries), 1);
+    EXPECT_EQ(queries[0], "{\"id\":4}");
+
+    // replaced by rename, the new file has another inode
+    std::ofstream("replace_query.tmp") << "{\"query\":[\n{\"id\":5},\n{\"id\":6}\n]}";
+    ASSERT_EQ(std::rename("replace_query.tmp", "replace_query.json"), 0);
+    queries.clear();
+    ASSERT_EQ(watcher.readNewQueries(queries), 2);
+    EXPECT_EQ(queries[0], "{\"id\":5}");
+
+    // rewritten in place so the byte before the offset is no longer the end of an object
+    std::ofstream("replace_query.json") << "{\"query\":[\n{\"id\":7,\"query_type\":\"GET\"}\n]}";
+    queries.clear();
+    ASSERT_EQ(watcher.readNewQueries(queries), 1);
+    EXPECT_EQ(queries[0], "{\"id\":7,\"query_type\":\"GET\"}");
+}
+
+// Test that queries wait for the first snapshot of every market and time-to-ready is reported
+TEST(fetchDataFunctionTest, readyAfterWarmUp) {
+    mockServer server;
+    urlInfo urlConfig;
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    useMockServer(server, urlConfig, ctx);
+
+    exchangeInfo binanceExchange;
+    EXPECT_EQ(binanceExchange.isReady(), false);
+    EXPECT_EQ(binanceExchange.getTimeToReady().count(), -1);
+    EXPECT_EQ(binanceExchange.waitUntilReady(std::chrono::milliseconds(10)), false);
+
+    boost::asio::io_context io;
+    binanceExchange.fetchData(urlConfig, io, ctx);
+    std::thread ioThread([&io] { io.run(); });
+
+    EXPECT_EQ(binanceExchange.waitUntilReady(std::chrono::seconds(10)), true);
+    EXPECT_GE(binanceExchange.getTimeToReady().count(), 0);
+    EXPECT_EQ(binanceExchange.usdSymbolexists("ETHBTC"), true);
+    ioThread.join();
+}
+
+// Test that a restart serves the tables of the previous run as stale until they are refreshed
+TEST(snapshotFileTest, warmRestart) {
+    {
+        exchangeInfo binanceExchange;
+        binanceExchange.setSnapshotFile("test_symbols.snapshot");
+        for (const char* market : {"SPOT", "usd_futures", "coin_futures"}) {
+            std::unique_ptr<symbolTable> symbols(new symbolTable());
+            symbols->insert(symbolInfo{"BTCUSDT", "USDT", "TRADING", "0.01000000", "0.00001000"});
+            symbols->insert(symbolInfo{std::string(market) + "ONLY", "BTC", "BREAK", "0.1", ""});
+            if (std::string(market) == "SPOT") binanceExchange.publishSpotSymbols(std::move(symbols));
+            if (std::string(market) == "usd_futures") binanceExchange.publishUsdSymbols(std::move(symbols));
+            if (std::string(market) == "coin_futures") binanceExchange.publishCoinSymbols(std::move(symbols));
+        }
+    }
+
+    exchangeInfo binanceExchange;
+    binanceExchange.setSnapshotFile("test_symbols.snapshot");
+    ASSERT_EQ(binanceExchange.loadSnapshot(), true);
+    EXPECT_EQ(binanceExchange.isReady(), true);
+    EXPECT_EQ(binanceExchange.isStale("SPOT"), true);
+    EXPECT_GT(binanceExchange.getSnapshotTime(), 0);
+    EXPECT_EQ(binanceExchange.getSpotSymbol("BTCUSDT").tickSize, "0.01000000");
+    EXPECT_EQ(binanceExchange.getUsdSymbol("usd_futuresONLY").status, "BREAK");
+    EXPECT_EQ(binanceExchange.getCoinSymbol("coin_futuresONLY").stepSize, "");
+    EXPECT_EQ(binanceExchange.spotSymbolexists("usd_futuresONLY"), false);
+
+    // network refresh of one market replaces only that market
+    std::unique_ptr<symbolTable> symbols(new symbolTable());
+    symbols->insert(symbolInfo{"ETHBTC", "BTC", "TRADING", "0.00001000", "0.00010000"});
+    binanceExchange.publishSpotSymbols(std::move(symbols));
+    EXPECT_EQ(binanceExchange.isStale("SPOT"), false);
+    EXPECT_EQ(binanceExchange.isStale("usd_futures"), true);
+    EXPECT_EQ(binanceExchange.spotSymbolexists("BTCUSDT"), false);
+
+    // a damaged file is ignored
+    FILE* snapshot = fopen("test_symbols.snapshot", "r+");
+    fseek(snapshot, 40, SEEK_SET);
+    fputc('x', snapshot);
+    fclose(snapshot);
+    exchangeInfo damaged;
+    damaged.setSnapshotFile("test_symbols.snapshot");
+    EXPECT_EQ(damaged.loadSnapshot(), false);
+    EXPECT_EQ(damaged.getSpotSymbolsSize(), 0);
+}
+
+// Test that saves requested while one is running are coalesced and none is lost
+TEST(snapshotFileTest, savesCoalesced) {
+    std::atomic<int> saves{0};
+    snapshotWriter writer([&saves] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ++saves;
+        return true;
+    });
+    for (int request = 0; request < 10; ++request) {
+        writer.request();
+    }
+    writer.flush();
+    EXPECT_GE(saves.load(), 1);
+    EXPECT_LE(saves.load(), 2);
+    EXPECT_EQ(writer.saves(), unsigned(saves.load()));
+
+    // a request still open when the writer stops is saved, later ones are ignored
+    int before = saves.load();
+    writer.request();
+    writer.stop();
+    EXPECT_EQ(saves.load(), before + 1);
+    writer.request();
+    EXPECT_EQ(writer.saves(), unsigned(saves.load()));
+}
+
+// Test that unchanged refreshes are skipped and changed ones produce per symbol change events
+TEST(refreshDiffTest, changeEvents) {
+    exchangeInfo binanceExchange;
+    std::vector<symbolInfo> symbols = {
+        {"BTCUSDT", "USDT", "TRADING", "0.01000000", "0.00001000"},
+        {"ETHBTC", "BTC", "TRADING", "0.00001000", "0.00010000"},
+        {"BNBBTC", "BTC", "TRADING", "0.0000001", "0.001"},
+    };
+    uint64_t cursor = 0;
+    std::vector<symbolChange> changes;
+
+    EXPECT_EQ(binanceExchange.refreshMarket("SPOT", symbols), 3);
+    EXPECT_EQ(binanceExchange.readChanges(cursor, changes), true);
+    ASSERT_EQ(changes.size(), 3);
+    EXPECT_EQ(changes[0].type, changeType::added);
+
+    // same content again is skipped
+    EXPECT_EQ(binanceExchange.refreshMarket("SPOT", symbols), 0);
+    EXPECT_EQ(binanceExchange.getRefreshStats().unchanged, 1);
+
+    // one status change, one filter change, one delisting and one listing
+    symbols[0].status = "BREAK";
+    symbols[1].tickSize = "0.00000100";
+    symbols.erase(symbols.begin() + 2);
+    symbols.push_back({"SOLUSDT", "USDT", "TRADING", "0.01", "0.001"});
+    EXPECT_EQ(binanceExchange.refreshMarket("SPOT", symbols), 4);
+    EXPECT_EQ(binanceExchange.getRefreshStats().changed, 2);
+
+    changes.clear();
+    EXPECT_EQ(binanceExchange.readChanges(cursor, changes), true);
+    ASSERT_EQ(changes.size(), 4);
+    EXPECT_EQ(changes[0].type, changeType::changed);
+    EXPECT_EQ(changes[0].fields, statusField);
+    EXPECT_EQ(changes[0].before.status, "TRADING");
+    EXPECT_EQ(changes[0].after.status, "BREAK");
+    EXPECT_EQ(changes[1].fields, tickSizeField);
+    EXPECT_EQ(changes[2].type, changeType::added);
+    EXPECT_EQ(changes[3].type, changeType::removed);
+    EXPECT_EQ(changes[3].before.symbol, "BNBBTC");
+    EXPECT_EQ(changes[3].sequence, 6);
+
+    EXPECT_EQ(binanceExchange.getSpotSymbol("BTCUSDT").status, "BREAK");
+    EXPECT_EQ(binanceExchange.spotSymbolexists("BNBBTC"), false);
+    EXPECT_EQ(binanceExchange.getSpotSymbolsSize(), 3);
+
+    // a local update makes the next identical refresh restore the exchange's value
+    binanceExchange.updateSpotStatus("BTCUSDT", "HALT");
+    EXPECT_EQ(binanceExchange.refreshMarket("SPOT", symbols), 1);
+    EXPECT_EQ(binanceExchange.getSpotSymbol("BTCUSDT").status, "BREAK");
+    EXPECT_EQ(binanceExchange.getRefreshStats().changed, 3);
+
+    // a local update to the value the exchange has is diffed but counted as unchanged
+    binanceExchange.updateSpotStatus("BTCUSDT", "BREAK");
+    EXPECT_EQ(binanceExchange.refreshMarket("SPOT", symbols), 0);
+    EXPECT_EQ(binanceExchange.getRefreshStats().unchanged, 2);
+    EXPECT_EQ(binanceExchange.getRefreshStats().changed, 3);
+}
+
+// Test that subscribers get the changes matching their filter from refreshes and queries
+TEST(subscriptionTest, filteredDelivery) {
+    exchangeInfo binanceExchange;
+    std::mutex eventsMutex;
+    std::vector<symbolChange> statusEvents, btcEvents;
+
+    subscriptionFilter statusOnly;
+    statusOnly.market = "SPOT";
+    statusOnly.fields = statusField;
+    auto statusId = binanceExchange.subscribe(statusOnly, [&](const symbolChange& change) {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        statusEvents.push_back(change);
+    });
+    subscriptionFilter btcOnly;
+    btcOnly.symbol = "BTCUSDT";
+    auto btcId = binanceExchange.subscribe(btcOnly, [&](const symbolChange& change) {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        btcEvents.push_back(change);
+    });
+
+    std::vector<symbolInfo> symbols = {{"BTCUSDT", "USDT", "TRADING", "0.01", "0.001"}, {"ETHBTC", "BTC", "TRADING", "0.00001", "0.0001"}};
+    binanceExchange.refreshMarket("SPOT", symbols);
+    symbols[1].tickSize = "0.000001";
+    binanceExchange.refreshMarket("SPOT", symbols);
+
+    std::string market = "SPOT", symbol = "ETHBTC", queryType = "UPDATE", queryStatus = "BREAK";
+    binanceExchange.processQuery(market, symbol, queryType, queryStatus);
+    symbol = "BTCUSDT", queryType = "DELETE";
+    binanceExchange.processQuery(market, symbol, queryType, queryStatus);
+
+    binanceExchange.flushChanges(statusId);
+    binanceExchange.flushChanges(btcId);
+    std::lock_guard<std::mutex> lock(eventsMutex);
+
+    // two listings, the UPDATE and the DELETE touch the status, the tick size change does not
+    ASSERT_EQ(statusEvents.size(), 4);
+    EXPECT_EQ(statusEvents[2].after.symbol, "ETHBTC");
+    EXPECT_EQ(statusEvents[2].after.status, "BREAK");
+    EXPECT_EQ(statusEvents[3].type, changeType::removed);
+
+    ASSERT_EQ(btcEvents.size(), 2);
+    EXPECT_EQ(btcEvents[0].type, changeType::added);
+    EXPECT_EQ(btcEvents[1].type, changeType::removed);
+    EXPECT_EQ(binanceExchange.unsubscribe(statusId), true);
+    EXPECT_EQ(binanceExchange.unsubscribe(statusId), false);
+}
+
+// Test that a subscriber that blocks loses events instead of blocking the refresh
+TEST(subscriptionTest, slowSubscriberDoesNotBlock) {
+    exchangeInfo binanceExchange;
+    std::atomic<bool> release{false};
+    auto id = binanceExchange.subscribe(subscriptionFilter(), [&](const symbolChange&) {
+        while (!release) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }, 4);
+
+    std::vector<symbolInfo> symbols;
+    for (int index = 0; index < 100; ++index) {
+        symbols.push_back({"SYM" + std::to_string(index), "USDT", "TRADING", "0.01", "0.001"});
+    }
+    EXPECT_EQ(binanceExchange.refreshMarket("SPOT", symbols), 100);
+    EXPECT_GE(binanceExchange.getDroppedChanges(id), 100 - 4 - 1);
+    release = true;
+    binanceExchange.unsubscribe(id);
+}
+
+// Test that the query server answers plain and pipelined requests over unix socket and tcp
+TEST(queryServerTest, unixAndTcp) {
+    exchangeInfo binanceExchange;
+    binanceExchange.setSpotSymbol("BTCUSDT", {"BTCUSDT", "USDT", "TRADING", "0.01", "0.001"});
+    binanceExchange.setSpotSymbol("ETHBTC", {"ETHBTC", "BTC", "TRADING", "0.00001", "0.0001"});
+
+    boost::asio::io_context ioc;
+    queryServer server(ioc, binanceExchange);
+    ASSERT_EQ(server.listenUnix("test_query.sock"), true);
+    unsigned short port = server.listenTcp(0);
+    ASSERT_NE(port, 0);
+    std::thread ioThread([&ioc] { ioc.run(); });
+
+    queryClient unixClient, tcpClient;
+    ASSERT_EQ(unixClient.connectUnix("test_query.sock"), true);
+    ASSERT_EQ(tcpClient.connectTcp("127.0.0.1", port), true);
+
+    std::string answer;
+    ASSERT_EQ(unixClient.request("GET SPOT BTCUSDT", answer), true);
+    rapidjson::Document doc;
+    doc.Parse(answer.c_str());
+    ASSERT_EQ(doc.HasParseError(), false);
+    EXPECT_EQ(std::string(doc["get"]["symbol"].GetString()), "BTCUSDT");
+    EXPECT_EQ(std::string(doc["get"]["tickSize"].GetString()), "0.01");
+
+    ASSERT_EQ(tcpClient.request("GET SPOT DOGEUSDT", answer), true);
+    EXPECT_EQ(answer, "{\"error\":\"symbol does not exist\"}");
+    ASSERT_EQ(tcpClient.request("FETCH SPOT", answer), true);
+    EXPECT_EQ(answer, "{\"error\":\"bad request\"}");
+
+    // both answers of a pipelined pair come back in order
+    ASSERT_EQ(tcpClient.send("UPDATE SPOT ETHBTC BREAK\nGET SPOT ETHBTC\n"), true);
+    ASSERT_EQ(tcpClient.receive(answer), true);
+    EXPECT_NE(answer.find("\"oldstatus\":\"TRADING\""), std::string::npos);
+    ASSERT_EQ(tcpClient.receive(answer), true);
+    EXPECT_NE(answer.find("\"status\":\"BREAK\""), std::string::npos);
+    EXPECT_EQ(binanceExchange.getSpotSymbol("ETHBTC").status, "BREAK");
+    EXPECT_EQ(server.requestCount(), 5);
+
+    unixClient.close();
+    tcpClient.close();
+    server.stop();
+    ioc.stop();
+    ioThread.join();
+}
+
+// Test that the query server holds, de-duplicates and answers not ready like the query file, and drops overlong lines
+TEST(queryServerTest, sameRulesAsQueryFile) {
+    exchangeInfo binanceExchange;
+    queryInfo queryConfig;
+    queryConfig.untilReady = readyMode::notReady;
+    binanceExchange.setQueryConfig(queryConfig);
+    std::vector<symbolInfo> symbols = {{"BTCUSDT", "USDT", "TRADING", "0.01", "0.001"}};
+    binanceExchange.refreshMarket("SPOT", symbols);
+
+    boost::asio::io_context ioc;
+    queryServer server(ioc, binanceExchange);
+    unsigned short port = server.listenTcp(0);
+    ASSERT_NE(port, 0);
+    std::thread ioThread([&ioc] { ioc.run(); });
+    queryClient client;
+    ASSERT_EQ(client.connectTcp("127.0.0.1", port), true);
+
+    std::string answer;
+    ASSERT_EQ(client.request("7 GET SPOT BTCUSDT", answer), true);
+    EXPECT_EQ(answer, "{\"error\":{\"id\":7,\"message\":\"not ready\"}}");
+
+    // requests wait until the last market is loaded
+    queryConfig.untilReady = readyMode::wait;
+    binanceExchange.setQueryConfig(queryConfig);
+    std::thread loader([&binanceExchange, &symbols] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        binanceExchange.refreshMarket("usd_futures", symbols);
+        binanceExchange.refreshMarket("coin_futures", symbols);
+    });
+    ASSERT_EQ(client.request("8 GET SPOT BTCUSDT", answer), true);
+    EXPECT_EQ(binanceExchange.isReady(), true);
+    EXPECT_NE(answer.find("\"symbol\":\"BTCUSDT\""), std::string::npos);
+    loader.join();
+
+    // ids seen before are not run again, requests without id always are
+    ASSERT_EQ(client.request("8 GET SPOT BTCUSDT", answer), true);
+    EXPECT_EQ(answer, "{\"error\":\"duplicate id\"}");
+    ASSERT_EQ(client.request("GET SPOT BTCUSDT", answer), true);
+    ASSERT_EQ(client.request("GET SPOT BTCUSDT", answer), true);
+    EXPECT_NE(answer.find("\"symbol\":\"BTCUSDT\""), std::string::npos);
+
+    ASSERT_EQ(client.send(std::string(queryServer::maxRequestLength * 2, 'A')), true);
+    EXPECT_EQ(client.receive(answer), false);
+
+    client.close();
+    server.stop();
+    ioc.stop();
+    ioThread.join();
+}
+
+// Test that another process sees the published tables and every later change
+TEST(sharedMemoryTest, otherProcessReads) {
+    sharedSymbols::remove("/binance_symbols_test");
+    exchangeInfo binanceExchange;
+    ASSERT_EQ(binanceExchange.setSharedMemory("/binance_symbols_test", 1 << 20), true);
+    std::vector<symbolInfo> symbols = {{"BTCUSDT", "USDT", "TRADING", "0.01000000", "0.00001000"}, {"ETHBTC", "BTC", "TRADING", "0.00001", "0.0001"}};
+    binanceExchange.refreshMarket("SPOT", symbols);
+    binanceExchange.setCoinSymbol("BTCUSD_PERP", {"BTCUSD_PERP", "USD", "TRADING", "0.1", "1"});
+
+    // the child exits with 0 if everything it reads matches
+    pid_t child = fork();
+    if (child == 0) {
+        sharedSymbolsClient client;
+        symbolInfo info;
+        fixedDecimal tickSize, stepSize;
+        bool ok = client.open("/binance_symbols_test")
+               && client.find("SPOT", "BTCUSDT", info) && info.quoteAsset == "USDT" && info.tickSize == "0.01000000"
+               && client.findFilters("coin_futures", "BTCUSD_PERP", tickSize, stepSize) && tickSize.toString() == "0.1"
+               && !client.find("SPOT", "DOGEUSDT", info) && !client.find("usd_futures", "BTCUSDT", info);
+        _exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    EXPECT_EQ(WIFEXITED(status) && WEXITSTATUS(status) == 0, true);
+
+    sharedSymbolsClient client;
+    ASSERT_EQ(client.open("/binance_symbols_test"), true);
+    uint64_t generation = client.generation();
+    binanceExchange.updateSpotStatus("ETHBTC", "BREAK");
+    binanceExchange.deleteSpotSymbol("BTCUSDT");
+    EXPECT_EQ(client.generation(), generation + 2);
+    symbolInfo info;
+    ASSERT_EQ(client.find("SPOT", "ETHBTC", info), true);
+    EXPECT_EQ(info.status, "BREAK");
+    EXPECT_EQ(client.find("SPOT", "BTCUSDT", info), false);
+    sharedSymbols::remove("/binance_symbols_test");
+}
+
+// Test that a segment left with an odd sequence by a crashed run is usable again and oversized input is rejected
+TEST(sharedMemoryTest, reopenAfterCrash) {
+    sharedSymbols::remove("/binance_symbols_crash");
+    symbolTable spot;
+    spot.insert({"BTCUSDT", "USDT", "TRADING", "0.01", "0.001"});
+    std::vector<std::pair<std::string, const symbolTable*>> tables = {{"SPOT", &spot}};
+    {
+        sharedSymbols publisher;
+        ASSERT_EQ(publisher.open("/binance_symbols_crash", 1 << 16), true);
+        ASSERT_EQ(publisher.publish(tables), true);
+    }
+
+    // died between the two sequence stores of the next publication
+    int fd = shm_open("/binance_symbols_crash", O_RDWR, 0);
+    ASSERT_GE(fd, 0);
+    size_t mappedSize = sizeof(sharedHeader) + 2 * (1 << 16);
+    auto* header = static_cast<sharedHeader*>(mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    close(fd);
+    ASSERT_NE(header, MAP_FAILED);
+    header->sequence[0].fetch_add(1);
+    munmap(header, mappedSize);
+
+    sharedSymbols publisher;
+    ASSERT_EQ(publisher.open("/binance_symbols_crash", 1 << 16), true);
+    // the next publication makes the buffer of the crashed write current
+    ASSERT_EQ(publisher.publish(tables), true);
+    sharedSymbolsClient client;
+    ASSERT_EQ(client.open("/binance_symbols_crash"), true);
+    symbolInfo info;
+    EXPECT_EQ(client.find("SPOT", "BTCUSDT", info), true);
+    EXPECT_EQ(client.retryCount(), 0);
+
+    std::vector<std::pair<std::string, const symbolTable*>> longName = {{"A_MARKET_NAME_TOO_LONG", &spot}};
+    EXPECT_EQ(publisher.publish(longName), false);
+    EXPECT_EQ(publisher.open("/binance_symbols_crash", size_t(UINT32_MAX) + 1), false);
+    sharedSymbols::remove("/binance_symbols_crash");
+}
+
+// Test that a batch of updates is published once and updates that change nothing are not published
+TEST(sharedMemoryTest, publishOncePerBatch) {
+    sharedSymbols::remove("/binance_symbols_batch");
+    exchangeInfo binanceExchange;
+    ASSERT_EQ(binanceExchange.setSharedMemory("/binance_symbols_batch", 1 << 20), true);
+    std::vector<symbolInfo> symbols = {{"BTCUSDT", "USDT", "TRADING", "0.01", "0.001"}, {"ETHBTC", "BTC", "TRADING", "0.00001", "0.0001"}};
+    binanceExchange.refreshMarket("SPOT", symbols);
+    sharedSymbolsClient client;
+    ASSERT_EQ(client.open("/binance_symbols_batch"), true);
+    uint64_t generation = client.generation();
+
+    binanceExchange.updateSpotStatus("ETHBTC", "TRADING");
+    EXPECT_EQ(client.generation(), generation);
+
+    parsedQuery queries[] = {{1, "SPOT", "BTCUSDT", "UPDATE", "BREAK", ""}, {2, "SPOT", "ETHBTC", "UPDATE", "BREAK", ""}};
+    std::string answer;
+    EXPECT_EQ(binanceExchange.executeQueries(queries, 2, answer), 2);
+    EXPECT_EQ(client.generation(), generation + 1);
+    sharedSymbols::remove("/binance_symbols_batch");
+}
+
+// Test that compact records give back the strings they were built from
+TEST(symbolTableTest, roundTrip) {
+    symbolTable symbols;
+    std::vector<symbolInfo> infos = {
+        {"ETHBTC", "BTC", "TRADING", "0.00001000", "0.00010000"},
+        {"BTCUSD_PERP", "USD", "PENDING_TRADING", "0.1", "1"},
+        {"NOFILTERS", "USDT", "SOME_NEW_STATUS", "", ""},
+    };
+    for (int index = 0; index < 1000; ++index) {
+        infos.push_back({"SYM" + std::to_string(index) + "USDT", "USDT", "BREAK", "0.01000000", "1000.00000000"});
+    }
+    for (const auto& info : infos) {
+        EXPECT_EQ(symbols.insert(info), true);
+    }
+    EXPECT_EQ(symbols.size(), infos.size());
+
+    for (const auto& info : infos) {
+        symbolInfo found;
+        ASSERT_EQ(symbols.find(info.symbol, found), true);
+        EXPECT_EQ(found.symbol, info.symbol);
+        EXPECT_EQ(found.quoteAsset, info.quoteAsset);
+        EXPECT_EQ(found.status, info.status);
+        EXPECT_EQ(found.tickSize, info.tickSize);
+        EXPECT_EQ(found.stepSize, info.stepSize);
+    }
+    EXPECT_EQ(symbols.findRecord("ETHBTC")->status, uint16_t(symbolStatus::trading));
+    EXPECT_EQ(symbols.findRecord("ETHBTC")->tickSize.units(), 1000);
+    EXPECT_EQ(symbols.findRecord("ETHBTC")->tickSize.scale(), 8);
+
+    // erased records are reused and the index still finds everything else
+    EXPECT_EQ(symbols.erase("ETHBTC"), true);
+    EXPECT_EQ(symbols.erase("ETHBTC"), false);
+    EXPECT_EQ(symbols.contains("ETHBTC"), false);
+    EXPECT_EQ(symbols.insert({"BNBBTC", "BTC", "HALT", "0.0000001", "0.001"}), true);
+    EXPECT_EQ(symbols.setStatus("BNBBTC", "TRADING"), true);
+    EXPECT_EQ(symbols.setStatus("MISSING", "TRADING"), false);
+    symbolInfo found;
+    ASSERT_EQ(symbols.find("BNBBTC", found), true);
+    EXPECT_EQ(found.status, "TRADING");
+    EXPECT_EQ(symbols.contains("SYM999USDT"), true);
+    EXPECT_EQ(symbols.size(), infos.size());
+
+    // names of erased symbols do not pile up when symbols come and go
+    size_t bytes = symbols.memoryUsage();
+    for (int round = 0; round < 500; ++round) {
+        for (int index = 0; index < 100; ++index) {
+            std::string symbol = "SYM" + std::to_string(index) + "USDT";
+            EXPECT_EQ(symbols.erase(symbol), true);
+            EXPECT_EQ(symbols.insert({symbol, "USDT", "BREAK", "0.01000000", "1000.00000000"}), true);
+        }
+    }
+    EXPECT_LT(symbols.memoryUsage(), bytes * 2);
+    EXPECT_EQ(symbols.size(), infos.size());
+    ASSERT_EQ(symbols.find("SYM42USDT", found), true);
+    EXPECT_EQ(found.symbol, "SYM42USDT");
+    EXPECT_EQ(symbols.findRecord("BNBBTC")->status, uint16_t(symbolStatus::trading));
+    std::string previous;
+    symbols.forEachMatching("", "", [&](const symbolRecord& record) {
+        EXPECT_LT(previous, std::string(symbols.name(record)));
+        previous = std::string(symbols.name(record));
+    });
+
+    fixedDecimal value;
+    EXPECT_EQ(fixedDecimal::parse("-1", value), false);
+    EXPECT_EQ(fixedDecimal::parse("1e-8", value), false);
+    EXPECT_EQ(fixedDecimal::parse("0", value), true);
+    EXPECT_EQ(value.toString(), "0");
+}
+
+// Test that strings past the last 16 bit id are rejected instead of mapped to ""
+TEST(symbolTableTest, stringTableFull) {
+    stringInterner strings{"TRADING"};
+    uint16_t id = 0;
+    ASSERT_EQ(strings.intern("TRADING", id), true);
+    EXPECT_EQ(id, 1);
+    for (size_t index = strings.size(); index <= UINT16_MAX; ++index) {
+        ASSERT_EQ(strings.intern("S" + std::to_string(index), id), true);
+        EXPECT_EQ(id, index);
+    }
+    EXPECT_EQ(strings.size(), size_t(UINT16_MAX) + 1);
+    id = 7;
+    EXPECT_EQ(strings.intern("ONE_TOO_MANY", id), false);
+    EXPECT_EQ(id, 7);
+    EXPECT_EQ(strings.find("ONE_TOO_MANY", id), false);
+    EXPECT_EQ(strings.intern("S1000", id), true);
+    EXPECT_EQ(strings.lookup(id), "S1000");
+}
+
+// Test that the setters store a symbol under the key they are given
+TEST(symbolTableTest, setterKey) {
+    exchangeInfo binanceExchange;
+    binanceExchange.setSpotSymbol("ALIASUSDT", {"BTCUSDT", "USDT", "TRADING", "0.01", "0.001"});
+    binanceExchange.setUsdSymbol("BTCUSDT", {"BTCUSDT", "USDT", "TRADING", "0.1", "0.001"});
+    binanceExchange.setCoinSymbol("ALIASUSD_PERP", {"BTCUSD_PERP", "USD", "TRADING", "0.1", "1"});
+    EXPECT_EQ(binanceExchange.spotSymbolexists("ALIASUSDT"), true);
+    EXPECT_EQ(binanceExchange.spotSymbolexists("BTCUSDT"), false);
+    EXPECT_EQ(binanceExchange.getSpotSymbol("ALIASUSDT").tickSize, "0.01");
+    EXPECT_EQ(binanceExchange.usdSymbolexists("BTCUSDT"), true);
+    EXPECT_EQ(binanceExchange.coinSymbolexists("ALIASUSD_PERP"), true);
+    EXPECT_EQ(binanceExchange.coinSymbolexists("BTCUSD_PERP"), false);
+}
+
+// Test rounding of prices and quantities to the filters of a symbol
+TEST(normalizeTest, priceAndQuantity) {
+    exchangeInfo binanceExchange;
+    binanceExchange.setSpotSymbol("BTCUSDT", symbolInfo{"BTCUSDT", "USDT", "TRADING", "0.01000000", "0.00001000"});
+
+    auto decimal = [](const char* text) {
+        fixedDecimal value;
+        fixedDecimal::parse(text, value);
+        return value;
+    };
+
+    orderResult result;
+    EXPECT_EQ(binanceExchange.normalizeOrder("SPOT", {"BTCUSDT", decimal("67000.12"), decimal("0.5")}, roundingMode::validate, result), normalizeStatus::ok);
+    EXPECT_EQ(binanceExchange.normalizeOrder("SPOT", {"BTCUSDT", decimal("67000.129"), decimal("0.5")}, roundingMode::validate, result), normalizeStatus::offGrid);
+
+    EXPECT_EQ(binanceExchange.normalizeOrder("SPOT", {"BTCUSDT", decimal("67000.129"), decimal("0.123456789")}, roundingMode::down, result), normalizeStatus::adjusted);
+    EXPECT_EQ(result.price.toString(), "67000.12000000");
+    EXPECT_EQ(result.quantity.toString(), "0.123450000");
+
+    EXPECT_EQ(binanceExchange.normalizeOrder("SPOT", {"BTCUSDT", decimal("67000.125"), decimal("1")}, roundingMode::nearest, result), normalizeStatus::adjusted);
+    EXPECT_EQ(result.price.toString(), "67000.13000000");
+    EXPECT_EQ(binanceExchange.normalizeOrder("SPOT", {"BTCUSDT", decimal("67000.121"), decimal("1")}, roundingMode::up, result), normalizeStatus::adjusted);
+    EXPECT_EQ(result.price.toString(), "67000.13000000");
+
+    EXPECT_EQ(binanceExchange.normalizeOrder("SPOT", {"BTCUSDT", decimal("67000"), decimal("0.000001")}, roundingMode::down, result), normalizeStatus::invalidQuantity);
+    EXPECT_EQ(binanceExchange.normalizeOrder("SPOT", {"ETHUSDT", decimal("1"), decimal("1")}, roundingMode::down, result), normalizeStatus::unknownSymbol);
+
+    std::vector<orderInput> orders = {{"BTCUSDT", decimal("1.001"), decimal("1")}, {"MISSING", decimal("1"), decimal("1")}, {"BTCUSDT", decimal("2"), decimal("2")}};
+    std::vector<orderResult> results(orders.size());
+    binanceExchange.normalizeOrders("SPOT", orders.data(), results.data(), orders.size(), roundingMode::down);
+    EXPECT_EQ(results[0].status, normalizeStatus::adjusted);
+    EXPECT_EQ(results[1].status, normalizeStatus::unknownSymbol);
+    EXPECT_EQ(results[2].status, normalizeStatus::ok);
+}
+
+// Test that readers see whole tables while refreshes replace them
+TEST(snapshotTest, consistentWhilePublishing) {
+    exchangeInfo binanceExchange;
+    std::atomic<bool> done{false};
+    std::atomic<int> inconsistent{0};
+
+    // every table published has all symbols with the same tick size
+    std::thread writer([&] {
+        for (int version = 1; version <= 200; ++version) {
+            std::unique_ptr<symbolTable> symbols(new symbolTable());
+            for (int index = 0; index < 50; ++index) {
+                std::string name = "SYM" + std::to_string(index);
+                symbols->insert(symbolInfo{name, "USDT", "TRADING", std::to_string(version), "0.001"});
+            }
+            binanceExchange.publishSpotSymbols(std::move(symbols));
+        }
+        done = true;
+    });
+
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < 4; ++reader) {
+        readers.emplace_back([&] {
+            while (!done) {
+                std::string first = binanceExchange.getSpotSymbol("SYM0").tickSize;
+                size_t size = binanceExchange.getSpotSymbolsSize();
+                if (size != 0 && size != 50) {
+                    ++inconsistent;
+                }
+                if (!first.empty() && std::stoi(first) > 200) {
+                    ++inconsistent;
+                }
+            }
+        });
+    }
+
+    writer.join();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(inconsistent, 0);
+    EXPECT_EQ(binanceExchange.getSpotSymbolsSize(), 50);
+    EXPECT_EQ(binanceExchange.getSpotSymbol("SYM49").tickSize, "200");
+    EXPECT_EQ(binanceExchange.spotSymbolexists("MISSING"), false);
+    EXPECT_EQ(binanceExchange.getSpotSymbol("MISSING").symbol, "");
+}
+
+// Test that the async logger writes lines from its background thread and can be replaced by a synchronous one again
+TEST(loggingTest, asyncLogger) {
+    exchangeInfo binanceExchange;
+    logsInfo logsConfig;
+    logsConfig.level = "info";
+    logsConfig.file = true;
+    logsConfig.console = false;
+    logsConfig.async = true;
+    logsConfig.overflow = "drop";
+    binanceExchange.setSpdLogs(logsConfig);
+    ASSERT_NE(std::dynamic_pointer_cast<spdlog::async_logger>(spdlog::default_logger()), nullptr);
+
+    spdlog::info("async logger test line");
+    spdlog::default_logger()->flush();
+    bool found = false;
+    for (int attempt = 0; attempt < 100 && !found; ++attempt) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::ifstream logFile("logs/logfile.log");
+        std::stringstream contents;
+        contents << logFile.rdbuf();
+        found = contents.str().find("async logger test line") != std::string::npos;
+    }
+    EXPECT_EQ(found, true);
+
+    logsConfig.async = false;
+    binanceExchange.setSpdLogs(logsConfig);
+    EXPECT_EQ(std::dynamic_pointer_cast<spdlog::async_logger>(spdlog::default_logger()), nullptr);
+}
+
+// Test that several io threads fetch and parse all markets in parallel, pinned to cpu 0
+TEST(ioThreadPoolTest, parallelRefresh) {
+    mockServer server;
+    urlInfo urlConfig;
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    useMockServer(server, urlConfig, ctx);
+
+    exchangeInfo binanceExchange;
+    boost::asio::io_context io;
+    for (int refresh = 0; refresh < 3; ++refresh) {
+        binanceExchange.fetchData(urlConfig, io, ctx);
+        ioThreadPool pool(io);
+        pool.start(3, {0});
+        EXPECT_EQ(pool.size(), 3);
+        pool.join();
+        io.restart();
+    }
+
+    EXPECT_EQ(binanceExchange.isReady(), true);
+    EXPECT_EQ(binanceExchange.getSpotSymbol("BTCUSDT").quoteAsset, "USDT");
+    EXPECT_EQ(binanceExchange.usdSymbolexists("ETHBTC"), true);
+    EXPECT_EQ(binanceExchange.coinSymbolexists("ETHBTC"), true);
+}
+
+// Test that used weight and 429 answers of the mock server reach the rate limiter and block the scheduler
+TEST(rateLimitTest, mockServerHeaders) {
+    mockServer server;
+    urlInfo urlConfig;
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    useMockServer(server, urlConfig, ctx);
+    server.setRequestWeight(20);
+
+    exchangeInfo binanceExchange;
+    boost::asio::io_context io;
+    binanceExchange.fetchData(urlConfig, io, ctx);
+    io.run();
+    io.restart();
+    EXPECT_EQ(binanceExchange.isReady(), true);
+    EXPECT_GT(binanceExchange.getRateLimiter().usedWeight(), 0);
+    EXPECT_EQ(binanceExchange.getRateLimiter().usedWeight() % 20, 0);
+    EXPECT_GT(binanceExchange.getRateLimiter().usedFraction(), 0);
+
+    // every market is rejected, nothing is due until Retry-After has passed and the symbols stay loaded
+    server.rejectRequests(3, 429, 30);
+    binanceExchange.fetchData(urlConfig, io, ctx);
+    io.run();
+    EXPECT_EQ(binanceExchange.getRateLimiter().rejections(), 3);
+    EXPECT_GE(binanceExchange.getRateLimiter().blockedFor(), std::chrono::seconds(29));
+    EXPECT_EQ(binanceExchange.getScheduler().due(~0u), 0);
+    EXPECT_GE(binanceExchange.getScheduler().untilNext(), std::chrono::seconds(29));
+    EXPECT_EQ(binanceExchange.spotSymbolexists("BTCUSDT"), true);
+}
+
+// Test that poll intervals follow changes, the weight budget and backoffs without Retry-After
+TEST(refreshSchedulerTest, adaptiveInterval) {
+    using namespace std::chrono;
+    rateLimiter limiter(6000);
+    refreshScheduler scheduler(limiter);
+    scheduler.configure(seconds(60), seconds(5), seconds(300));
+    auto now = steady_clock::now();
+
+    // never scheduled markets are due right away and not again until their interval passed
+    EXPECT_EQ(scheduler.due(0b11, now), 0b11u);
+    EXPECT_EQ(scheduler.due(0b11, now + seconds(1)), 0u);
+    EXPECT_EQ(scheduler.interval(0), seconds(60));
+
+    scheduler.completed(0, false, now);
+    EXPECT_EQ(scheduler.interval(0), seconds(75));
+    scheduler.completed(1, true, now);
+    EXPECT_EQ(scheduler.interval(1), seconds(30));
+    EXPECT_EQ(scheduler.due(0b11, now + seconds(31)), 0b10u);
+    EXPECT_EQ(scheduler.untilNext(now + seconds(31)), seconds(5));
+
+    // three quarters of the budget used stretches the interval by 2.25
+    limiter.updateUsedWeight(4500, now);
+    scheduler.completed(0, true, now);
+    EXPECT_EQ(scheduler.interval(0), milliseconds(37500));
+    EXPECT_EQ(scheduler.due(0b1, now + seconds(80)), 0u);
+    EXPECT_EQ(scheduler.due(0b1, now + seconds(85)), 0b1u);
+
+    // without Retry-After the backoff doubles per blocking window, with up to a quarter of jitter
+    limiter.reject(418, seconds(0), now);
+    EXPECT_GE(limiter.blockedFor(now), seconds(1));
+    EXPECT_LE(limiter.blockedFor(now), milliseconds(1250));
+    limiter.reject(418, seconds(0), now + milliseconds(10));
+    limiter.reject(418, seconds(0), now + milliseconds(20));
+    EXPECT_LE(limiter.blockedFor(now), milliseconds(1270));
+    limiter.reject(418, seconds(0), now + seconds(2));
+    EXPECT_GE(limiter.blockedFor(now + seconds(2)), seconds(2));
+    EXPECT_LE(limiter.blockedFor(now + seconds(2)), milliseconds(2500));
+    EXPECT_EQ(scheduler.due(0b11, now + seconds(3)), 0u);
+    limiter.accept();
+    EXPECT_EQ(limiter.blockedFor(now + seconds(5)), steady_clock::duration::zero());
+}
+
+// Test that a slow host is hedged to a fast one whose answer wins, and that the fast host is asked first afterwards
+TEST(hedgingTest, slowHostHedged) {
+    std::string slowInfo = std::regex_replace(testExchangeInfo, std::regex("BTCUSDT"), "SLOWUSDT");
+    mockServer slow, fast;
+    slow.setLatency(std::chrono::milliseconds(500));
+    urlInfo urlConfig;
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    useMockServer(fast, urlConfig, ctx);
+    slow.setResponse(urlConfig.spotExchangeEndpoint, slowInfo);
+    slow.setResponse(urlConfig.usdFutureEndpoint, slowInfo);
+    slow.setResponse(urlConfig.coinFutureEndpoint, slowInfo);
+    slow.start();
+    ctx.add_certificate_authority(boost::asio::buffer(slow.certificate()));
+
+    // both servers are localhost, their ports keep their latency stats apart
+    urlConfig.spotExchangeBaseUrl = slow.baseUrl();
+    urlConfig.usdFutureExchangeBaseUrl = slow.baseUrl();
+    urlConfig.coinFutureExchangeBaseUrl = slow.baseUrl();
+    for (const char* market : {"SPOT", "usd_futures", "coin_futures"}) {
+        urlConfig.alternateHosts[market] = {fast.baseUrl()};
+    }
+    urlConfig.hedgeDefaultDelayMs = 50;
+    urlConfig.hedgeMinDelayMs = 200;
+
+    exchangeInfo binanceExchange;
+    boost::asio::io_context io;
+    binanceExchange.fetchData(urlConfig, io, ctx);
+    io.run();
+    io.restart();
+    EXPECT_EQ(slow.requestCount(), 3);
+    EXPECT_EQ(fast.requestCount(), 3);
+    EXPECT_EQ(binanceExchange.spotSymbolexists("BTCUSDT"), true);
+    EXPECT_EQ(binanceExchange.spotSymbolexists("SLOWUSDT"), false);
+    EXPECT_EQ(binanceExchange.coinSymbolexists("BTCUSDT"), true);
+    ASSERT_NE(binanceExchange.getLatencyStats().find(slow.baseUrl(), traceStage::total), nullptr);
+    ASSERT_NE(binanceExchange.getLatencyStats().find(fast.baseUrl(), traceStage::total), nullptr);
+
+    // the slow answers were dropped but timed, the fast host answers before the hedge delay now
+    binanceExchange.fetchData(urlConfig, io, ctx);
+    io.run();
+    EXPECT_EQ(slow.requestCount(), 3);
+    EXPECT_EQ(fast.requestCount(), 6);
+    EXPECT_EQ(binanceExchange.spotSymbolexists("SLOWUSDT"), false);
+}
+
+// Test that a host refusing connections fails over to the next one without waiting for the hedge delay
+TEST(hedgingTest, failover) {
+    mockServer server;
+    urlInfo urlConfig;
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    useMockServer(server, urlConfig, ctx);
+    for (const char* market : {"SPOT", "usd_futures", "coin_futures"}) {
+        urlConfig.alternateHosts[market] = {server.baseUrl()};
+    }
+    urlConfig.spotExchangeBaseUrl = "127.0.0.1:1";
+    urlConfig.usdFutureExchangeBaseUrl = "127.0.0.1:1";
+    urlConfig.coinFutureExchangeBaseUrl = "127.0.0.1:1";
+    urlConfig.hedgeDefaultDelayMs = 30000;
+
+    // the refusing host looks fastest by latency
+    exchangeInfo binanceExchange;
+    sessionTrace fastTrace;
+    fastTrace.finish();
+    binanceExchange.getLatencyStats().record("127.0.0.1:1", fastTrace);
+    boost::asio::io_context io;
+    auto started = std::chrono::steady_clock::now();
+    binanceExchange.fetchData(urlConfig, io, ctx);
+    io.run();
+    io.restart();
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::seconds(10));
+    EXPECT_EQ(server.requestCount(), 3);
+    EXPECT_EQ(binanceExchange.isReady(), true);
+    EXPECT_EQ(binanceExchange.usdSymbolexists("ETHBTC"), true);
+    EXPECT_EQ(binanceExchange.getLatencyStats().failures("127.0.0.1:1"), 3);
+
+    // after failing it is asked last
+    binanceExchange.fetchData(urlConfig, io, ctx);
+    io.run();
+    EXPECT_EQ(server.requestCount(), 6);
+    EXPECT_EQ(binanceExchange.getLatencyStats().failures("127.0.0.1:1"), 3);
+}
+
+// Test that a market with a refresh over several hosts in flight is not requested again until it finished
+TEST(hedgingTest, oneRequestPerMarket) {
+    mockServer slow, fast;
+    slow.setLatency(std::chrono::milliseconds(500));
+    urlInfo urlConfig;
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    useMockServer(fast, urlConfig, ctx);
+    slow.setResponse(urlConfig.spotExchangeEndpoint, testExchangeInfo);
+    slow.setResponse(urlConfig.usdFutureEndpoint, testExchangeInfo);
+    slow.setResponse(urlConfig.coinFutureEndpoint, testExchangeInfo);
+    slow.start();
+    ctx.add_certificate_authority(boost::asio::buffer(slow.certificate()));
+    urlConfig.spotExchangeBaseUrl = slow.baseUrl();
+    urlConfig.usdFutureExchangeBaseUrl = slow.baseUrl();
+    urlConfig.coinFutureExchangeBaseUrl = slow.baseUrl();
+    for (const char* market : {"SPOT", "usd_futures", "coin_futures"}) {
+        urlConfig.alternateHosts[market] = {fast.baseUrl()};
+    }
+    urlConfig.hedgeDefaultDelayMs = 200;
+    urlConfig.hedgeMinDelayMs = 200;
+
+    // the second refresh would take the fast host while the first still waits for its hedge delay
+    exchangeInfo binanceExchange;
+    boost::asio::io_context io;
+    binanceExchange.fetchData(urlConfig, io, ctx);
+    binanceExchange.fetchData(urlConfig, io, ctx);
+    io.run();
+    io.restart();
+    EXPECT_EQ(slow.requestCount(), 3);
+    EXPECT_EQ(fast.requestCount(), 3);
+
+    // finished refreshes do not hold the market back
+    binanceExchange.fetchData(urlConfig, io, ctx);
+    io.run();
+    EXPECT_EQ(fast.requestCount(), 6);
+}
+
+// Test that a bracketed ipv6 host is split from its port
+TEST(hedgingTest, ipv6Host) {
+    mockServer server;
+    urlInfo urlConfig;
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    useMockServer(server, urlConfig, ctx);
+    for (const char* market : {"SPOT", "usd_futures", "coin_futures"}) {
+        urlConfig.alternateHosts[market] = {server.baseUrl()};
+    }
+    urlConfig.spotExchangeBaseUrl = "[::1]:1";
+    urlConfig.usdFutureExchangeBaseUrl = "[::1]:1";
+    urlConfig.coinFutureExchangeBaseUrl = "[::1]:1";
+
+    exchangeInfo binanceExchange;
+    boost::asio::io_context io;
+    binanceExchange.fetchData(urlConfig, io, ctx);
+    io.run();
+    EXPECT_EQ(binanceExchange.isReady(), true);
+    EXPECT_EQ(binanceExchange.getLatencyStats().failures("::1:1"), 3);
+    EXPECT_EQ(binanceExchange.getLatencyStats().failures("[::1]:1:443"), 0);
+}
+
+// Test that pooled sessions are dropped with their exchange and an exchange outliving its io_context does not touch its pool
+TEST(connectionPoolTest, lifetimes) {
+    mockServer server;
+    urlInfo urlConfig;
+    boost::asio::ssl::context ctx{ssl::context::tlsv12_client};
+    useMockServer(server, urlConfig, ctx);
+
+    boost::asio::io_context io;
+    {
+        exchangeInfo first;
+        first.fetchData(urlConfig, io, ctx);
+        io.run();
+        io.restart();
+        EXPECT_EQ(first.isReady(), true);
+    }
+    exchangeInfo second;
+    second.fetchData(urlConfig, io, ctx);
+    io.run();
+    EXPECT_EQ(second.isReady(), true);
+    EXPECT_EQ(server.requestCount(), 6);
+
+    exchangeInfo outliving;
+    {
+        boost::asio::io_context shortLived;
+        outliving.fetchData(urlConfig, shortLived, ctx);
+        shortLived.run();
+    }
+    EXPECT_EQ(outliving.isReady(), true);
+}
+
 int main() {
     // initialize answers file
     FILE* answersFile = fopen("answers.json", "w");